@@ -0,0 +1,21 @@
+#!/bin/bash
+set -e
+
+# Fetch the asymmetric TSPLIB instances listed in best_known.txt into this
+# directory for bench/optimizer_quality. Usage: fetch_tsplib.sh [URL]
+url=${1:-http://comopt.ifi.uni-heidelberg.de/software/TSPLIB95/atsp/ALL_atsp.tar}
+data=$(cd $(dirname "$0") && pwd)
+tmp=$(mktemp -d)
+trap "rm -rf ${tmp}" EXIT
+
+curl -sSfL -o ${tmp}/atsp.tar "${url}"
+tar -xf ${tmp}/atsp.tar -C ${tmp}
+for name in $(grep -v -E "^#" ${data}/best_known.txt | cut -d ' ' -f 1); do
+	if [ -f ${tmp}/${name}.atsp.gz ]; then
+		gunzip -c ${tmp}/${name}.atsp.gz > ${data}/${name}.atsp
+	elif [ -f ${tmp}/${name}.atsp ]; then
+		cp ${tmp}/${name}.atsp ${data}/${name}.atsp
+	else
+		echo "${name}.atsp not found in ${url}" >&2
+	fi
+done
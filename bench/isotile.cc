@@ -0,0 +1,130 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <list>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <valhalla/midgard/util.h>
+#include <valhalla/midgard/distanceapproximator.h>
+#include "thor/isochrone.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::thor;
+
+// Compares marking isotile cells along edge shapes by walking the grid
+// (RasterizeEdgeShape) with the prior method of resampling the shape and
+// intersecting each resampled segment with the grid.
+
+namespace {
+
+constexpr float kGridSize = 400.0f;       // Grid cell size (meters)
+constexpr float kShapeInterval = 100.0f;  // Prior resample interval (meters)
+constexpr float kToMinutes = 1.0f / 60.0f;
+
+struct Edge {
+  std::vector<PointLL> shape;
+  bool forward;
+  float secs0;
+  float secs1;
+};
+
+// Random edges (random walks of 2 to 10 points) about a center location
+std::vector<Edge> RandomEdges(const PointLL& center, const uint32_t count) {
+  std::mt19937 generator(count);
+  std::uniform_real_distribution<float> offset(-0.1f, 0.1f);
+  std::uniform_real_distribution<float> step(-0.003f, 0.003f);
+  std::uniform_int_distribution<uint32_t> points(2, 10);
+  std::vector<Edge> edges;
+  for (uint32_t i = 0; i < count; i++) {
+    Edge edge{ {}, (i % 2) == 0, 0.0f, 0.0f };
+    PointLL ll(center.lng() + offset(generator), center.lat() + offset(generator));
+    uint32_t n = points(generator);
+    for (uint32_t j = 0; j < n; j++) {
+      edge.shape.push_back(ll);
+      ll = PointLL(ll.lng() + step(generator), ll.lat() + step(generator));
+    }
+    edge.secs0 = 60.0f * (i % 30);
+    edge.secs1 = edge.secs0 + 120.0f;
+    edges.emplace_back(std::move(edge));
+  }
+  return edges;
+}
+
+// Prior method: copy the shape, reverse it if needed, resample it and
+// intersect each resampled segment with the grid.
+void ResampleAndIntersect(GriddedData<PointLL>& isotile, const Edge& edge) {
+  auto shape = edge.shape;
+  if (!edge.forward) {
+    std::reverse(shape.begin(), shape.end());
+  }
+  float length = 0.0f;
+  for (size_t i = 1; i < shape.size(); i++) {
+    length += shape[i-1].Distance(shape[i]);
+  }
+  auto resampled = resample_spherical_polyline(shape, kShapeInterval);
+  float delta = (kShapeInterval * (edge.secs1 - edge.secs0)) / length;
+  float secs = edge.secs0;
+  for (auto itr1 = resampled.begin(), itr2 = itr1 + 1; itr2 < resampled.end();
+       itr1++, itr2++) {
+    secs += delta;
+    auto tiles = isotile.Intersect(std::list<PointLL>{*itr1, *itr2});
+    for (auto t : tiles) {
+      isotile.SetIfLessThan(t.first, secs * kToMinutes);
+    }
+  }
+}
+
+}
+
+int main() {
+  PointLL center(-76.3f, 40.0f);
+  float grid_size = kGridSize / kMetersPerDegreeLat;
+  AABB2<PointLL> bounds(PointLL(center.lng() - 0.2f, center.lat() - 0.2f),
+                        PointLL(center.lng() + 0.2f, center.lat() + 0.2f));
+
+  std::cout << std::setw(10) << "edges"
+            << std::setw(14) << "resample ms"
+            << std::setw(14) << "walk ms"
+            << std::setw(10) << "speedup"
+            << std::setw(12) << "cells"
+            << std::setw(12) << "prior only"
+            << std::setw(12) << "walk only" << std::endl;
+  for (uint32_t count : { 10000, 100000, 500000 }) {
+    auto edges = RandomEdges(center, count);
+    GriddedData<PointLL> prior(bounds, grid_size, 60.0f);
+    GriddedData<PointLL> walked(bounds, grid_size, 60.0f);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (const auto& edge : edges) {
+      ResampleAndIntersect(prior, edge);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (const auto& edge : edges) {
+      RasterizeEdgeShape(walked, edge.shape, edge.forward, edge.secs0, edge.secs1);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    // Compare the cells marked by each method. Resampling can cut across
+    // cells at shape vertices, walking the grid follows the shape exactly.
+    uint32_t cells = 0, prior_only = 0, walk_only = 0;
+    for (size_t i = 0; i < prior.data().size(); i++) {
+      bool marked = walked.data()[i] < 60.0f;
+      bool prior_marked = prior.data()[i] < 60.0f;
+      cells += marked;
+      prior_only += (prior_marked && !marked);
+      walk_only += (marked && !prior_marked);
+    }
+
+    double prior_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double walk_ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    std::cout << std::setw(10) << count << std::fixed << std::setprecision(2)
+              << std::setw(14) << prior_ms
+              << std::setw(14) << walk_ms
+              << std::setw(10) << std::setprecision(1) << prior_ms / walk_ms
+              << std::setw(12) << cells
+              << std::setw(12) << prior_only
+              << std::setw(12) << walk_only << std::endl;
+  }
+  return 0;
+}
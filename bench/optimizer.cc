@@ -0,0 +1,150 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include "thor/optimizer.h"
+
+using namespace valhalla::thor;
+
+namespace {
+
+// Random asymmetric cost matrix among the specified number of locations
+std::vector<float> RandomCosts(const uint32_t nlocs, const uint32_t seed) {
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<uint32_t> distribution(60, 3600);
+  std::vector<float> costs(nlocs * nlocs, 0.0f);
+  for (uint32_t i = 0; i < nlocs; i++) {
+    for (uint32_t j = 0; j < nlocs; j++) {
+      if (i != j) {
+        costs[i * nlocs + j] = distribution(generator);
+      }
+    }
+  }
+  return costs;
+}
+
+// Compares the prefix cost reversal difference with the full walk along
+// the reversed portion of the tour that it replaces.
+class ReverseBenchmark : public Optimizer {
+ public:
+  void Run(const uint32_t nlocs, const std::vector<float>& costs,
+           const uint32_t iterations, double& prefix_ms, double& walk_ms) {
+    count_ = nlocs;
+    CreateRandomTour();
+    forward_costs_.assign(count_, 0.0);
+    reverse_costs_.assign(count_, 0.0);
+    UpdatePrefixCosts(costs, 0);
+
+    std::vector<TourAlteration> alterations;
+    while (alterations.size() < iterations) {
+      TourAlteration alteration = GetTourAlteration();
+      if (alteration.alt == KReverse) {
+        alterations.push_back(alteration);
+      }
+    }
+
+    float sum = 0.0f;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (const auto& alteration : alterations) {
+      sum += TemperatureDifference(costs, alteration);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (const auto& alteration : alterations) {
+      sum += Walk(costs, alteration);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    prefix_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    walk_ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    sink_ = sum;
+  }
+
+ protected:
+  // Keeps the compiler from discarding the timed loops
+  volatile float sink_;
+
+  float Walk(const std::vector<float>& costs,
+             const TourAlteration& alteration) const {
+    float c = 0.0f;
+    uint32_t start = alteration.start;
+    uint32_t end = alteration.end;
+    for (uint32_t i = start - 1, j = i+1; i <= end; i++, j++) {
+      c -= Cost(costs, tour_[i], tour_[j]);
+    }
+    c += Cost(costs, tour_[start-1], tour_[end]);
+    c += Cost(costs, tour_[start], tour_[end+1]);
+    for (uint32_t i = end, j = i-1; i > start; i--, j--) {
+      c += Cost(costs, tour_[i], tour_[j]);
+    }
+    return (c / static_cast<float>(count_));
+  }
+};
+
+// Compare the exact solver with simulated annealing for small tours
+void BenchExact() {
+  std::cout << std::setw(8) << "count"
+            << std::setw(14) << "exact ms"
+            << std::setw(14) << "anneal ms"
+            << std::setw(14) << "anneal gap %" << std::endl;
+  for (uint32_t nlocs = 5; nlocs <= kMaxExactCount; nlocs++) {
+    auto costs = RandomCosts(nlocs, nlocs);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    auto exact = ExactTour(nlocs, costs);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    Optimizer optimizer;
+    optimizer.Seed(111111);
+    optimizer.set_exact_max_count(0);
+    auto annealed = optimizer.Solve(nlocs, costs);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    double exact_cost = 0.0, annealed_cost = 0.0;
+    for (uint32_t i = 0; i < nlocs - 1; i++) {
+      exact_cost += costs[exact[i] * nlocs + exact[i+1]];
+      annealed_cost += costs[annealed[i] * nlocs + annealed[i+1]];
+    }
+    std::cout << std::setw(8) << nlocs << std::fixed << std::setprecision(3)
+              << std::setw(14) << std::chrono::duration<double, std::milli>(t1 - t0).count()
+              << std::setw(14) << std::chrono::duration<double, std::milli>(t2 - t1).count()
+              << std::setw(14) << std::setprecision(2)
+              << 100.0 * (annealed_cost - exact_cost) / exact_cost << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+}
+
+int main() {
+  BenchExact();
+
+  std::cout << std::setw(8) << "count"
+            << std::setw(14) << "solve ms"
+            << std::setw(14) << "prefix ms"
+            << std::setw(14) << "walk ms"
+            << std::setw(10) << "speedup" << std::endl;
+  for (uint32_t nlocs = 50; nlocs <= 200; nlocs += 50) {
+    auto costs = RandomCosts(nlocs, nlocs);
+
+    // Time a full solve
+    Optimizer optimizer;
+    optimizer.Seed(111111);
+    optimizer.set_exact_max_count(0);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    optimizer.Solve(nlocs, costs);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    double solve_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    // Time the reversal cost differences alone
+    double prefix_ms, walk_ms;
+    ReverseBenchmark bench;
+    bench.Seed(111111);
+    bench.Run(nlocs, costs, 200 * nlocs, prefix_ms, walk_ms);
+
+    std::cout << std::setw(8) << nlocs
+              << std::setw(14) << std::fixed << std::setprecision(2) << solve_ms
+              << std::setw(14) << prefix_ms
+              << std::setw(14) << walk_ms
+              << std::setw(10) << std::setprecision(1) << walk_ms / prefix_ms
+              << std::endl;
+  }
+  return 0;
+}
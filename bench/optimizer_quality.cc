@@ -0,0 +1,299 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+#include "thor/optimizer.h"
+#include "thor/local_search_optimizer.h"
+
+using namespace valhalla::thor;
+
+// Optimizer quality benchmark. Solves each instance with a fixed set of seeds
+// and reports runtime, the gap between the tour cost and the best known
+// solution, and the variance of the cost across seeds. The local search runs a
+// single seeded chain, which runs to its iteration budget regardless of the
+// time limit, so results do not depend on the machine or its load.
+//
+// Usage: optimizer_quality [--seeds N] [--iterations N] [--best-known FILE]
+//                          [INSTANCE ...]
+//
+// Instances are either asymmetric TSPLIB files (TYPE: ATSP, EDGE_WEIGHT_FORMAT:
+// FULL_MATRIX) or recorded cost matrices in plain text: the number of
+// locations followed by the row-major costs, as sent to the optimizer by
+// optimized_route (the first and last locations are the fixed ends). Set
+// thor.optimizer.record_dir to have optimized_route record them. TSPLIB
+// instances are tours, so the first city is repeated as the last location.
+//
+// Best known costs are read from a file with lines "name cost" where name is
+// the instance file name without its directory and extension. Instances small
+// enough to solve exactly use the exact cost. With no instances, random
+// matrices are used and instances without a best known cost are compared
+// against the best cost found by any run.
+
+namespace {
+
+constexpr uint32_t kDefaultSeedCount = 5;
+constexpr uint32_t kFirstSeed = 111111;
+
+// Default local search iteration budget
+constexpr uint32_t kDefaultIterations = 1000;
+
+struct Instance {
+  std::string name;
+  uint32_t count;
+  std::vector<float> costs;
+  double best_known;   // 0 if unknown
+};
+
+std::string BaseName(const std::string& path) {
+  auto slash = path.find_last_of('/');
+  std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+  auto dot = name.find_last_of('.');
+  return (dot == std::string::npos) ? name : name.substr(0, dot);
+}
+
+// Load an asymmetric TSPLIB instance. The tour returns to the first city so
+// it is added again as the last (fixed) location.
+bool LoadTSPLIB(std::istream& in, Instance& instance) {
+  uint32_t dimension = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    auto colon = line.find(':');
+    std::string key = line.substr(0, colon);
+    key.erase(std::remove_if(key.begin(), key.end(), ::isspace), key.end());
+    std::string value = (colon == std::string::npos) ? "" : line.substr(colon + 1);
+    value.erase(std::remove_if(value.begin(), value.end(), ::isspace), value.end());
+    if (key == "DIMENSION") {
+      dimension = std::stoul(value);
+    } else if (key == "EDGE_WEIGHT_TYPE" && value != "EXPLICIT") {
+      std::cerr << "Unsupported EDGE_WEIGHT_TYPE: " << value << std::endl;
+      return false;
+    } else if (key == "EDGE_WEIGHT_FORMAT" && value != "FULL_MATRIX") {
+      std::cerr << "Unsupported EDGE_WEIGHT_FORMAT: " << value << std::endl;
+      return false;
+    } else if (key == "EDGE_WEIGHT_SECTION") {
+      break;
+    }
+  }
+  if (dimension < 2) {
+    return false;
+  }
+
+  std::vector<float> weights(dimension * dimension);
+  for (auto& w : weights) {
+    if (!(in >> w)) {
+      return false;
+    }
+  }
+  instance.count = dimension + 1;
+  instance.costs.assign(instance.count * instance.count, 0.0f);
+  for (uint32_t i = 0; i < instance.count; i++) {
+    for (uint32_t j = 0; j < instance.count; j++) {
+      uint32_t a = i % dimension;
+      uint32_t b = j % dimension;
+      if (a != b) {
+        instance.costs[i * instance.count + j] = weights[a * dimension + b];
+      }
+    }
+  }
+  return true;
+}
+
+// Load a recorded cost matrix: the count followed by count * count costs
+bool LoadMatrix(std::istream& in, Instance& instance) {
+  if (!(in >> instance.count) || instance.count < 2) {
+    return false;
+  }
+  instance.costs.resize(instance.count * instance.count);
+  for (auto& c : instance.costs) {
+    if (!(in >> c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LoadInstance(const std::string& path, Instance& instance) {
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  instance.name = BaseName(path);
+  instance.best_known = 0.0;
+
+  // Recorded matrices start with the count, TSPLIB files with keywords
+  std::string first;
+  in >> first;
+  in.seekg(0);
+  if (!first.empty() && std::isdigit(first[0])) {
+    return LoadMatrix(in, instance);
+  }
+  return LoadTSPLIB(in, instance);
+}
+
+std::map<std::string, double> LoadBestKnown(const std::string& path) {
+  std::map<std::string, double> best_known;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream ss(line);
+    std::string name;
+    double cost;
+    if (line.empty() || line[0] == '#' || !(ss >> name >> cost)) {
+      continue;
+    }
+    best_known[name] = cost;
+  }
+  return best_known;
+}
+
+// Random asymmetric cost matrix among the specified number of locations
+Instance RandomInstance(const uint32_t nlocs) {
+  std::mt19937_64 generator(nlocs);
+  std::uniform_int_distribution<uint32_t> distribution(60, 3600);
+  Instance instance{"random" + std::to_string(nlocs), nlocs,
+                    std::vector<float>(nlocs * nlocs, 0.0f), 0.0};
+  for (uint32_t i = 0; i < nlocs; i++) {
+    for (uint32_t j = 0; j < nlocs; j++) {
+      if (i != j) {
+        instance.costs[i * nlocs + j] = distribution(generator);
+      }
+    }
+  }
+  return instance;
+}
+
+double TourCost(const Instance& instance, const std::vector<uint32_t>& tour) {
+  double cost = 0.0;
+  for (uint32_t i = 0; i + 1 < tour.size(); i++) {
+    cost += instance.costs[tour[i] * instance.count + tour[i+1]];
+  }
+  return cost;
+}
+
+struct RunResult {
+  double ms;
+  double cost;
+};
+
+// Solve an instance with each seed using the specified solver
+template <typename Solver>
+std::vector<RunResult> Run(const Instance& instance, const uint32_t seeds,
+                           Solver solve) {
+  std::vector<RunResult> results;
+  for (uint32_t s = 0; s < seeds; s++) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    auto tour = solve(kFirstSeed + s);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    results.push_back({std::chrono::duration<double, std::milli>(t1 - t0).count(),
+                       TourCost(instance, tour)});
+  }
+  return results;
+}
+
+void Report(const Instance& instance, const std::string& solver,
+            const std::vector<RunResult>& results, const double reference) {
+  double ms = 0.0, mean = 0.0, best = results.front().cost;
+  for (const auto& r : results) {
+    ms += r.ms;
+    mean += r.cost;
+    best = std::min(best, r.cost);
+  }
+  ms /= results.size();
+  mean /= results.size();
+  double variance = 0.0;
+  for (const auto& r : results) {
+    variance += (r.cost - mean) * (r.cost - mean);
+  }
+  variance /= results.size();
+
+  std::cout << std::left << std::setw(16) << instance.name << std::right
+            << std::setw(6) << instance.count
+            << std::setw(20) << solver << std::fixed << std::setprecision(2)
+            << std::setw(12) << ms
+            << std::setw(14) << mean
+            << std::setw(10) << 100.0 * (mean - reference) / reference
+            << std::setw(10) << 100.0 * (best - reference) / reference
+            << std::setw(12) << std::sqrt(variance)
+            << (instance.best_known > 0.0 ? "" : "  (vs best run)") << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+  uint32_t seeds = kDefaultSeedCount;
+  uint32_t iterations = kDefaultIterations;
+  std::map<std::string, double> best_known;
+  std::vector<Instance> instances;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--seeds" && i + 1 < argc) {
+      seeds = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--best-known" && i + 1 < argc) {
+      best_known = LoadBestKnown(argv[++i]);
+    } else {
+      Instance instance;
+      if (LoadInstance(arg, instance)) {
+        instances.emplace_back(std::move(instance));
+      } else {
+        std::cerr << "Skipping " << arg << ": could not load instance" << std::endl;
+      }
+    }
+  }
+  if (instances.empty()) {
+    for (uint32_t nlocs : { 12, 16, 25, 50, 100, 200 }) {
+      instances.emplace_back(RandomInstance(nlocs));
+    }
+  }
+
+  std::cout << std::left << std::setw(16) << "instance" << std::right
+            << std::setw(6) << "count"
+            << std::setw(20) << "solver"
+            << std::setw(12) << "mean ms"
+            << std::setw(14) << "mean cost"
+            << std::setw(10) << "gap %"
+            << std::setw(10) << "best %"
+            << std::setw(12) << "std dev" << std::endl;
+  for (auto& instance : instances) {
+    auto known = best_known.find(instance.name);
+    if (known != best_known.end()) {
+      instance.best_known = known->second;
+    } else if (instance.count <= kMaxExactCount) {
+      instance.best_known = TourCost(instance, ExactTour(instance.count, instance.costs));
+    }
+
+    auto annealing = Run(instance, seeds, [&instance](const uint32_t seed) {
+      Optimizer optimizer;
+      optimizer.Seed(seed);
+      optimizer.set_exact_max_count(0);
+      return optimizer.Solve(instance.count, instance.costs);
+    });
+    auto local_search = Run(instance, seeds, [&instance, iterations](const uint32_t seed) {
+      LocalSearchOptimizer optimizer(1);
+      optimizer.Seed(seed);
+      optimizer.set_max_iterations(iterations);
+      optimizer.set_exact_max_count(0);
+      return optimizer.Solve(instance.count, instance.costs);
+    });
+
+    // Without a best known cost compare against the best of all runs
+    double reference = instance.best_known;
+    if (reference <= 0.0) {
+      reference = annealing.front().cost;
+      for (const auto& r : annealing) reference = std::min(reference, r.cost);
+      for (const auto& r : local_search) reference = std::min(reference, r.cost);
+    }
+    Report(instance, "simulated_annealing", annealing, reference);
+    Report(instance, "local_search", local_search, reference);
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <stdlib.h>
+#include "thor/speed_store.h"
+#include "thor/historical_speeds.h"
+
+using namespace valhalla::thor;
+
+// Compares the per-edge cost of looking up a real-time speed with looking
+// up a historical speed at the time the edge is reached, and the size of
+// the historical speed file with storing 168 speeds per edge.
+
+namespace {
+
+constexpr uint32_t kLookups = 20000000;
+
+// Random historical speeds: a third of the edges have no speeds, the rest
+// have one of a number of base profiles (daily patterns) scaled to one of a
+// few road speeds.
+std::vector<std::vector<uint8_t> > RandomProfiles(const uint32_t edges,
+                                                  const uint32_t base_count) {
+  std::mt19937 generator(edges);
+  std::uniform_real_distribution<float> congestion(0.4f, 1.0f);
+  std::uniform_int_distribution<uint32_t> base(0, base_count - 1);
+  std::uniform_int_distribution<uint32_t> road_speed(2, 12);
+  std::vector<std::vector<float> > bases(base_count);
+  for (auto& profile : bases) {
+    for (uint32_t h = 0; h < kHoursPerWeek; h++) {
+      profile.push_back(congestion(generator));
+    }
+  }
+  std::vector<std::vector<uint8_t> > profiles(edges);
+  for (uint32_t i = 0; i < edges; i++) {
+    if (i % 3 == 0) {
+      continue;
+    }
+    float speed = 10.0f * road_speed(generator);
+    for (float factor : bases[base(generator)]) {
+      profiles[i].push_back(static_cast<uint8_t>(speed * factor));
+    }
+  }
+  return profiles;
+}
+
+void Write(const std::string& fname, const std::vector<uint8_t>& data) {
+  std::ofstream file(fname, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+}
+
+int main() {
+  char dir[] = "/tmp/traffic_speeds_XXXXXX";
+  if (mkdtemp(dir) == nullptr) {
+    std::cerr << "Could not create traffic directory" << std::endl;
+    return 1;
+  }
+  std::string traffic_dir = std::string(dir) + "/";
+
+  std::cout << std::setw(10) << "edges"
+            << std::setw(10) << "profiles"
+            << std::setw(12) << "raw KB"
+            << std::setw(12) << "file KB"
+            << std::setw(14) << "realtime ns"
+            << std::setw(16) << "historical ns" << std::endl;
+  for (uint32_t edges : { 10000, 100000, 400000 }) {
+    auto profiles = RandomProfiles(edges, 64);
+    Write(traffic_dir + "1.hsp", HistoricalSpeeds::Encode(profiles));
+    Write(traffic_dir + "1.spd", std::vector<uint8_t>(edges, 50));
+    SpeedStore realtime_store(traffic_dir);
+    SpeedStore historical_store(traffic_dir, kDefaultMaxSpeedTiles,
+                                kDefaultSpeedReloadInterval, ".hsp");
+    auto realtime = realtime_store.Get(1);
+    HistoricalSpeeds historical(historical_store.Get(1));
+
+    // Random edges and elapsed times, as reached by a path search
+    std::mt19937 generator(edges);
+    std::uniform_int_distribution<uint32_t> edge(0, edges - 1);
+    std::uniform_int_distribution<uint32_t> secs(0, 7200);
+    std::vector<std::pair<uint32_t, uint32_t> > lookups(1 << 16);
+    for (auto& lookup : lookups) {
+      lookup = std::make_pair(edge(generator), secs(generator));
+    }
+    uint32_t week_start = 32 * 3600;
+    uint32_t mask = lookups.size() - 1;
+
+    uint64_t sum = 0;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < kLookups; i++) {
+      sum += realtime->speed(lookups[i & mask].first);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < kLookups; i++) {
+      const auto& lookup = lookups[i & mask];
+      sum += historical.speed(lookup.first,
+                 HistoricalSpeeds::HourOfWeek(week_start + lookup.second));
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    double realtime_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / kLookups;
+    double historical_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / kLookups;
+    std::cout << std::setw(10) << edges
+              << std::setw(10) << historical.profile_count()
+              << std::setw(12) << edges * kHoursPerWeek / 1024
+              << std::setw(12) << historical_store.Get(1)->size() / 1024
+              << std::fixed << std::setprecision(2)
+              << std::setw(14) << realtime_ns
+              << std::setw(16) << historical_ns
+              << ((sum == 0) ? " " : "") << std::endl;
+  }
+  remove((traffic_dir + "1.hsp").c_str());
+  remove((traffic_dir + "1.spd").c_str());
+  remove(dir);
+  return 0;
+}
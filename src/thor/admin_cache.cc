@@ -0,0 +1,63 @@
+#include "thor/admin_cache.h"
+
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+AdminCache::AdminCache(const size_t max_size)
+    : max_size_(max_size) {
+}
+
+// Get the admin record of an admin index within a tile
+const AdminRecord* AdminCache::Get(const GraphTile* tile,
+                                   const uint32_t admin_index) {
+  return Get(Key(tile->id().value, admin_index),
+             [tile, admin_index]() {
+               return tile->admininfo(admin_index);
+             });
+}
+
+// Get an admin record. Tile admins with the same strings share the record
+// of the distinct admin.
+const AdminRecord* AdminCache::Get(const uint64_t key,
+                                   const std::function<AdminInfo ()>& resolve) {
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    return found->second;
+  }
+
+  AdminInfo admin_info = resolve();
+  const AdminRecord* record;
+  auto admin = admins_.find(admin_info);
+  if (admin != admins_.end()) {
+    record = &records_[admin->second];
+  } else {
+    uint32_t id = records_.size();
+    records_.push_back({id, CodeId(admin_info.country_iso()),
+                        CodeId(admin_info.state_iso()),
+                        admin_info.country_text(), admin_info.state_text(),
+                        admin_info.country_iso(), admin_info.state_iso()});
+    admins_.emplace(admin_info, id);
+    record = &records_.back();
+  }
+  index_.emplace(key, record);
+  return record;
+}
+
+// Remove all records
+void AdminCache::Clear() {
+  index_.clear();
+  records_.clear();
+  admins_.clear();
+  codes_.clear();
+}
+
+// Get the interned Id of a code
+uint32_t AdminCache::CodeId(const std::string& code) {
+  return codes_.emplace(code, codes_.size()).first->second;
+}
+
+}
+}
@@ -329,6 +329,14 @@ void AStarPathAlgorithm::CheckIfLowerCostPath(const uint32_t idx,
   }
 }
 
+// Get the cost of a directed edge at the origin or destination
+Cost AStarPathAlgorithm::LocationEdgeCost(GraphReader& graphreader,
+                 const std::shared_ptr<DynamicCost>& costing,
+                 const DirectedEdge* edge, const GraphId& edgeid,
+                 const bool origin) {
+  return costing->EdgeCost(edge);
+}
+
 // Add an edge at the origin to the adjacency list
 void AStarPathAlgorithm::SetOrigin(GraphReader& graphreader,
                  PathLocation& origin,
@@ -359,7 +367,8 @@ void AStarPathAlgorithm::SetOrigin(GraphReader& graphreader,
 
     // Get cost
     nodeinfo = endtile->node(directededge->endnode());
-    Cost cost = costing->EdgeCost(directededge) * (1.0f - edge.dist);
+    Cost cost = LocationEdgeCost(graphreader, costing, directededge, edgeid, true) *
+                    (1.0f - edge.dist);
     float dist = astarheuristic_.GetDistance(nodeinfo->latlng());
 
     // If this edge is a destination, subtract the partial/remainder cost
@@ -417,7 +426,8 @@ uint32_t AStarPathAlgorithm::SetDestination(GraphReader& graphreader,
     // remainder of the edge. This cost is subtracted from the total cost
     // up to the end of the destination edge.
     const GraphTile* tile = graphreader.GetGraphTile(edge.id);
-    destinations_[edge.id] = costing->EdgeCost(tile->directededge(edge.id)) *
+    destinations_[edge.id] = LocationEdgeCost(graphreader, costing,
+                                tile->directededge(edge.id), edge.id, false) *
                                 (1.0f - edge.dist);
 
     // Get the tile relative density
@@ -49,6 +49,7 @@ void BidirectionalAStar::Clear() {
   adjacencylist_reverse_.reset();
   edgestatus_forward_.reset();
   edgestatus_reverse_.reset();
+  traffic_.Clear();
 }
 
 // Initialize the A* heuristic and adjacency lists for both the forward
@@ -155,7 +156,8 @@ void BidirectionalAStar::ExpandForward(GraphReader& graphreader,
       shortcuts |= directededge->shortcut();
     }
     Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-    Cost newcost = pred.cost() + tc + costing_->EdgeCost(directededge);
+    Cost edgecost = traffic_.EdgeCost(costing_, directededge, edgeid, tc);
+    Cost newcost = pred.cost() + tc + edgecost;
 
     // Check if edge is temporarily labeled and this path has less cost. If
     // less cost the predecessor is updated and the sort cost is decremented
@@ -275,7 +277,7 @@ void BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     }
     Cost tc = costing_->TransitionCostReverse(directededge->localedgeidx(),
                              nodeinfo, opp_edge, opp_pred_edge);
-    Cost newcost = pred.cost() + costing_->EdgeCost(opp_edge);
+    Cost newcost = pred.cost() + traffic_.EdgeCost(costing_, opp_edge, oppedge, tc);
     newcost.cost += tc.cost;
 
     // Check if edge is temporarily labeled and this path has less cost. If
@@ -319,8 +321,10 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(PathLocation& origin,
   // algorithm is bidirectional.
   costing_->DisableDestinationOnly();
 
-  // Initialize - create adjacency list, edgestatus support, A*, etc.
+  // Initialize - create adjacency list, edgestatus support, A*, etc. Set
+  // the departure hour for historical speeds.
   Init(origin.edges.front().projected, destination.edges.front().projected);
+  traffic_.SetDeparture(graphreader, origin);
 
   // Set origin and destination locations - seeds the adj. lists
   // Note: because we can correlate to more than one place for a given
@@ -609,7 +613,7 @@ void BidirectionalAStar::SetOrigin(GraphReader& graphreader,
     // Get cost and sort cost (based on distance from endnode of this edge
     // to the destination
     nodeinfo = endtile->node(directededge->endnode());
-    Cost cost = costing_->EdgeCost(directededge) * (1.0f - edge.dist);
+    Cost cost = traffic_.EdgeCost(costing_, directededge, edgeid) * (1.0f - edge.dist);
     float dist = astarheuristic_forward_.GetDistance(nodeinfo->latlng());
     float sortcost = cost.cost + astarheuristic_forward_.Get(dist);
 
@@ -663,7 +667,7 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
     // directed edge for costing, as this is the forward direction along the
     // destination edge. Note that the end node of the opposing edge is in the
     // same tile as the directed edge.
-    Cost cost = costing_->EdgeCost(directededge) * edge.dist;
+    Cost cost = traffic_.EdgeCost(costing_, directededge, edgeid) * edge.dist;
     float dist = astarheuristic_reverse_.GetDistance(tile->node(
                     opp_dir_edge->endnode())->latlng());
     float sortcost = cost.cost + astarheuristic_reverse_.Get(dist);
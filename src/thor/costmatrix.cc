@@ -30,7 +30,9 @@ CostMatrix::CostMatrix(float cost_threshold)
       remaining_sources_(0),
       target_count_(0),
       remaining_targets_(0),
-      cost_threshold_(cost_threshold) {
+      cost_threshold_(cost_threshold),
+      max_time_(kMaxCost),
+      max_distance_(kMaxCost) {
 }
 
 // Clear the temporary information generated during time + distance matrix
@@ -71,6 +73,9 @@ void CostMatrix::Clear() {
   }
   target_edgestatus_.clear();
 
+  // Clear the speed tiles used
+  traffic_.Clear();
+
   source_hierarchy_limits_.clear();
   target_hierarchy_limits_.clear();
   source_status_.clear();
@@ -84,12 +89,18 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
         const std::vector<baldr::PathLocation>& target_location_list,
         baldr::GraphReader& graphreader,
         const std::shared_ptr<sif::DynamicCost>* mode_costing,
-        const sif::TravelMode mode) {
+        const sif::TravelMode mode,
+        const float max_matrix_time,
+        const float max_matrix_distance) {
   // Set the mode and costing
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   access_mode_ = costing_->access_mode();
 
+  // Set the time and distance limits for this request
+  max_time_ = max_matrix_time;
+  max_distance_ = max_matrix_distance;
+
   // Set the source and target locations
   Clear();
   SetSources(graphreader, source_location_list);
@@ -147,17 +158,88 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
     n++;
   }
 
-  // Form the time, distance matrix from the destinations list
+  // Form the time, distance matrix from the destinations list. Any
+  // connection beyond the time or distance limits is marked as not found.
   uint32_t idx = 0;
   std::vector<TimeDistance> td;
   for (const auto& connection : best_connection_) {
-    td.emplace_back(std::round(connection.cost.secs),
-                    std::round(connection.distance));
+    if (connection.cost.secs > max_time_ ||
+        connection.distance > max_distance_) {
+      td.emplace_back(kMaxCost, kMaxCost);
+    } else {
+      td.emplace_back(std::round(connection.cost.secs),
+                      std::round(connection.distance));
+    }
     idx++;
   }
   return td;
 }
 
+// Form the path from a source to a target using the forward and reverse
+// search trees.
+std::vector<PathInfo> CostMatrix::FormPath(const uint32_t source,
+                                           const uint32_t target) const {
+  // No path if no connection was found or if the locations are the same
+  const BestCandidate& connection = best_connection_[source * target_count_ + target];
+  if (!connection.edgeid.Is_Valid() || connection.cost.cost >= kMaxCost) {
+    return { };
+  }
+  const auto& forward_labels = source_edgelabel_[source];
+  const auto& reverse_labels = target_edgelabel_[target];
+  const EdgeLabel& opp_el = reverse_labels[connection.target_label];
+
+  // Work backwards on the forward path
+  std::vector<PathInfo> path;
+  for (auto edgelabel_index = connection.source_label; edgelabel_index != kInvalidLabel;
+       edgelabel_index = forward_labels[edgelabel_index].predecessor()) {
+    const EdgeLabel& edgelabel = forward_labels[edgelabel_index];
+    path.emplace_back(edgelabel.mode(), edgelabel.cost().secs,
+                      edgelabel.edgeid(), edgelabel.tripid());
+  }
+  std::reverse(path.begin(), path.end());
+
+  // Special case if the last edge of the forward path is the target edge -
+  // update the elapsed time. If source and target are on the same edge the
+  // connection cost is the elapsed time along the partial edge.
+  if (opp_el.predecessor() == kInvalidLabel) {
+    if (path.size() > 1) {
+      path.back().elapsed_time = path[path.size()-2].elapsed_time +
+          opp_el.cost().secs;
+    } else {
+      path.back().elapsed_time = connection.cost.secs;
+    }
+    return path;
+  }
+
+  // Append the reverse path to the target using the opposing edges. The
+  // first edge on the reverse path is the same as the last on the forward
+  // path, so start at its predecessor. Accumulate elapsed time in float
+  // so roundoff does not accumulate.
+  float secs = path.back().elapsed_time;
+  float tc = opp_el.transition_secs();
+  uint32_t edgelabel_index = opp_el.predecessor();
+  while (edgelabel_index != kInvalidLabel) {
+    const EdgeLabel& edgelabel = reverse_labels[edgelabel_index];
+
+    // Get elapsed time on the edge, then add the transition cost at
+    // prior edge.
+    uint32_t predidx = edgelabel.predecessor();
+    if (predidx == kInvalidLabel) {
+      secs += edgelabel.cost().secs;
+    } else {
+      secs += edgelabel.cost().secs - reverse_labels[predidx].cost().secs;
+    }
+    secs += tc;
+    path.emplace_back(edgelabel.mode(), static_cast<uint32_t>(secs),
+                      edgelabel.opp_edgeid(), edgelabel.tripid());
+
+    // Update edgelabel_index and transition cost to apply at next iteration
+    edgelabel_index = predidx;
+    tc = edgelabel.transition_secs();
+  }
+  return path;
+}
+
 // Initialize all time distance to "not found". Any locations that
 // are the same get set to 0 time, distance and do not add to the
 // remaining locations set.
@@ -269,7 +351,8 @@ void CostMatrix::ExpandForward(GraphReader& graphreader,
     // Get cost and accumulated distance. Update the_shortcuts mask.
     shortcuts |= directededge->shortcut();
     Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-    Cost newcost = pred.cost() + tc + costing_->EdgeCost(directededge);
+    Cost edgecost = traffic_.EdgeCost(costing_, directededge, edgeid, tc);
+    Cost newcost = pred.cost() + tc + edgecost;
     uint32_t distance = pred.path_distance() + directededge->length();
 
     // Check if edge is temporarily labeled and this path has less cost. If
@@ -330,7 +413,13 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n,
   edgestate.Update(pred.edgeid(), EdgeSet::kPermanent);
 
   // Check for connections to backwards search.
-  CheckForwardConnections(index, pred, n);
+  CheckForwardConnections(index, pred, pred_idx, n);
+
+  // Do not expand beyond the time or distance limits. Once all labels in
+  // the adjacency list are beyond the limits the search is exhausted.
+  if (pred.cost().secs > max_time_ || pred.path_distance() > max_distance_) {
+    return;
+  }
 
   // Prune path if predecessor is not a through edge
   if (pred.not_thru() && pred.not_thru_pruning()) {
@@ -362,7 +451,8 @@ void CostMatrix::ForwardSearch(const uint32_t index, const uint32_t n,
 // Check if the edge on the forward search connects to a reached edge
 // on the reverse search trees.
 void CostMatrix::CheckForwardConnections(const uint32_t source,
-                              const EdgeLabel& pred, const uint32_t n) {
+                              const EdgeLabel& pred, const uint32_t pred_idx,
+                              const uint32_t n) {
   // Disallow connections that are part of a complex restriction.
   // TODO - validate that we do not need to "walk" the paths forward
   // and backward to see if they match a restriction.
@@ -408,7 +498,8 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
           uint32_t d = std::abs(static_cast<int>(pred.path_distance())   +
                                 static_cast<int>(opp_el.path_distance()) -
                                 static_cast<int>(opp_el.transition_secs()));
-          best_connection_[idx].Update(pred.edgeid(), oppedge, Cost(s, s), d);
+          best_connection_[idx].Update(pred.edgeid(), oppedge, Cost(s, s), d,
+                                       pred_idx, oppedgestatus.index());
           best_connection_[idx].found = true;
 
           // Update status and update threshold if this is the last location
@@ -429,7 +520,8 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
             uint32_t d = pred.path_distance() + oppdist;
 
             // Update best connection and set a threshold
-            best_connection_[idx].Update(pred.edgeid(), oppedge, Cost(c, s), d);
+            best_connection_[idx].Update(pred.edgeid(), oppedge, Cost(c, s), d,
+                                         pred_idx, oppedgestatus.index());
             if (best_connection_[idx].threshold == 0) {
               best_connection_[idx].threshold = n + GetThreshold(mode_,
                      source_edgelabel_[source].size() + target_edgelabel_[target].size());
@@ -556,7 +648,8 @@ void CostMatrix::ExpandReverse(GraphReader& graphreader,
     shortcuts |= directededge->shortcut();
     Cost tc = costing_->TransitionCostReverse(directededge->localedgeidx(),
                    nodeinfo, opp_edge, opp_pred_edge);
-    Cost newcost = pred.cost() + tc + costing_->EdgeCost(opp_edge);
+    Cost edgecost = traffic_.EdgeCost(costing_, opp_edge, oppedge, tc);
+    Cost newcost = pred.cost() + tc + edgecost;
     uint32_t distance = pred.path_distance() + directededge->length();
 
     // Check if edge is temporarily labeled and this path has less cost. If
@@ -611,6 +704,11 @@ void CostMatrix::BackwardSearch(const uint32_t index,
   auto& edgestate = target_edgestatus_[index];
   edgestate.Update(pred.edgeid(), EdgeSet::kPermanent);
 
+  // Do not expand beyond the time or distance limits
+  if (pred.cost().secs > max_time_ || pred.path_distance() > max_distance_) {
+    return;
+  }
+
   // Prune path if predecessor is not a through edge
   if (pred.not_thru() && pred.not_thru_pruning()) {
     return;
@@ -687,7 +785,7 @@ void CostMatrix::SetSources(baldr::GraphReader& graphreader,
       GraphId oppedge = graphreader.GetOpposingEdgeId(edgeid);
 
       // Get cost. Get distance along the remainder of this edge.
-      Cost edgecost = costing_->EdgeCost(directededge);
+      Cost edgecost = traffic_.EdgeCost(costing_, directededge, edgeid);
       Cost cost = edgecost * (1.0f - edge.dist);
       uint32_t d = std::round(directededge->length() * (1.0f - edge.dist));
 
@@ -762,7 +860,7 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
       // Get cost. Get distance along the remainder of this edge.
       // Use the directed edge for costing, as this is the forward direction
       // along the destination edge.
-      Cost edgecost = costing_->EdgeCost(directededge);
+      Cost edgecost = traffic_.EdgeCost(costing_, directededge, edgeid);
       Cost cost = edgecost * edge.dist;
       uint32_t d = std::round(directededge->length() * edge.dist);
 
@@ -0,0 +1,104 @@
+#include <map>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include "thor/historical_speeds.h"
+
+namespace {
+
+// Size of the historical speed file header (profile and edge counts)
+constexpr size_t kHeaderSize = 2 * sizeof(uint32_t);
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Constructor for a tile without historical speeds
+HistoricalSpeeds::HistoricalSpeeds()
+    : profile_count_(0),
+      edge_count_(0),
+      profiles_(nullptr),
+      edge_profiles_(nullptr) {
+}
+
+// Constructor. The profiles are 168 bytes each so the edge profile indexes
+// that follow are aligned.
+HistoricalSpeeds::HistoricalSpeeds(const std::shared_ptr<const SpeedTile>& tile)
+    : HistoricalSpeeds() {
+  if (!tile || tile->size() < kHeaderSize) {
+    return;
+  }
+  uint32_t counts[2];
+  memcpy(counts, tile->data(), kHeaderSize);
+  size_t size = kHeaderSize + static_cast<size_t>(counts[0]) * kHoursPerWeek +
+                static_cast<size_t>(counts[1]) * sizeof(uint16_t);
+  if (tile->size() < size) {
+    return;
+  }
+  tile_ = tile;
+  profile_count_ = counts[0];
+  edge_count_ = counts[1];
+  profiles_ = tile->data() + kHeaderSize;
+  edge_profiles_ = reinterpret_cast<const uint16_t*>(
+      profiles_ + static_cast<size_t>(profile_count_) * kHoursPerWeek);
+}
+
+// Encode the historical speeds of a tile. Identical (after rounding)
+// profiles are stored once.
+std::vector<uint8_t> HistoricalSpeeds::Encode(
+          const std::vector<std::vector<uint8_t> >& edge_speeds,
+          const uint32_t quantization) {
+  uint32_t step = std::max(quantization, 1u);
+  std::map<std::vector<uint8_t>, uint16_t> profile_index;
+  std::vector<std::vector<uint8_t> > profiles;
+  std::vector<uint16_t> edge_profiles;
+  edge_profiles.reserve(edge_speeds.size());
+  for (const auto& speeds : edge_speeds) {
+    if (speeds.empty()) {
+      edge_profiles.push_back(kNoSpeedProfile);
+      continue;
+    }
+    if (speeds.size() != kHoursPerWeek) {
+      throw std::runtime_error("Historical speeds must have a speed for each hour of the week");
+    }
+
+    // Round to the nearest step. A speed is not rounded to 0 since that
+    // would mean there is no speed.
+    std::vector<uint8_t> profile(kHoursPerWeek);
+    for (uint32_t h = 0; h < kHoursPerWeek; h++) {
+      uint32_t s = speeds[h];
+      if (s > 0) {
+        s = std::max(((s + step / 2) / step) * step, step);
+      }
+      profile[h] = static_cast<uint8_t>(std::min(s, 255u));
+    }
+
+    auto found = profile_index.find(profile);
+    if (found != profile_index.end()) {
+      edge_profiles.push_back(found->second);
+      continue;
+    }
+    if (profiles.size() >= kNoSpeedProfile) {
+      throw std::runtime_error("Too many historical speed profiles in a tile");
+    }
+    uint16_t index = static_cast<uint16_t>(profiles.size());
+    profile_index.emplace(profile, index);
+    profiles.emplace_back(std::move(profile));
+    edge_profiles.push_back(index);
+  }
+
+  uint32_t counts[2] = { static_cast<uint32_t>(profiles.size()),
+                         static_cast<uint32_t>(edge_profiles.size()) };
+  std::vector<uint8_t> data(kHeaderSize);
+  memcpy(data.data(), counts, kHeaderSize);
+  for (const auto& profile : profiles) {
+    data.insert(data.end(), profile.begin(), profile.end());
+  }
+  const uint8_t* indexes = reinterpret_cast<const uint8_t*>(edge_profiles.data());
+  data.insert(data.end(), indexes, indexes + edge_profiles.size() * sizeof(uint16_t));
+  return data;
+}
+
+}
+}
@@ -1,6 +1,10 @@
 #include <iostream> // TODO remove if not needed
 #include <map>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <atomic>
+#include <thread>
 #include "thor/isochrone.h"
 #include <valhalla/baldr/datetime.h>
 #include <valhalla/midgard/distanceapproximator.h>
@@ -12,31 +16,19 @@ using namespace valhalla::sif;
 
 namespace {
 
-// Method to get an operator Id from a map of operator strings vs. Id.
-uint32_t GetOperatorId(const GraphTile* tile, uint32_t routeid,
-            std::unordered_map<std::string, uint32_t>& operators) {
-  const TransitRoute* transit_route = tile->GetTransitRoute(routeid);
-
-  // Test if the transit operator changed
-  if (transit_route && transit_route->op_by_onestop_id_offset()) {
-    // Get the operator name and look up in the operators map
-    std::string operator_name =
-        tile->GetName(transit_route->op_by_onestop_id_offset());
-    auto operator_itr = operators.find(operator_name);
-    if (operator_itr == operators.end()) {
-      // Operator not found - add to the map
-      uint32_t id = operators.size() + 1;
-      operators[operator_name] = id;
-      return id;
-    } else {
-      return operator_itr->second;
-    }
-  }
-  return 0;
-}
-
 constexpr float to_minutes = 1.0f / 60.0f;
 
+// Minimum and maximum isotile grid cell size (meters) for driving and for
+// other modes, the number of isotile grid cells the cell size aims for and
+// the maximum number of cells (the cell size grows past its maximum to stay
+// within it)
+constexpr float kMinGridSizeDriving = 200.0f;
+constexpr float kMaxGridSizeDriving = 400.0f;
+constexpr float kMinGridSizeNonDriving = 100.0f;
+constexpr float kMaxGridSizeNonDriving = 200.0f;
+constexpr float kIsoTileCells = 250000.0f;
+constexpr float kMaxIsoTileCells = 4000000.0f;
+
 }
 
 namespace valhalla {
@@ -49,10 +41,15 @@ constexpr uint64_t kInitialEdgeLabelCount = 500000;
 Isochrone::Isochrone()
     : access_mode_(kAutoAccess),
       tile_creation_date_(0),
-      shape_interval_(50.0f),
       mode_(TravelMode::kDrive),
       adjacencylist_(nullptr),
-      edgestatus_(nullptr) {
+      edgestatus_(nullptr),
+      resume_minutes_(0),
+      resume_label_(kInvalidLabel),
+      resume_marked_(0),
+      form_isotile_(true),
+      reverse_(false),
+      transit_operators_(new TransitOperators()) {
 }
 
 // Destructor
@@ -66,49 +63,227 @@ void Isochrone::Clear() {
   edgelabels_.clear();
   adjacencylist_.reset();
   edgestatus_.reset();
+  marked_edges_.clear();
+  origins_.clear();
+  marked_shapes_.clear();
+  location_fractions_.clear();
+  isotile_.reset();
+  resume_key_.clear();
+  resume_label_ = kInvalidLabel;
+  resume_marked_ = 0;
+  resume_capped_.clear();
 }
 
-// Construct the isotile. Use a grid size based on travel mode.
-// Convert time in minutes to a max distance in meters based on an
-// estimate of max average speed for the travel mode.
-void Isochrone::ConstructIsoTile(const bool multimodal, const unsigned int max_minutes,
-                                 std::vector<baldr::PathLocation>& origin_locations) {
-  float grid_size, max_distance;
-  auto max_seconds = max_minutes * 60;
-  if (multimodal) {
-    grid_size = 200.0f;
-    max_distance = max_seconds * 70.0f * 0.44704f; // TODO
-  } else if (mode_ == TravelMode::kPedestrian) {
-    grid_size = 200.0f;
-    max_distance = max_seconds * 5.0f * 0.44704f;
-  } else if (mode_ == TravelMode::kBicycle) {
-    grid_size = 200.0f;
-    max_distance = max_seconds * 20.0f * 0.44704f;
-  } else {
-    // A driving mode
-    grid_size = 400.0f;
-    max_distance = max_seconds * 70.0f * 0.44704f;
+// Create the isotile covering the edges marked during the search. The grid
+// covers the shape of the marked edges (plus a border so contours close).
+// The cell size is the minimum for the travel mode unless that would exceed
+// the number of cells aimed for, so memory is proportional to the reached
+// area rather than to an area estimated from the maximum time. The cell size
+// only exceeds the maximum for the travel mode when the area would need more
+// than the maximum number of cells at that size: then the cells grow to keep
+// within that number, coarsening the contours rather than failing. The shape
+// of each marked edge is decoded once here and kept for marking the grid.
+// When growing a prior isotile only the edges marked since are decoded.
+void Isochrone::NewIsoTile(const bool multimodal, const float initial_minutes,
+                           GraphReader& graphreader,
+                           const GriddedData<PointLL>* prior) {
+  // Get the bounds of the origins and the shape of all marked edges (or of
+  // the prior isotile's and the edges marked since)
+  size_t first = (prior != nullptr) ? resume_marked_ : 0;
+  AABB2<PointLL> bounds(10000.0f, 10000.0f, -10000.0f, -10000.0f);
+  if (prior != nullptr) {
+    bounds = resume_bounds_;
+  }
+  for (const auto& ll : origins_) {
+    bounds.Expand(AABB2<PointLL>(ll, ll));
+  }
+  marked_shapes_.clear();
+  marked_shapes_.reserve(marked_edges_.size() - first);
+  for (size_t i = first; i < marked_edges_.size(); i++) {
+    const auto& marked = marked_edges_[i];
+    const GraphTile* tile = graphreader.GetGraphTile(marked.edgeid);
+    if (tile == nullptr) {
+      marked_shapes_.push_back({ nullptr, true });
+      continue;
+    }
+    const DirectedEdge* edge = tile->directededge(marked.edgeid);
+    marked_shapes_.push_back({ EdgeShape(tile, edge), edge->forward() });
+    for (const auto& ll : *marked_shapes_.back().shape) {
+      bounds.Expand(AABB2<PointLL>(ll, ll));
+    }
   }
-  shape_interval_ = grid_size * 0.25f;
 
-  // Form grid for isotiles. Convert grid size to degrees.
-  grid_size /= kMetersPerDegreeLat;
-  float lat = origin_locations[0].latlng_.lat();
-  float dlat = max_distance / kMetersPerDegreeLat;
-  float dlon = max_distance / DistanceApproximator::MetersPerLngDegree(lat);
-  AABB2<PointLL> bounds(10000.0f, 10000.0f, -10000.0f, -10000.0f);
-  for (const auto& loc : origin_locations) {
-    PointLL center = loc.latlng_;
-    AABB2<PointLL> bbox(PointLL(center.lng() - dlon, center.lat() - dlat),
-                        PointLL(center.lng() + dlon, center.lat() + dlat));
-    bounds.Expand(bbox);
+  if (bounds.minx() > bounds.maxx()) {
+    bounds = AABB2<PointLL>(PointLL(0.0f, 0.0f), PointLL(0.0f, 0.0f));
+  }
+  resume_bounds_ = bounds;
+
+  // Get the grid size (converted to degrees) and add a border of 2 cells
+  bool driving = !(multimodal || mode_ == TravelMode::kPedestrian ||
+                   mode_ == TravelMode::kBicycle);
+  float min_size = (driving ? kMinGridSizeDriving : kMinGridSizeNonDriving) /
+                      kMetersPerDegreeLat;
+  float max_size = (driving ? kMaxGridSizeDriving : kMaxGridSizeNonDriving) /
+                      kMetersPerDegreeLat;
+  float grid_size = std::min(max_size, std::max(min_size,
+          std::sqrt(bounds.Width() * bounds.Height() / kIsoTileCells)));
+  float width = bounds.Width();
+  float height = bounds.Height();
+  auto cells = [width, height](const float size) -> float {
+    return (std::ceil(width / size) + 4.0f) * (std::ceil(height / size) + 4.0f);
+  };
+  if (prior != nullptr && cells(prior->TileSize()) <= kMaxIsoTileCells) {
+    grid_size = prior->TileSize();
+  }
+  while (cells(grid_size) > kMaxIsoTileCells) {
+    grid_size *= std::max(1.01f, std::sqrt(cells(grid_size) / kMaxIsoTileCells));
+  }
+  bounds = AABB2<PointLL>(
+        PointLL(bounds.minx() - 2.0f * grid_size, bounds.miny() - 2.0f * grid_size),
+        PointLL(bounds.maxx() + 2.0f * grid_size, bounds.maxy() + 2.0f * grid_size));
+
+  // Align the grid with the prior grid (which the bounds contain) so that
+  // its cells can be copied
+  if (prior != nullptr && grid_size == prior->TileSize()) {
+    const auto& b = prior->TileBounds();
+    float minx = b.minx() - std::ceil((b.minx() - bounds.minx()) / grid_size) * grid_size;
+    float miny = b.miny() - std::ceil((b.miny() - bounds.miny()) / grid_size) * grid_size;
+    bounds = AABB2<PointLL>(PointLL(minx, miny), PointLL(bounds.maxx(), bounds.maxy()));
+  }
+  isotile_.reset(new GriddedData<PointLL>(bounds, grid_size, initial_minutes));
+}
+
+// Form the isotile from the edges marked during the search.
+std::shared_ptr<const GriddedData<PointLL> > Isochrone::FormIsoTile(
+             const bool multimodal, const unsigned int max_minutes,
+             GraphReader& graphreader) {
+  if (!form_isotile_) {
+    isotile_.reset();
+    return isotile_;
+  }
+
+  // Set time at the origin lat, lon grid to 0 and mark the edges
+  NewIsoTile(multimodal, max_minutes + 5, graphreader);
+  for (const auto& ll : origins_) {
+    isotile_->Set(ll, 0);
+  }
+  for (size_t i = 0; i < marked_edges_.size(); i++) {
+    const auto& marked = marked_shapes_[i];
+    if (marked.shape != nullptr) {
+      RasterizeEdgeShape(*isotile_, *marked.shape, marked.forward,
+                         marked_edges_[i].secs0, marked_edges_[i].secs1);
+    }
   }
-  isotile_.reset(new GriddedData<PointLL>(bounds, grid_size, max_minutes + 5));
+  marked_shapes_.clear();
+  return isotile_;
+}
+
+// Grow the isotile of a resumed search from the prior isotile (the last one
+// formed). Cells of the prior isotile within its initial time hold the
+// minimum time from all edges marked before, so they are copied as is.
+// Cells beyond it were capped, so the edges whose end time exceeded it are
+// marked again along with the edges marked since.
+std::shared_ptr<const GriddedData<PointLL> > Isochrone::GrowIsoTile(
+             const unsigned int prior_minutes, const unsigned int max_minutes,
+             GraphReader& graphreader) {
+  auto prior = isotile_;
+  NewIsoTile(false, max_minutes + 5, graphreader, prior.get());
+  if (isotile_->TileSize() != prior->TileSize()) {
+    resume_marked_ = 0;
+    resume_capped_.clear();
+    return FormIsoTile(false, max_minutes, graphreader);
+  }
+  CopyReachedCells(*prior, prior_minutes + 5, *isotile_);
+  prior.reset();
+
+  for (const auto& ll : origins_) {
+    isotile_->Set(ll, 0);
+  }
+  for (const auto i : resume_capped_) {
+    const auto& marked = marked_edges_[i];
+    const GraphTile* tile = graphreader.GetGraphTile(marked.edgeid);
+    if (tile != nullptr) {
+      const DirectedEdge* edge = tile->directededge(marked.edgeid);
+      RasterizeEdgeShape(*isotile_, *EdgeShape(tile, edge), edge->forward(),
+                         marked.secs0, marked.secs1);
+    }
+  }
+  for (size_t i = resume_marked_; i < marked_edges_.size(); i++) {
+    const auto& marked = marked_shapes_[i - resume_marked_];
+    if (marked.shape != nullptr) {
+      RasterizeEdgeShape(*isotile_, *marked.shape, marked.forward,
+                         marked_edges_[i].secs0, marked_edges_[i].secs1);
+    }
+  }
+  marked_shapes_.clear();
+  return isotile_;
+}
+
+// Get the edges reached by the last search. Each settled edge label with a
+// start time within the maximum time is reached - fully if its end time is
+// also within the maximum time, otherwise partially. Temporary labels are
+// skipped since a lower cost path to them may not have been found yet.
+std::vector<ReachedEdge> Isochrone::ReachedEdges(const unsigned int max_minutes,
+                                                 GraphReader& graphreader) const {
+  float max_seconds = max_minutes * 60;
+  std::vector<ReachedEdge> reached;
+  for (uint32_t idx = 0; idx < edgelabels_.size(); idx++) {
+    const EdgeLabel& label = edgelabels_[idx];
+    float secs0 = (label.predecessor() == kInvalidLabel) ? 0.0f :
+                   edgelabels_[label.predecessor()].cost().secs;
+    float secs1 = label.cost().secs;
+    if (secs0 > max_seconds) {
+      continue;
+    }
+    EdgeStatusInfo status = edgestatus_->Get(label.edgeid());
+    if (status.set() != EdgeSet::kPermanent || status.index() != idx) {
+      continue;
+    }
+
+    // Skip transition edges and transit lines
+    const GraphTile* tile = graphreader.GetGraphTile(label.edgeid());
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* edge = tile->directededge(label.edgeid());
+    if (edge->trans_up() || edge->trans_down() || edge->IsTransitLine()) {
+      continue;
+    }
+
+    // Portion of the traversal of the label within the maximum time
+    float portion = (secs1 <= max_seconds || secs1 <= secs0) ? 1.0f :
+                    (max_seconds - secs0) / (secs1 - secs0);
+
+    // A forward search traverses the edge from its start (or the origin
+    // location) to its end. A reverse search traverses the opposing edge,
+    // so the edge in the direction of travel is reached back from its end
+    // (or the destination location) toward its start.
+    auto location = location_fractions_.find(idx);
+    if (!reverse_) {
+      float start = (location == location_fractions_.end()) ? 0.0f : location->second;
+      reached.push_back({ label.edgeid(), secs0, secs1, start,
+                          start + (1.0f - start) * portion });
+    } else {
+      float end = (location == location_fractions_.end()) ? 1.0f : location->second;
+      reached.push_back({ label.opp_edgeid(), secs1, secs0,
+                          end * (1.0f - portion), end });
+    }
+  }
+  return reached;
 }
 
 // Initialize - create adjacency list, edgestatus support, and reserve
 // edgelabels
 void Isochrone::Initialize(const uint32_t bucketsize) {
+  // Any prior search state (kept to resume a search) is discarded
+  edgelabels_.clear();
+  marked_edges_.clear();
+  origins_.clear();
+  location_fractions_.clear();
+  resume_key_.clear();
+  resume_label_ = kInvalidLabel;
+  resume_marked_ = 0;
+  resume_capped_.clear();
   edgelabels_.reserve(kInitialEdgeLabelCount);
 
   // Set up lambda to get sort costs
@@ -127,33 +302,55 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::Compute(
              const unsigned int max_minutes,
              GraphReader& graphreader,
              const std::shared_ptr<DynamicCost>* mode_costing,
-             const TravelMode mode) {
+             const TravelMode mode,
+             const std::string& resume_key) {
+  // Resume the prior search if it is from the same origins and costing (same
+  // key) and this extends the time. Otherwise start a new search.
+  bool resume = !resume_key.empty() && resume_key == resume_key_ &&
+                adjacencylist_ != nullptr && mode == mode_ &&
+                max_minutes >= resume_minutes_;
+
   // Set the mode and costing
   mode_ = mode;
+  reverse_ = false;
   const auto& costing = mode_costing[static_cast<uint32_t>(mode_)];
 
-  // Initialize and create the isotile
+  // Initialize unless resuming. When resuming, the isotile of the prior
+  // search is grown with the edges marked since when the search ends.
   auto max_seconds = max_minutes * 60;
-  Initialize(costing->UnitSize());
-  ConstructIsoTile(false, max_minutes, origin_locations);
+  unsigned int prior_minutes = resume_minutes_;
+  if (!resume) {
+    Initialize(costing->UnitSize());
 
-  // Set the origin locations
-  SetOriginLocations(graphreader, origin_locations, costing);
+    // Set the origin locations
+    SetOriginLocations(graphreader, origin_locations, costing);
+  }
+  resume_key_ = resume_key;
+  resume_minutes_ = max_minutes;
 
   // Compute the isotile
   uint32_t n = 0;
   const GraphTile* tile;
   while (true) {
-    // Get next element from adjacency list. Check that it is valid. An
-    // invalid label indicates there are no edges that can be expanded.
-    uint32_t predindex = adjacencylist_->pop();
-    if (predindex == kInvalidLabel) {
-      return isotile_;
+    // When resuming, the edge that ended the prior search has been settled
+    // and marked but not expanded. Otherwise get next element from adjacency
+    // list. Check that it is valid. An invalid label indicates there are no
+    // edges that can be expanded.
+    uint32_t predindex = resume_label_;
+    bool settled = (predindex != kInvalidLabel);
+    resume_label_ = kInvalidLabel;
+    if (!settled) {
+      predindex = adjacencylist_->pop();
+      if (predindex == kInvalidLabel) {
+        break;
+      }
     }
 
     // Copy the EdgeLabel for use in costing and settle the edge.
     EdgeLabel pred = edgelabels_[predindex];
-    edgestatus_->Update(pred.edgeid(), EdgeSet::kPermanent);
+    if (!settled) {
+      edgestatus_->Update(pred.edgeid(), EdgeSet::kPermanent);
+    }
 
     // Get the end node of the prior directed edge. Skip if tile not found
     // (can happen with regional data sets).
@@ -164,13 +361,17 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::Compute(
 
     // Get the nodeinfo and update the isotile
     const NodeInfo* nodeinfo = tile->node(node);
-    UpdateIsoTile(pred, graphreader, nodeinfo->latlng());
-    n++;
+    if (!settled) {
+      UpdateIsoTile(pred, graphreader, nodeinfo->latlng());
+      n++;
+    }
 
-    // Return after the time interval has been met
+    // Return after the time interval has been met. Keep this edge so a
+    // resumed search can expand from it.
     if (pred.cost().secs > max_seconds) {
       LOG_DEBUG("Exceed time interval: n = " + std::to_string(n));
-      return isotile_;
+      resume_label_ = predindex;
+      break;
     }
 
     // Check access at the node
@@ -232,7 +433,204 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::Compute(
                     newcost, newcost.cost, 0.0f, mode_, 0);
     }
   }
-  return isotile_;      // Should never get here
+
+  // Form the isotile, growing the prior isotile when resuming
+  std::shared_ptr<const GriddedData<PointLL> > isotile;
+  if (resume && isotile_ != nullptr && form_isotile_) {
+    isotile = GrowIsoTile(prior_minutes, max_minutes, graphreader);
+  } else {
+    resume_marked_ = 0;
+    resume_capped_.clear();
+    isotile = FormIsoTile(false, max_minutes, graphreader);
+  }
+
+  // Keep the state to resume the search unless it has grown too large: the
+  // number of marked edges in the isotile and those whose end time exceeds
+  // its initial time.
+  if (!resume_key_.empty()) {
+    if (edgelabels_.size() > kMaxResumeLabels) {
+      Clear();
+    } else {
+      float initial_secs = (max_minutes + 5) * 60.0f;
+      auto capped = [this, initial_secs](const uint32_t i) {
+        return marked_edges_[i].secs1 >= initial_secs;
+      };
+      resume_capped_.erase(std::remove_if(resume_capped_.begin(),
+          resume_capped_.end(), [&capped](const uint32_t i) { return !capped(i); }),
+          resume_capped_.end());
+      for (size_t i = resume_marked_; i < marked_edges_.size(); i++) {
+        if (capped(i)) {
+          resume_capped_.push_back(i);
+        }
+      }
+      resume_marked_ = marked_edges_.size();
+    }
+  }
+  return isotile;
+}
+
+// Copy the reached cells of an isotile into an aligned isotile covering it.
+// The offset of the grids is a whole number of cells.
+void CopyReachedCells(const GriddedData<PointLL>& from, const float unreached,
+                      GriddedData<PointLL>& to) {
+  const auto& b0 = from.TileBounds();
+  const auto& b1 = to.TileBounds();
+  int32_t dx = std::round((b0.minx() - b1.minx()) / to.TileSize());
+  int32_t dy = std::round((b0.miny() - b1.miny()) / to.TileSize());
+  const auto& times = from.data();
+  int32_t ncolumns = from.ncolumns();
+  for (size_t c = 0; c < times.size(); c++) {
+    if (times[c] < unreached) {
+      int32_t col = (c % ncolumns) + dx;
+      int32_t row = (c / ncolumns) + dy;
+      if (col >= 0 && col < to.ncolumns() && row >= 0 && row < to.nrows()) {
+        to.SetIfLessThan(to.TileId(col, row), times[c]);
+      }
+    }
+  }
+}
+
+// Group origin locations so that origins within the given distance of each
+// other (directly or through other origins) are in the same group.
+std::vector<std::vector<PathLocation> > GroupOrigins(
+             const std::vector<PathLocation>& origin_locations,
+             const float distance) {
+  // Find the group of each origin (union-find with path halving)
+  std::vector<size_t> group(origin_locations.size());
+  for (size_t i = 0; i < group.size(); i++) {
+    group[i] = i;
+  }
+  auto find = [&group](size_t i) {
+    while (group[i] != i) {
+      i = group[i] = group[group[i]];
+    }
+    return i;
+  };
+  for (size_t i = 0; i < origin_locations.size(); i++) {
+    for (size_t j = i + 1; j < origin_locations.size(); j++) {
+      if (origin_locations[i].latlng_.Distance(origin_locations[j].latlng_) < distance) {
+        group[find(j)] = find(i);
+      }
+    }
+  }
+
+  // Form the groups in the order of their first origin
+  std::vector<std::vector<PathLocation> > groups;
+  std::unordered_map<size_t, size_t> group_index;
+  for (size_t i = 0; i < origin_locations.size(); i++) {
+    auto itr = group_index.emplace(find(i), groups.size());
+    if (itr.second) {
+      groups.emplace_back();
+    }
+    groups[itr.first->second].push_back(origin_locations[i]);
+  }
+  return groups;
+}
+
+// Compute iso-tile from groups of origins in parallel. Each thread searches
+// groups with its own Isochrone, graph reader and costing and keeps the edges
+// it reached. The grid covering the edges reached by all threads is then
+// found, so it has the same area and cell size as a single search from all
+// origins. Each thread marks its own edges into a private isotile over that
+// grid and the isotiles are merged by taking the minimum time in each cell.
+std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeParallel(
+             std::vector<PathLocation>& origin_locations,
+             const unsigned int max_minutes,
+             const std::vector<GraphReader*>& graphreaders,
+             const std::vector<std::shared_ptr<DynamicCost> >& costings,
+             const TravelMode mode, const float group_distance) {
+  auto groups = GroupOrigins(origin_locations, group_distance);
+  size_t thread_count = std::min(std::min(graphreaders.size(), costings.size()),
+                                 groups.size());
+  if (thread_count < 2) {
+    std::shared_ptr<DynamicCost> mode_costing[static_cast<int>(TravelMode::kMaxTravelMode)];
+    mode_costing[static_cast<uint32_t>(mode)] = costings.front();
+    return Compute(origin_locations, max_minutes, *graphreaders.front(),
+                   mode_costing, mode);
+  }
+
+  // Search the groups. Each thread keeps the edges it marks and the origins.
+  std::vector<std::vector<MarkedEdge> > marked(thread_count);
+  std::vector<std::vector<PointLL> > origins(thread_count);
+  std::atomic<size_t> next(0);
+  auto search = [&](const size_t t) {
+    std::shared_ptr<DynamicCost> mode_costing[static_cast<int>(TravelMode::kMaxTravelMode)];
+    mode_costing[static_cast<uint32_t>(mode)] = costings[t];
+    Isochrone isochrone;
+    isochrone.set_form_isotile(false);
+    for (size_t i = next++; i < groups.size(); i = next++) {
+      isochrone.Compute(groups[i], max_minutes, *graphreaders[t],
+                        mode_costing, mode);
+      marked[t].insert(marked[t].end(), isochrone.marked_edges_.begin(),
+                       isochrone.marked_edges_.end());
+      origins[t].insert(origins[t].end(), isochrone.origins_.begin(),
+                        isochrone.origins_.end());
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < thread_count; t++) {
+    threads.emplace_back(search, t);
+  }
+  search(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  // Find the grid covering the edges reached from all origins (this decodes
+  // the shapes of the marked edges, in the order of the threads)
+  Clear();
+  mode_ = mode;
+  std::vector<size_t> first_marked(thread_count + 1, 0);
+  for (size_t t = 0; t < thread_count; t++) {
+    marked_edges_.insert(marked_edges_.end(), marked[t].begin(), marked[t].end());
+    origins_.insert(origins_.end(), origins[t].begin(), origins[t].end());
+    first_marked[t + 1] = marked_edges_.size();
+  }
+  if (!form_isotile_) {
+    return FormIsoTile(false, max_minutes, *graphreaders.front());
+  }
+  float initial_minutes = max_minutes + 5;
+  NewIsoTile(false, initial_minutes, *graphreaders.front());
+
+  // Mark the edges reached by each thread into its own isotile, the first
+  // thread's into the isotile being formed
+  std::vector<std::shared_ptr<GriddedData<PointLL> > > isotiles(thread_count);
+  isotiles[0] = isotile_;
+  auto mark = [&](const size_t t) {
+    if (t > 0) {
+      isotiles[t].reset(new GriddedData<PointLL>(isotile_->TileBounds(),
+                            isotile_->TileSize(), initial_minutes));
+    }
+    for (const auto& ll : origins[t]) {
+      isotiles[t]->Set(ll, 0);
+    }
+    for (size_t i = first_marked[t]; i < first_marked[t + 1]; i++) {
+      const auto& shape = marked_shapes_[i];
+      if (shape.shape != nullptr) {
+        RasterizeEdgeShape(*isotiles[t], *shape.shape, shape.forward,
+                           marked_edges_[i].secs0, marked_edges_[i].secs1);
+      }
+    }
+  };
+  for (size_t t = 1; t < thread_count; t++) {
+    threads.emplace_back(mark, t);
+  }
+  mark(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  marked_shapes_.clear();
+
+  // Merge the isotiles: each cell has the minimum time from any thread
+  for (size_t t = 1; t < thread_count; t++) {
+    const auto& times = isotiles[t]->data();
+    for (size_t c = 0; c < times.size(); c++) {
+      isotile_->SetIfLessThan(c, times[c]);
+    }
+    isotiles[t].reset();
+  }
+  return isotile_;
 }
 
 // Compute iso-tile that we can use to generate isochrones.
@@ -244,13 +642,13 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeReverse(
              const TravelMode mode) {
   // Set the mode and costing
   mode_ = mode;
+  reverse_ = true;
   const auto& costing = mode_costing[static_cast<uint32_t>(mode_)];
   access_mode_ = costing->access_mode();
 
   // Initialize and create the isotile
   auto max_seconds = max_minutes * 60;
   Initialize(costing->UnitSize());
-  ConstructIsoTile(false, max_minutes, dest_locations);
 
   // Set the origin locations
   SetDestinationLocations(graphreader, dest_locations, costing);
@@ -263,7 +661,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeReverse(
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
     if (predindex == kInvalidLabel) {
-      return isotile_;
+      return FormIsoTile(false, max_minutes, graphreader);
     }
 
     // Copy the EdgeLabel for use in costing and settle the edge.
@@ -285,7 +683,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeReverse(
     // Return after the time interval has been met
     if (pred.cost().secs > max_seconds) {
       LOG_DEBUG("Exceed time interval: n = " + std::to_string(n));
-      return isotile_;
+      return FormIsoTile(false, max_minutes, graphreader);
     }
 
     // Check access at the node
@@ -372,7 +770,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeReverse(
                     mode_, tc, false);
     }
   }
-  return isotile_;      // Should never get here
+  return FormIsoTile(false, max_minutes, graphreader);      // Should never get here
 }
 
 // Compute isochrone for mulit-modal route.
@@ -381,6 +779,136 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
              const unsigned int max_minutes, GraphReader& graphreader,
              const std::shared_ptr<DynamicCost>* mode_costing,
              const TravelMode mode) {
+  ExpandMultiModal(origin_locations, max_minutes, graphreader, mode_costing,
+                   mode, 0, nullptr);
+  return FormIsoTile(true, max_minutes, graphreader);
+}
+
+// Compute min, median and max isochrone grids for multi-modal routes over a
+// window of departure times. Departures are searched from the latest to the
+// earliest (as in range RAPTOR). Since waiting at the origin is allowed, the
+// arrival at an edge for a departure is no later than the arrival for any
+// later departure - so each search stops expanding edges that a later
+// departure already reached as early in the same state (mode, trip and
+// walking distance), and only marks the edges it improves.
+// The grids of arrival times are then formed by replaying the marked edges
+// into one grid of times since the start of the window.
+IsochroneProfile Isochrone::ComputeMultiModalProfile(
+             std::vector<PathLocation>& origin_locations,
+             const unsigned int max_minutes, const unsigned int window_minutes,
+             const unsigned int step_minutes, GraphReader& graphreader,
+             const std::shared_ptr<DynamicCost>* mode_costing,
+             const TravelMode mode) {
+  // Departure times (seconds from the start of the window), latest first
+  uint32_t step = std::max(step_minutes, 1u) * 60;
+  std::vector<uint32_t> departures;
+  for (uint32_t offset = 0; offset < std::max(window_minutes * 60, 1u); offset += step) {
+    departures.push_back(offset);
+  }
+  std::reverse(departures.begin(), departures.end());
+
+  // Search for each departure. Keep the edges each search marks (with times
+  // since the start of the window) and where the edges of each search end.
+  EdgeArrivals arrivals;
+  std::vector<MarkedEdge> marked;
+  std::vector<size_t> marked_ends;
+  for (const auto departure : departures) {
+    ExpandMultiModal(origin_locations, max_minutes, graphreader, mode_costing,
+                     mode, departure, &arrivals);
+    for (const auto& edge : marked_edges_) {
+      marked.push_back({ edge.edgeid, edge.secs0 + departure, edge.secs1 + departure });
+    }
+    marked_ends.push_back(marked.size());
+  }
+  marked_edges_ = std::move(marked);
+
+  // Create the grid of times since the start of the window covering all
+  // marked edges and the grids of travel times
+  float unreached = max_minutes + 5;
+  NewIsoTile(true, departures.front() * to_minutes + unreached, graphreader);
+  std::shared_ptr<GriddedData<PointLL> > minimum(new GriddedData<PointLL>(
+        isotile_->TileBounds(), isotile_->TileSize(), unreached));
+  std::shared_ptr<GriddedData<PointLL> > median(new GriddedData<PointLL>(
+        isotile_->TileBounds(), isotile_->TileSize(), unreached));
+  std::shared_ptr<GriddedData<PointLL> > maximum(new GriddedData<PointLL>(
+        isotile_->TileBounds(), isotile_->TileSize(), unreached));
+
+  // Mark the edges of each search in turn. After each the grid holds the
+  // earliest arrival from this or any later departure. Only the cells whose
+  // arrival changes are kept rather than a travel time for each cell and
+  // departure: a cell's arrival holds until it changes. The cells lowered
+  // while marking a search (and the origin cells) are the only ones that can
+  // change, so only those are compared.
+  struct ArrivalChange {
+    uint32_t cell;
+    uint32_t departure;
+    float arrival;
+  };
+  std::vector<ArrivalChange> changes;
+  std::vector<float> prior(isotile_->data());
+  std::vector<uint32_t> lowered;
+  size_t count = departures.size();
+  for (size_t i = 0, begin = 0; i < count; begin = marked_ends[i++]) {
+    lowered.clear();
+    for (size_t j = begin; j < marked_ends[i]; j++) {
+      const auto& marked = marked_shapes_[j];
+      if (marked.shape != nullptr) {
+        RasterizeEdgeShape(*isotile_, *marked.shape, marked.forward,
+                           marked_edges_[j].secs0, marked_edges_[j].secs1,
+                           &lowered);
+      }
+    }
+    float departure = departures[i] * to_minutes;
+    for (const auto& ll : origins_) {
+      isotile_->Set(ll, departure);
+      int32_t cell = isotile_->TileId(ll);
+      if (cell >= 0) {
+        lowered.push_back(cell);
+      }
+    }
+    const auto& arrival = isotile_->data();
+    for (const auto c : lowered) {
+      if (arrival[c] != prior[c]) {
+        changes.push_back({ c, static_cast<uint32_t>(i), arrival[c] });
+        prior[c] = arrival[c];
+      }
+    }
+  }
+  std::stable_sort(changes.begin(), changes.end(),
+      [](const ArrivalChange& a, const ArrivalChange& b) { return a.cell < b.cell; });
+
+  // Get the min, median and max travel time to each cell that is reached.
+  // The travel time from each departure is the time from the departure to
+  // the arrival, which holds until the next change in the cell.
+  std::vector<float> times(count);
+  for (auto change = changes.begin(); change != changes.end(); ) {
+    uint32_t c = change->cell;
+    float arrival = departures.front() * to_minutes + unreached;
+    for (size_t i = 0; i < count; i++) {
+      if (change != changes.end() && change->cell == c && change->departure == i) {
+        arrival = change->arrival;
+        ++change;
+      }
+      times[i] = std::min(arrival - departures[i] * to_minutes, unreached);
+    }
+    auto mid = times.begin() + count / 2;
+    std::nth_element(times.begin(), mid, times.end());
+    minimum->SetIfLessThan(c, *std::min_element(times.begin(), times.end()));
+    median->SetIfLessThan(c, *mid);
+    maximum->SetIfLessThan(c, *std::max_element(times.begin(), times.end()));
+  }
+  isotile_.reset();
+  marked_shapes_.clear();
+  return { minimum, median, maximum };
+}
+
+// Expand the multi-modal search from the origin locations, departing the
+// given number of seconds after the origin date time.
+void Isochrone::ExpandMultiModal(std::vector<PathLocation>& origin_locations,
+             const unsigned int max_minutes, GraphReader& graphreader,
+             const std::shared_ptr<DynamicCost>* mode_costing,
+             const TravelMode mode, const uint32_t departure,
+             EdgeArrivals* arrivals) {
   // For pedestrian costing - set flag allowing use of transit connections
   // Set pedestrian costing to use max distance. TODO - need for other modes
   const auto& pc = mode_costing[static_cast<uint8_t>(TravelMode::kPedestrian)];
@@ -389,6 +917,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
 
   // Set the mode from the origin
   mode_ = mode;
+  reverse_ = false;
   const auto& costing = mode_costing[static_cast<uint8_t>(mode)];
   const auto& tc = mode_costing[static_cast<uint8_t>(TravelMode::kPublicTransit)];
   bool wheelchair = tc->wheelchair();
@@ -401,7 +930,6 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
   // Initialize and create the isotile
   auto max_seconds = max_minutes * 60;
   Initialize(costing->UnitSize());
-  ConstructIsoTile(true, max_minutes, origin_locations);
 
   // Set the origin locations.
   SetOriginLocations(graphreader, origin_locations, costing);
@@ -409,7 +937,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
   // For now the date_time must be set on the origin.
   if (!origin_locations.front().date_time_) {
     LOG_ERROR("No date time set on the origin location");
-    return isotile_;
+    return;
   }
 
   // Update start time
@@ -417,7 +945,8 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
   bool date_before_tile = false;
   if (origin_locations[0].date_time_) {
     // Set route start time (seconds from midnight), date, and day of week
-    start_time = DateTime::seconds_from_midnight(*origin_locations[0].date_time_);
+    start_time = DateTime::seconds_from_midnight(*origin_locations[0].date_time_) +
+                 departure;
     localtime = start_time;
   }
 
@@ -425,7 +954,6 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
   uint32_t n = 0;
   bool date_set = false;
   uint32_t blockid, tripid;
-  std::unordered_map<std::string, uint32_t> operators;
   std::unordered_set<uint32_t> processed_tiles;
   const GraphTile* tile;
   while (true) {
@@ -433,7 +961,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
     if (predindex == kInvalidLabel) {
-      return isotile_;
+      return;
     }
 
     // Copy the EdgeLabel for use in costing and settle the edge.
@@ -447,6 +975,28 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
       continue;
     }
 
+    // When searching a departure window skip the edge if a later departure
+    // reached it as early in the same mode and trip having walked no
+    // further (waiting at the origin is allowed). Otherwise keep this
+    // arrival in place of those it dominates.
+    if (arrivals != nullptr) {
+      EdgeArrival arrival{ departure + pred.cost().secs, pred.path_distance(),
+                           pred.tripid(), pred.mode() };
+      auto& edge_arrivals = (*arrivals)[pred.edgeid().value];
+      auto dominates = [](const EdgeArrival& a, const EdgeArrival& b) {
+        return a.mode == b.mode && a.tripid == b.tripid &&
+               a.secs <= b.secs && a.walking_distance <= b.walking_distance;
+      };
+      if (std::any_of(edge_arrivals.begin(), edge_arrivals.end(),
+              [&](const EdgeArrival& a) { return dominates(a, arrival); })) {
+        continue;
+      }
+      edge_arrivals.erase(std::remove_if(edge_arrivals.begin(), edge_arrivals.end(),
+              [&](const EdgeArrival& a) { return dominates(arrival, a); }),
+              edge_arrivals.end());
+      edge_arrivals.push_back(arrival);
+    }
+
     // Get the nodeinfo and update the isotile
     const NodeInfo* nodeinfo = tile->node(node);
     UpdateIsoTile(pred, graphreader, nodeinfo->latlng());
@@ -455,7 +1005,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
     // Return after the time interval has been met
     if (pred.cost().secs > max_seconds) {
       LOG_DEBUG("Exceed time interval: n = " + std::to_string(n));
-      return isotile_;
+      return;
     }
 
     // Check access at the node
@@ -603,7 +1153,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
             }
 
             // Get the operator Id
-            operator_id = GetOperatorId(tile, departure->routeid(), operators);
+            operator_id = transit_operators_->GetOperatorId(tile, departure->routeid());
 
             // Add transfer penalty and operator change penalty
             newcost.cost += transfer_cost.cost;
@@ -713,7 +1263,16 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
                     tripid, prior_stop, blockid, operator_id, has_transit);
     }
   }
-  return isotile_;      // Should never get here
+}
+
+// Get the decoded shape of a directed edge
+std::shared_ptr<const std::vector<PointLL> > Isochrone::EdgeShape(
+             const GraphTile* tile, const DirectedEdge* edge) const {
+  if (shape_cache_) {
+    return shape_cache_->Get(tile, edge->edgeinfo_offset());
+  }
+  return std::make_shared<std::vector<PointLL> >(
+      tile->edgeinfo(edge->edgeinfo_offset()).shape());
 }
 
 // Update the isotile
@@ -746,27 +1305,113 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred, GraphReader& graphreader,
     secs0 = edgelabels_[predindex].cost().secs;
   }
 
-  // Get the shape and make sure shape is forward
-  // direction and resample it to the shape interval.
-  auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
-  if (!edge->forward()) {
-    std::reverse(shape.begin(), shape.end());
+  // Mark the edge. Grid cells along the shape are marked when the isotile
+  // is formed.
+  marked_edges_.push_back({ pred.edgeid(), secs0, secs1 });
+}
+
+// Mark the time to reach each grid cell along an edge shape. Walks the grid
+// cells crossed by each segment (Amanatides and Woo) in grid units, tracking
+// the parametric distance along the segment where each cell is entered.
+void RasterizeEdgeShape(GriddedData<PointLL>& isotile,
+                        const std::vector<PointLL>& shape,
+                        const bool forward, const float secs0,
+                        const float secs1, std::vector<uint32_t>* lowered) {
+  const size_t n = shape.size();
+  if (n == 0) {
+    return;
   }
-  auto resampled = resample_spherical_polyline(shape, shape_interval_);
+  auto point = [&shape, n, forward](const size_t i) -> const PointLL& {
+    return forward ? shape[i] : shape[n - 1 - i];
+  };
+
+  // Grid cell of a point in fractional columns and rows. Use the distance
+  // in degrees of latitude (longitude scaled at the latitude of the edge)
+  // to interpolate time along the shape.
+  const AABB2<PointLL>& bounds = isotile.TileBounds();
+  const float inv_size = 1.0f / isotile.TileSize();
+  const float lng_scale = DistanceApproximator::MetersPerLngDegree(
+                  shape.front().lat()) / kMetersPerDegreeLat;
+  const int32_t ncolumns = isotile.ncolumns();
+  const int32_t nrows = isotile.nrows();
+  auto mark = [&isotile, ncolumns, nrows, lowered](const int32_t col,
+                                                   const int32_t row,
+                                                   const float secs) {
+    if (col >= 0 && col < ncolumns && row >= 0 && row < nrows) {
+      int32_t cell = isotile.TileId(col, row);
+      float minutes = secs * to_minutes;
+      if (lowered != nullptr && minutes < isotile.data()[cell]) {
+        lowered->push_back(cell);
+      }
+      isotile.SetIfLessThan(cell, minutes);
+    }
+  };
 
-  // Mark grid cells along the shape if time is less than what is
-  // already populated. Get intersection of tiles along each segment
-  // so this doesn't miss shape that crosses tile corners
-  float delta = (shape_interval_ * (secs1 - secs0)) / edge->length();
-  float secs = secs0;
-  auto itr1 = resampled.begin();
-  auto itr2 = itr1 + 1;
-  for (auto itr2 = itr1 + 1; itr2 < resampled.end(); itr1++, itr2++) {
-    secs += delta;
-    auto tiles = isotile_->Intersect(std::list<PointLL>{*itr1, *itr2});
-    for (auto t : tiles) {
-      isotile_->SetIfLessThan(t.first, secs * to_minutes);
+  float length = 0.0f;
+  for (size_t i = 1; i < n; i++) {
+    float dx = (point(i).lng() - point(i-1).lng()) * lng_scale;
+    float dy = point(i).lat() - point(i-1).lat();
+    length += std::sqrt(dx * dx + dy * dy);
+  }
+  const float secs_per_length = (length > 0.0f) ? (secs1 - secs0) / length : 0.0f;
+
+  // Mark the cell containing the start of the edge
+  float x0 = (point(0).lng() - bounds.minx()) * inv_size;
+  float y0 = (point(0).lat() - bounds.miny()) * inv_size;
+  mark(static_cast<int32_t>(std::floor(x0)), static_cast<int32_t>(std::floor(y0)), secs0);
+
+  float along = 0.0f;
+  for (size_t i = 1; i < n; i++) {
+    float x1 = (point(i).lng() - bounds.minx()) * inv_size;
+    float y1 = (point(i).lat() - bounds.miny()) * inv_size;
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float seg_length = std::sqrt(dx * dx * lng_scale * lng_scale + dy * dy) /
+                       inv_size;
+
+    // Walk the cells from the start to the end of the segment. t is the
+    // fraction along the segment where the next column or row is entered.
+    int32_t col = static_cast<int32_t>(std::floor(x0));
+    int32_t row = static_cast<int32_t>(std::floor(y0));
+    const int32_t end_col = static_cast<int32_t>(std::floor(x1));
+    const int32_t end_row = static_cast<int32_t>(std::floor(y1));
+    const int32_t step_col = (dx > 0.0f) ? 1 : -1;
+    const int32_t step_row = (dy > 0.0f) ? 1 : -1;
+    const float inf = std::numeric_limits<float>::infinity();
+    float t_col = (dx != 0.0f) ? ((col + (step_col > 0 ? 1 : 0)) - x0) / dx : inf;
+    float t_row = (dy != 0.0f) ? ((row + (step_row > 0 ? 1 : 0)) - y0) / dy : inf;
+    const float dt_col = (dx != 0.0f) ? std::abs(1.0f / dx) : inf;
+    const float dt_row = (dy != 0.0f) ? std::abs(1.0f / dy) : inf;
+    int32_t steps = std::abs(end_col - col) + std::abs(end_row - row);
+    while (steps > 0) {
+      float t;
+      if (t_col < t_row) {
+        t = t_col;
+        t_col += dt_col;
+        col += step_col;
+        steps--;
+      } else if (t_row < t_col) {
+        t = t_row;
+        t_row += dt_row;
+        row += step_row;
+        steps--;
+      } else {
+        // Crosses a cell corner - mark both cells adjacent to the corner
+        t = t_col;
+        float secs = secs0 + (along + t * seg_length) * secs_per_length;
+        mark(col + step_col, row, secs);
+        mark(col, row + step_row, secs);
+        t_col += dt_col;
+        t_row += dt_row;
+        col += step_col;
+        row += step_row;
+        steps -= 2;
+      }
+      mark(col, row, secs0 + (along + std::min(t, 1.0f) * seg_length) * secs_per_length);
     }
+    along += seg_length;
+    x0 = x1;
+    y0 = y1;
   }
 }
 
@@ -791,8 +1436,8 @@ void Isochrone::SetOriginLocations(GraphReader& graphreader,
                  const std::shared_ptr<DynamicCost>& costing) {
   // Add edges for each location to the adjacency list
   for (auto& origin : origin_locations) {
-    // Set time at the origin lat, lon grid to 0
-    isotile_->Set(origin.latlng_, 0);
+    // Keep the origin so its grid cell is set to 0 time
+    origins_.push_back(origin.latlng_);
 
     // Iterate through edges and add to adjacency list
     const NodeInfo* nodeinfo = nullptr;
@@ -828,6 +1473,7 @@ void Isochrone::SetOriginLocations(GraphReader& graphreader,
       uint32_t d = static_cast<uint32_t>(directededge->length() * (1.0f - edge.dist));
       adjacencylist_->add(idx, cost.cost);
       edgestatus_->Set(edgeid, EdgeSet::kTemporary, idx);
+      location_fractions_[idx] = edge.dist;
       EdgeLabel edge_label(kInvalidLabel, edgeid, directededge, cost,
                            cost.cost, 0.0f, mode_, d);
       edge_label.set_origin();
@@ -851,8 +1497,8 @@ void Isochrone::SetDestinationLocations(GraphReader& graphreader,
                      const std::shared_ptr<DynamicCost>& costing) {
   // Add edges for each location to the adjacency list
   for (auto& dest : dest_locations) {
-    // Set time at the origin lat, lon grid to 0
-    isotile_->Set(dest.latlng_, 0);
+    // Keep the destination so its grid cell is set to 0 time
+    origins_.push_back(dest.latlng_);
 
     // Iterate through edges and add to adjacency list
     Cost c;
@@ -888,6 +1534,7 @@ void Isochrone::SetDestinationLocations(GraphReader& graphreader,
       uint32_t idx = edgelabels_.size();
       adjacencylist_->add(idx, cost.cost);
       edgestatus_->Set(opp_edge_id, EdgeSet::kTemporary, idx);
+      location_fractions_[idx] = edge.dist;
       edgelabels_.emplace_back(kInvalidLabel, opp_edge_id, edgeid,
                   opp_dir_edge, cost, cost.cost, 0.0f, mode_, c, false);
     }
@@ -4,6 +4,13 @@ using namespace prime_server;
 
 #include <valhalla/baldr/geojson.h>
 #include <valhalla/midgard/logging.h>
+#include <boost/property_tree/json_parser.hpp>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
 
 #include "thor/service.h"
 
@@ -13,6 +20,181 @@ namespace {
   const headers_t::value_type CORS{"Access-Control-Allow-Origin", "*"};
   const headers_t::value_type JSON_MIME{"Content-type", "application/json;charset=utf-8"};
   const headers_t::value_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
+  const headers_t::value_type BINARY_MIME{"Content-type", "application/octet-stream"};
+
+  // Form the isotile cache key from the correlated origin edges, their
+  // date_time and the costing (method and costing options). Departing at the
+  // "current" time is not the same search from one request to the next, so
+  // such requests have no key (an empty key) and are not cached or resumed
+  std::string isotile_key(const std::vector<valhalla::baldr::PathLocation>& correlated,
+                          const std::string& costing,
+                          const boost::property_tree::ptree& request) {
+    std::stringstream key;
+    for (const auto& location : correlated) {
+      key << std::setprecision(7) << location.latlng_.lng() << ',' << location.latlng_.lat();
+      for (const auto& edge : location.edges)
+        key << ';' << edge.id.value << ':' << edge.dist;
+      if (location.date_time_) {
+        if (*location.date_time_ == "current")
+          return "";
+        key << '@' << *location.date_time_;
+      }
+      key << '|';
+    }
+    std::stringstream costing_options;
+    boost::property_tree::json_parser::write_json(costing_options,
+      request.get_child("costing_options", {}), false);
+    key << costing << '|' << costing_options.str();
+    return key.str();
+  }
+
+  // Generate the contours for each level on up to thread_count threads. Each
+  // level is extracted, denoised and generalized independently so the result
+  // is the same as generating all levels at once. The levels are merged into
+  // one set of contours, which keeps them in order for the geojson.
+  template <class grid_t>
+  auto generate_contours(const grid_t& grid, const std::vector<float>& contours,
+                         const bool polygons, const float denoise,
+                         const float generalize, const uint32_t thread_count)
+      -> decltype(grid->GenerateContours(contours, polygons, denoise, generalize)) {
+    if (thread_count < 2 || contours.size() < 2)
+      return grid->GenerateContours(contours, polygons, denoise, generalize);
+
+    using contours_t = decltype(grid->GenerateContours(contours, polygons, denoise, generalize));
+    std::vector<contours_t> levels(contours.size());
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+      for (size_t i = next++; i < contours.size(); i = next++)
+        levels[i] = grid->GenerateContours({contours[i]}, polygons, denoise, generalize);
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min<size_t>(thread_count, contours.size()); ++i)
+      threads.emplace_back(work);
+    work();
+    for (auto& thread : threads)
+      thread.join();
+
+    auto isolines = std::move(levels.front());
+    for (size_t i = 1; i < levels.size(); ++i) {
+      for (auto& level : levels[i])
+        isolines.emplace(level.first, std::move(level.second));
+    }
+    return isolines;
+  }
+
+  // Serialize the reached edges as a GeoJSON feature collection. The text is
+  // written to the stream one edge at a time rather than building a json
+  // document first (the response body is still formed in full before it is
+  // sent). Each feature is the edge shape (in the direction of the edge) with
+  // its way id, times (seconds) and the portion of the edge reached. Shapes
+  // come from the shape cache when there is one. Edges whose tile can not be
+  // found are skipped.
+  void serialize_edges(const std::vector<valhalla::thor::ReachedEdge>& edges,
+                       valhalla::baldr::GraphReader& reader,
+                       valhalla::thor::ShapeCache* shape_cache,
+                       const boost::optional<std::string>& id,
+                       std::ostream& stream) {
+    stream << std::fixed << "{\"type\":\"FeatureCollection\",";
+    if (id) {
+      stream << "\"id\":\"";
+      for (const auto c : *id) {
+        if (c == '"' || c == '\\')
+          stream << '\\';
+        stream << c;
+      }
+      stream << "\",";
+    }
+    stream << "\"features\":[";
+    bool first = true;
+    for (const auto& reached : edges) {
+      const auto* tile = reader.GetGraphTile(reached.edgeid);
+      if (tile == nullptr)
+        continue;
+      const auto* edge = tile->directededge(reached.edgeid);
+      auto edgeinfo = tile->edgeinfo(edge->edgeinfo_offset());
+      auto shape = shape_cache ? shape_cache->Get(tile, edge->edgeinfo_offset()) :
+          std::make_shared<const valhalla::thor::ShapeCache::Shape>(edgeinfo.shape());
+
+      stream << (first ? "" : ",") << "{\"type\":\"Feature\",\"geometry\":"
+             << "{\"type\":\"LineString\",\"coordinates\":[" << std::setprecision(6);
+      for (size_t i = 0; i < shape->size(); ++i) {
+        const auto& ll = edge->forward() ? (*shape)[i] : (*shape)[shape->size() - 1 - i];
+        stream << (i ? "," : "") << '[' << ll.lng() << ',' << ll.lat() << ']';
+      }
+      stream << "]},\"properties\":{\"way_id\":" << edgeinfo.wayid()
+             << ",\"edge_id\":" << reached.edgeid.value << std::setprecision(1)
+             << ",\"start_time\":" << reached.start_secs
+             << ",\"end_time\":" << reached.end_secs << std::setprecision(3)
+             << ",\"start_fraction\":" << reached.start_fraction
+             << ",\"end_fraction\":" << reached.end_fraction << "}}";
+      first = false;
+    }
+    stream << "]}";
+  }
+
+  // Write an unsigned integer of the given number of bytes in little endian
+  // byte order (regardless of the host byte order)
+  void write_little_endian(std::ostream& stream, uint64_t value, const size_t bytes) {
+    char buffer[sizeof(uint64_t)];
+    for (size_t i = 0; i < bytes; ++i) {
+      buffer[i] = static_cast<char>(value & 0xff);
+      value >>= 8;
+    }
+    stream.write(buffer, bytes);
+  }
+
+  // Write a float (IEEE 754 single precision) in little endian byte order
+  void write_little_endian(std::ostream& stream, const float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write_little_endian(stream, bits, sizeof(bits));
+  }
+
+  // Serialize the reached edges in a compact binary form: the number of
+  // edges (uint32) followed by a record per edge of the edge id (uint64),
+  // way id (uint64), start time, end time (seconds), start fraction and end
+  // fraction (floats). Values are little endian. Edges whose tile can not be
+  // found are skipped.
+  void serialize_edges_binary(const std::vector<valhalla::thor::ReachedEdge>& edges,
+                              valhalla::baldr::GraphReader& reader,
+                              std::ostream& stream) {
+    std::vector<std::pair<const valhalla::thor::ReachedEdge*,
+                          const valhalla::baldr::GraphTile*> > found;
+    found.reserve(edges.size());
+    for (const auto& reached : edges) {
+      const auto* tile = reader.GetGraphTile(reached.edgeid);
+      if (tile != nullptr)
+        found.emplace_back(&reached, tile);
+    }
+    write_little_endian(stream, found.size(), sizeof(uint32_t));
+    for (const auto& edge_tile : found) {
+      const auto& reached = *edge_tile.first;
+      const auto* tile = edge_tile.second;
+      const auto* edge = tile->directededge(reached.edgeid);
+      write_little_endian(stream, reached.edgeid.value, sizeof(uint64_t));
+      write_little_endian(stream, tile->edgeinfo(edge->edgeinfo_offset()).wayid(),
+                          sizeof(uint64_t));
+      write_little_endian(stream, reached.start_secs);
+      write_little_endian(stream, reached.end_secs);
+      write_little_endian(stream, reached.start_fraction);
+      write_little_endian(stream, reached.end_fraction);
+    }
+  }
+
+  // Skips forming the isotile while in scope, so the isochrone forms it
+  // again even if the computation throws
+  class SkipIsoTile {
+   public:
+    SkipIsoTile(valhalla::thor::Isochrone& isochrone)
+        : isochrone_(isochrone) {
+      isochrone_.set_form_isotile(false);
+    }
+    ~SkipIsoTile() {
+      isochrone_.set_form_isotile(true);
+    }
+   private:
+    valhalla::thor::Isochrone& isochrone_;
+  };
 }
 
 namespace valhalla {
@@ -34,18 +216,111 @@ namespace valhalla {
       auto polygons = request.get<bool>("polygons", false);
       auto denoise = std::max(std::min(request.get<float>("denoise", 1.f), 1.f), 0.f);
       auto generalize = request.get<float>("generalize", .2f);
+      auto reverse = request.get<bool>("reverse", false);
+
+      //output the edges reached within the highest contour time rather than contours.
+      //This skips forming the grid and generating the contours
+      auto output = request.get<std::string>("output", "contours");
+      if (output == "edges" || output == "edges_binary") {
+        unsigned int max_minutes = contours.back()+10;
+        {
+          SkipIsoTile skip(isochrone_gen);
+          if (costing == "multimodal" || costing == "transit")
+            isochrone_gen.ComputeMultiModal(correlated, max_minutes, reader, mode_costing, mode);
+          else if (reverse)
+            isochrone_gen.ComputeReverse(correlated, max_minutes, reader, mode_costing, mode);
+          else
+            isochrone_gen.Compute(correlated, max_minutes, reader, mode_costing, mode);
+        }
+        auto edges = isochrone_gen.ReachedEdges(contours.back(), reader);
+
+        std::stringstream stream;
+        worker_t::result_t result{false};
+        if (output == "edges_binary") {
+          serialize_edges_binary(edges, reader, stream);
+          http_response_t response(200, "OK", stream.str(), headers_t{CORS, BINARY_MIME});
+          response.from_info(request_info);
+          result.messages.emplace_back(response.to_string());
+        } else {
+          serialize_edges(edges, reader, shape_cache.get(),
+                          request.get_optional<std::string>("id"), stream);
+          http_response_t response(200, "OK", stream.str(), headers_t{CORS, JSON_MIME});
+          response.from_info(request_info);
+          result.messages.emplace_back(response.to_string());
+        }
+        return result;
+      }
+
+      //contours over a window of departure times (for multimodal only). Contours of the min,
+      //median and max time to reach each location over the departures are returned
+      auto window = request.get<unsigned int>("departure_window", 0);
+      if (window > 0 && (costing == "multimodal" || costing == "transit")) {
+        auto step = std::max(request.get<unsigned int>("departure_step", 1), 1u);
+        if ((window + step - 1) / step > isochrone_max_profile_departures)
+          throw std::invalid_argument("Invalid argument: departure_window exceeds " +
+                std::to_string(isochrone_max_profile_departures) + " departures");
+        unsigned int max_minutes = contours.back()+10;
+        auto profile = isochrone_gen.ComputeMultiModalProfile(correlated, max_minutes, window,
+                                                              step, reader, mode_costing, mode);
+        auto json = baldr::json::map({});
+        const std::vector<std::pair<std::string, std::shared_ptr<const GriddedData<PointLL> > > > grids{
+          {"min", profile.minimum}, {"median", profile.median}, {"max", profile.maximum}};
+        for (const auto& grid : grids) {
+          auto isolines = generate_contours(grid.second, contours, polygons, denoise, generalize,
+                                            isochrone_contour_threads);
+          json->emplace(grid.first, baldr::json::to_geojson<PointLL>(isolines, polygons, colors));
+        }
+        auto id = request.get_optional<std::string>("id");
+        if(id)
+          json->emplace("id", *id);
+        std::stringstream stream; stream << *json;
+
+        worker_t::result_t result{false};
+        http_response_t response(200, "OK", stream.str(), headers_t{CORS, JSON_MIME});
+        response.from_info(request_info);
+        result.messages.emplace_back(response.to_string());
+        return result;
+      }
 
       //get the raster
       //Extend the times in the 2-D grid to be 10 minutes beyond the highest contour time.
       //Cost (including penalties) is used when adding to the adjacency list but the elapsed
       //time in seconds is used when terminating the search. The + 10 minutes adds a buffer for edges
       //where there has been a higher cost that might still be marked in the isochrone
-      auto grid = (costing == "multimodal" || costing == "transit") ?
-        isochrone_gen.ComputeMultiModal(correlated, contours.back()+10, reader, mode_costing, mode) :
-        isochrone_gen.Compute(correlated, contours.back()+10, reader, mode_costing, mode);
+      //Reuse a cached grid from the same origins and costing if it extends far enough so
+      //that changing only the contour times or colors does not need another expansion
+      unsigned int max_minutes = contours.back()+10;
+      auto key = isotile_key(correlated, costing, request);
+      if (!key.empty())
+        key += reverse ? "|r" : "|f";
+      auto grid = key.empty() ? nullptr : isochrone_cache.Find(key, max_minutes);
+      if (!grid) {
+        if (costing == "multimodal" || costing == "transit")
+          grid = isochrone_gen.ComputeMultiModal(correlated, max_minutes, reader, mode_costing, mode);
+        else if (reverse)
+          grid = isochrone_gen.ComputeReverse(correlated, max_minutes, reader, mode_costing, mode);
+        else if (!isochrone_readers.empty() && correlated.size() > 1) {
+          //search groups of widely separated origins on their own threads, each with its
+          //own graph reader and costing
+          std::vector<baldr::GraphReader*> readers{&reader};
+          std::vector<sif::cost_ptr_t> costings{mode_costing[static_cast<uint32_t>(mode)]};
+          for (const auto& thread_reader : isochrone_readers) {
+            readers.push_back(thread_reader.get());
+            costings.push_back(get_costing(request, costing));
+          }
+          grid = isochrone_gen.ComputeParallel(correlated, max_minutes, readers, costings,
+                                               mode, isochrone_origin_group_distance);
+        }
+        else
+          grid = isochrone_gen.Compute(correlated, max_minutes, reader, mode_costing, mode,
+                                       isochrone_resume ? key : "");
+        if (!key.empty())
+          isochrone_cache.Insert(key, max_minutes, grid);
+      }
 
       //turn it into geojson
-      auto isolines = grid->GenerateContours(contours, polygons, denoise, generalize);
+      auto isolines = generate_contours(grid, contours, polygons, denoise, generalize,
+                                        isochrone_contour_threads);
       auto geojson = baldr::json::to_geojson<PointLL>(isolines, polygons, colors);
       auto id = request.get_optional<std::string>("id");
       if(id)
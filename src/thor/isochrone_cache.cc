@@ -0,0 +1,54 @@
+#include "thor/isochrone_cache.h"
+
+using namespace valhalla::midgard;
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+IsochroneCache::IsochroneCache(const uint32_t max_size)
+    : max_size_(max_size) {
+}
+
+// Find a cached isotile for the key that covers the specified time. Moves
+// the entry to the front of the list when found.
+std::shared_ptr<const GriddedData<PointLL> > IsochroneCache::Find(
+          const std::string& key, const unsigned int max_minutes) {
+  for (auto entry = entries_.begin(); entry != entries_.end(); ++entry) {
+    if (entry->key == key) {
+      if (entry->max_minutes < max_minutes) {
+        return nullptr;
+      }
+      entries_.splice(entries_.begin(), entries_, entry);
+      return entries_.front().isotile;
+    }
+  }
+  return nullptr;
+}
+
+// Add an isotile to the cache, replacing any with the same key and evicting
+// the least recently used isotile if the cache is full.
+void IsochroneCache::Insert(const std::string& key, const unsigned int max_minutes,
+              const std::shared_ptr<const GriddedData<PointLL> >& isotile) {
+  if (max_size_ == 0) {
+    return;
+  }
+  for (auto entry = entries_.begin(); entry != entries_.end(); ++entry) {
+    if (entry->key == key) {
+      entries_.erase(entry);
+      break;
+    }
+  }
+  entries_.push_front({key, max_minutes, isotile});
+  if (entries_.size() > max_size_) {
+    entries_.pop_back();
+  }
+}
+
+// Remove all isotiles from the cache.
+void IsochroneCache::Clear() {
+  entries_.clear();
+}
+
+}
+}
@@ -0,0 +1,296 @@
+#include "thor/local_search_optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <valhalla/midgard/logging.h>
+
+namespace {
+
+// Minimum cost reduction for a move to count as an improvement. Avoids
+// cycling between moves that differ only by floating point error.
+constexpr double kMinImprovement = 1e-6;
+
+// Longest run of consecutive locations considered by an Or-opt move
+constexpr uint32_t kMaxOrOptLength = 3;
+
+// Number of perturbations (per location) without improvement before a
+// chain restarts from a new random tour
+constexpr uint32_t kRestartFactor = 4;
+
+// Number of consecutive restarts that do not improve the best tour before
+// the chain stops. Small problems converge well before the time limit.
+constexpr uint32_t kMaxStaleRestarts = 3;
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * A single local search chain. The tour keeps the first and last locations
+ * fixed. Forward and reverse prefix costs along the tour allow the cost of
+ * reversing a segment to be computed in constant time with asymmetric costs.
+ */
+class SearchChain {
+ public:
+  SearchChain(const uint32_t count, const std::vector<float>& costs,
+              const uint64_t seed, const Clock::time_point deadline)
+      : count_(count),
+        costs_(costs),
+        random_generator_(seed),
+        deadline_(deadline),
+        forward_costs_(count, 0.0),
+        reverse_costs_(count, 0.0),
+        best_cost_(0.0) {
+  }
+
+  // Run the chain until the deadline or the iteration limit is reached.
+  void Run(const uint32_t max_iterations) {
+    RandomTour();
+    LocalSearch();
+    best_tour_ = tour_;
+    best_cost_ = forward_costs_.back();
+
+    // A perturbation needs at least 3 locations between the fixed ends
+    if (count_ < 5) {
+      return;
+    }
+
+    // Current chain: perturb the best tour of the chain and keep the result
+    // if it improves. Restart with a new random tour when the chain stops
+    // improving.
+    std::vector<uint32_t> chain_tour = tour_;
+    double chain_cost = best_cost_;
+    uint32_t no_improvement = 0;
+    uint32_t stale_restarts = 0;
+    double restart_best_cost = best_cost_;
+    for (uint32_t n = 0; max_iterations == 0 || n < max_iterations; n++) {
+      if (Clock::now() >= deadline_) {
+        break;
+      }
+
+      // Restart when the chain stops improving. Stop when several restarts
+      // in a row have not improved the best tour.
+      bool restart = no_improvement >= kRestartFactor * count_;
+      if (restart) {
+        if (best_cost_ < restart_best_cost - kMinImprovement) {
+          stale_restarts = 0;
+        } else if (++stale_restarts >= kMaxStaleRestarts) {
+          break;
+        }
+        restart_best_cost = best_cost_;
+        RandomTour();
+      } else {
+        tour_ = chain_tour;
+        Perturb();
+        UpdatePrefixCosts(0);
+      }
+      LocalSearch();
+
+      // Start a new chain on restart, otherwise keep the tour if it improves
+      // the current chain.
+      double cost = forward_costs_.back();
+      if (restart || cost < chain_cost - kMinImprovement) {
+        chain_tour = tour_;
+        chain_cost = cost;
+        no_improvement = 0;
+      } else {
+        no_improvement++;
+      }
+      if (cost < best_cost_ - kMinImprovement) {
+        best_tour_ = tour_;
+        best_cost_ = cost;
+      }
+    }
+  }
+
+  const std::vector<uint32_t>& best_tour() const {
+    return best_tour_;
+  }
+
+  double best_cost() const {
+    return best_cost_;
+  }
+
+ protected:
+  uint32_t count_;
+  const std::vector<float>& costs_;
+  std::mt19937_64 random_generator_;
+  Clock::time_point deadline_;
+  std::vector<uint32_t> tour_;
+  std::vector<double> forward_costs_;
+  std::vector<double> reverse_costs_;
+  std::vector<uint32_t> best_tour_;
+  double best_cost_;
+
+  double Cost(const uint32_t loc1, const uint32_t loc2) const {
+    return costs_[(loc1 * count_) + loc2];
+  }
+
+  // Create a random tour with the first and last locations fixed
+  void RandomTour() {
+    tour_.resize(count_);
+    for (uint32_t i = 0; i < count_; i++) {
+      tour_[i] = i;
+    }
+    std::shuffle(tour_.begin() + 1, tour_.end() - 1, random_generator_);
+    UpdatePrefixCosts(0);
+  }
+
+  // Update the forward and reverse prefix costs from the tour index
+  void UpdatePrefixCosts(const uint32_t index) {
+    for (uint32_t i = index; i < count_ - 1; i++) {
+      forward_costs_[i+1] = forward_costs_[i] + Cost(tour_[i], tour_[i+1]);
+      reverse_costs_[i+1] = reverse_costs_[i] + Cost(tour_[i+1], tour_[i]);
+    }
+  }
+
+  // Double bridge perturbation of the locations between the fixed ends:
+  // segments A B C D become A C B D.
+  void Perturb() {
+    std::uniform_int_distribution<uint32_t> dist(1, count_ - 2);
+    uint32_t cut[3];
+    do {
+      cut[0] = dist(random_generator_);
+      cut[1] = dist(random_generator_);
+      cut[2] = dist(random_generator_);
+      std::sort(cut, cut + 3);
+    } while (cut[0] == cut[1] || cut[1] == cut[2]);
+    std::rotate(tour_.begin() + cut[0], tour_.begin() + cut[1],
+                tour_.begin() + cut[2] + 1);
+  }
+
+  // Apply improving moves until none remain or the deadline is reached
+  void LocalSearch() {
+    bool improved = true;
+    while (improved && Clock::now() < deadline_) {
+      improved = TwoOpt();
+      improved = OrOpt() || improved;
+    }
+  }
+
+  // Reverse the segment between tour indexes i and j where it reduces the
+  // tour cost. Returns true if any improving move was applied.
+  bool TwoOpt() {
+    bool improved = false;
+    for (uint32_t i = 1; i < count_ - 2; i++) {
+      if (Clock::now() >= deadline_) {
+        break;
+      }
+      for (uint32_t j = i + 1; j < count_ - 1; j++) {
+        double delta = Cost(tour_[i-1], tour_[j]) + Cost(tour_[i], tour_[j+1])
+                     - Cost(tour_[i-1], tour_[i]) - Cost(tour_[j], tour_[j+1])
+                     - (forward_costs_[j] - forward_costs_[i])
+                     + (reverse_costs_[j] - reverse_costs_[i]);
+        if (delta < -kMinImprovement) {
+          std::reverse(tour_.begin() + i, tour_.begin() + j + 1);
+          UpdatePrefixCosts(i - 1);
+          improved = true;
+        }
+      }
+    }
+    return improved;
+  }
+
+  // Move a run of up to kMaxOrOptLength consecutive locations to another
+  // position in the tour (keeping their order) where it reduces the tour
+  // cost. Returns true if any improving move was applied.
+  bool OrOpt() {
+    bool improved = false;
+    for (uint32_t len = 1; len <= kMaxOrOptLength; len++) {
+      for (uint32_t i = 1; i + len < count_; i++) {
+        // Segment is tour_[i] to tour_[i+len-1]. Get the cost saved by
+        // removing it and joining its neighbors.
+        uint32_t first = tour_[i];
+        uint32_t last  = tour_[i+len-1];
+        uint32_t prev  = tour_[i-1];
+        uint32_t next  = tour_[i+len];
+        double removed = Cost(prev, first) + Cost(last, next) - Cost(prev, next);
+
+        // Insert between tour_[k] and tour_[k+1]
+        for (uint32_t k = 0; k < count_ - 1; k++) {
+          if (k + 1 >= i && k < i + len) {
+            continue;
+          }
+          double added = Cost(tour_[k], first) + Cost(last, tour_[k+1]) -
+                         Cost(tour_[k], tour_[k+1]);
+          if (added - removed < -kMinImprovement) {
+            if (k < i) {
+              std::rotate(tour_.begin() + k + 1, tour_.begin() + i,
+                          tour_.begin() + i + len);
+              UpdatePrefixCosts(k);
+            } else {
+              std::rotate(tour_.begin() + i, tour_.begin() + i + len,
+                          tour_.begin() + k + 1);
+              UpdatePrefixCosts(i - 1);
+            }
+            improved = true;
+            break;
+          }
+        }
+      }
+    }
+    return improved;
+  }
+};
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+LocalSearchOptimizer::LocalSearchOptimizer(const uint32_t thread_count,
+                                           const uint32_t time_limit)
+    : thread_count_(std::max(thread_count, 1u)),
+      time_limit_(time_limit),
+      max_iterations_(kDefaultOptimizerMaxIterations),
+      seed_(kDefaultOptimizerSeed),
+      seeded_(false),
+      exact_max_count_(kDefaultExactMaxCount) {
+}
+
+// Optimize the tour through a set of locations given the cost matrix
+// among all locations. The first location (origin) and last location
+// (destination) remain fixed in the tour.
+std::vector<uint32_t> LocalSearchOptimizer::Solve(const uint32_t count,
+                                   const std::vector<float>& costs) {
+  // Handle trivial cases and solve small tours exactly.
+  if (count <= 3 || count <= exact_max_count_) {
+    return ExactTour(count, costs);
+  }
+
+  // Set up a chain for each thread. Run the first chain on this thread.
+  // Seeded searches with an iteration limit have no deadline so the result
+  // does not depend on the machine or its load.
+  Clock::time_point deadline = (seeded_ && max_iterations_ > 0) ?
+      Clock::time_point::max() :
+      Clock::now() + std::chrono::milliseconds(time_limit_);
+  std::vector<SearchChain> chains;
+  chains.reserve(thread_count_);
+  for (uint32_t i = 0; i < thread_count_; i++) {
+    chains.emplace_back(count, costs, seed_ + i, deadline);
+  }
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < thread_count_; i++) {
+    threads.emplace_back(&SearchChain::Run, &chains[i], max_iterations_);
+  }
+  chains[0].Run(max_iterations_);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Return the best tour. Ties go to the lowest chain index so results are
+  // repeatable.
+  uint32_t best = 0;
+  for (uint32_t i = 1; i < thread_count_; i++) {
+    if (chains[i].best_cost() < chains[best].best_cost() - kMinImprovement) {
+      best = i;
+    }
+  }
+  LOG_DEBUG("Best tour cost = " + std::to_string(chains[best].best_cost()) +
+            " chain = " + std::to_string(best));
+  return chains[best].best_tour();
+}
+
+}
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <stdexcept>
 #include <prime_server/prime_server.hpp>
 
 using namespace prime_server;
@@ -58,10 +60,26 @@ namespace {
     return input_locs;
   }
 
+  // Order of the time distances from start_td, optionally sorted by time.
+  // Not found (max cost) entries sort last.
+  std::vector<size_t> td_order(const std::vector<TimeDistance>& tds, size_t start_td,
+      const size_t td_count, const size_t stride, const bool sort_by_time) {
+    std::vector<size_t> order;
+    for(size_t i = 0; i < td_count; ++i)
+      order.push_back(start_td + i * stride);
+    if (sort_by_time) {
+      std::stable_sort(order.begin(), order.end(), [&tds](const size_t a, const size_t b) {
+        return tds[a].time < tds[b].time;
+      });
+    }
+    return order;
+  }
+
   json::ArrayPtr serialize_row(const std::vector<TimeDistance>& tds,
-      size_t start_td, const size_t td_count, const size_t source_index, const size_t target_index, double distance_scale) {
+      size_t start_td, const size_t td_count, const size_t source_index, const size_t target_index,
+      double distance_scale, const bool sort_by_time) {
     auto row = json::array({});
-    for(size_t i = start_td; i < start_td + td_count; ++i) {
+    for(auto i : td_order(tds, start_td, td_count, 1, sort_by_time)) {
       //check to make sure a route was found; if not, return null for distance & time in matrix result
       if (tds[i].time != kMaxCost) {
         row->emplace_back(json::map({
@@ -82,12 +100,17 @@ namespace {
     return row;
   }
 
-  json::MapPtr serialize(const std::string action, const boost::optional<std::string>& id, const std::vector<PathLocation>& correlated_s, const std::vector<PathLocation>& correlated_t, const std::vector<TimeDistance>& tds, std::string& units, double distance_scale) {
+  json::MapPtr serialize(const std::string action, const boost::optional<std::string>& id, const std::vector<PathLocation>& correlated_s, const std::vector<PathLocation>& correlated_t, const std::vector<TimeDistance>& tds, std::string& units, double distance_scale, const bool sort_by_time) {
+    // When sorting by time a many_to_one matrix has its rows sorted while
+    // any other matrix has the entries of each row sorted
     json::ArrayPtr matrix = json::array({});
-    for(size_t source_index = 0; source_index < correlated_s.size(); ++source_index) {
+    bool sort_rows = sort_by_time && action == "many_to_one";
+    for(auto td_index : td_order(tds, 0, correlated_s.size(), correlated_t.size(), sort_rows)) {
+        size_t source_index = td_index / correlated_t.size();
         matrix->emplace_back(
           serialize_row(tds, source_index * correlated_t.size(), correlated_t.size(),
-                        source_index, action == "many_to_one" ? correlated_s.size()-1 : 0, distance_scale));
+                        source_index, action == "many_to_one" ? correlated_s.size()-1 : 0, distance_scale,
+                        sort_by_time && !sort_rows));
     }
     auto json = json::map({
       {action, matrix},
@@ -126,47 +149,86 @@ namespace valhalla {
       if (units == "mi")
         distance_scale = kMilePerMeter;
 
+      // Parse out the optional time (seconds) and distance (in the requested
+      // units) limits. Searches are pruned beyond these and any pairs further
+      // apart are returned as null.
+      float max_time = request.get<float>("max_time", kMaxCost);
+      float max_distance = kMaxCost;
+      auto request_max_distance = request.get_optional<float>("max_distance");
+      if (request_max_distance) {
+        max_distance = *request_max_distance / distance_scale;
+      }
+      if (max_time <= 0.0f || max_distance <= 0.0f) {
+        throw std::invalid_argument("Invalid argument: max_time and max_distance must be positive");
+      }
+
       json::MapPtr json;
       //do the real work
       std::vector<TimeDistance> time_distances;
       auto costmatrix = [&]() {
         thor::CostMatrix matrix;
-        return matrix.SourceToTarget(correlated_s, correlated_t, reader, mode_costing, mode);
+        matrix.set_speed_store(speed_store, speed_level);
+        return matrix.SourceToTarget(correlated_s, correlated_t, reader, mode_costing, mode,
+                                     max_time, max_distance);
       };
       auto timedistancematrix = [&]() {
         thor::TimeDistanceMatrix matrix;
-        return matrix.SourceToTarget(correlated_s, correlated_t, reader, mode_costing, mode);
+        matrix.set_speed_store(speed_store, speed_level);
+        return matrix.SourceToTarget(correlated_s, correlated_t, reader, mode_costing, mode,
+                                     max_time, max_distance);
       };
-      switch (source_to_target_algorithm) {
-      case SELECT_OPTIMAL:
-        if (correlated_s.size() + correlated_t.size() > 100) {
-          time_distances = timedistancematrix();
+      // Parse out the optional number of nearest locations to find. This is
+      // only supported for one_to_many and many_to_one, and the results are
+      // returned sorted by time.
+      uint32_t k_nearest = request.get<uint32_t>("nearest", 0);
+      bool one_to_many = action == ONE_TO_MANY && correlated_s.size() == 1;
+      bool many_to_one = action == MANY_TO_ONE && correlated_t.size() == 1;
+      if (!one_to_many && !many_to_one) {
+        k_nearest = 0;
+      }
+
+      if (k_nearest > 0) {
+        thor::TimeDistanceMatrix matrix;
+        matrix.set_speed_store(speed_store, speed_level);
+        if (one_to_many) {
+          time_distances = matrix.OneToMany(correlated_s.front(), correlated_t, reader,
+                                mode_costing, mode, max_time, max_distance, k_nearest);
         } else {
-          time_distances = costmatrix();
+          time_distances = matrix.ManyToOne(correlated_t.front(), correlated_s, reader,
+                                mode_costing, mode, max_time, max_distance, k_nearest);
         }
-        /** TODO - test performance of TimeDistanceMatrix vs. CostMatrix for various
-            modes and conditions (e.g. number of locations, distances between
-            locations)
-          switch (mode) {
-          case TravelMode::kPedestrian:
-          case TravelMode::kBicycle:
+      } else {
+        switch (source_to_target_algorithm) {
+        case SELECT_OPTIMAL:
+          if (correlated_s.size() + correlated_t.size() > 100) {
             time_distances = timedistancematrix();
-            break;
-          default:
+          } else {
             time_distances = costmatrix();
           }
-        } */
-        break;
-      case COST_MATRIX:
-        time_distances = costmatrix();
-        break;
-      case TIME_DISTANCE_MATRIX: {
-        time_distances = timedistancematrix();
-        break;
-      }
+          /** TODO - test performance of TimeDistanceMatrix vs. CostMatrix for various
+              modes and conditions (e.g. number of locations, distances between
+              locations)
+            switch (mode) {
+            case TravelMode::kPedestrian:
+            case TravelMode::kBicycle:
+              time_distances = timedistancematrix();
+              break;
+            default:
+              time_distances = costmatrix();
+            }
+          } */
+          break;
+        case COST_MATRIX:
+          time_distances = costmatrix();
+          break;
+        case TIME_DISTANCE_MATRIX: {
+          time_distances = timedistancematrix();
+          break;
+        }
+        }
       }
       json = serialize(matrix_type, request.get_optional<std::string>("id"), correlated_s, correlated_t,
-        time_distances, units, distance_scale);
+        time_distances, units, distance_scale, k_nearest > 0);
 
       //jsonp callback if need be
       std::ostringstream stream;
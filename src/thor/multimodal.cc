@@ -8,42 +8,20 @@
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
 
-namespace {
-
-// Method to get an operator Id from a map of operator strings vs. Id.
-uint32_t GetOperatorId(const GraphTile* tile, uint32_t routeid,
-            std::unordered_map<std::string, uint32_t>& operators) {
-  const TransitRoute* transit_route = tile->GetTransitRoute(routeid);
-
-  // Test if the transit operator changed
-  if (transit_route && transit_route->op_by_onestop_id_offset()) {
-    // Get the operator name and look up in the operators map
-    std::string operator_name =
-        tile->GetName(transit_route->op_by_onestop_id_offset());
-    auto operator_itr = operators.find(operator_name);
-    if (operator_itr == operators.end()) {
-      // Operator not found - add to the map
-      uint32_t id = operators.size() + 1;
-      operators[operator_name] = id;
-      return id;
-    } else {
-      return operator_itr->second;
-    }
-  }
-  return 0;
-}
-
-}
-
 namespace valhalla {
 namespace thor {
 
 constexpr uint64_t kInitialEdgeLabelCount = 200000;
 
+// Size to reserve for the edge status of the walk to a transit stop
+constexpr uint32_t kWalkEdgeStatusSize = 20000;
+
 // Default constructor
 MultiModalPathAlgorithm::MultiModalPathAlgorithm()
     : AStarPathAlgorithm(),
-      walking_distance_(0) {
+      walking_distance_(0),
+      max_walking_distance_(0),
+      transit_operators_(new TransitOperators()) {
 }
 
 // Destructor
@@ -146,7 +124,6 @@ std::vector<PathInfo> MultiModalPathAlgorithm::GetBestPath(
   uint32_t blockid, tripid;
   uint32_t nc = 0;       // Count of iterations with no convergence
                          // towards destination
-  std::unordered_map<std::string, uint32_t> operators;
   std::unordered_set<uint32_t> processed_tiles;
 
   const GraphTile* tile;
@@ -369,14 +346,13 @@ std::vector<PathInfo> MultiModalPathAlgorithm::GetBestPath(
             }
 
             // Get the operator Id
-            operator_id = GetOperatorId(tile, departure->routeid(), operators);
+            operator_id = transit_operators_->GetOperatorId(tile, departure->routeid());
 
             // Add transfer penalty and operator change penalty
             newcost.cost += transfer_cost.cost;
             if (pred.transit_operator() > 0 &&
                 pred.transit_operator() != operator_id) {
-              // TODO - create a configurable operator change penalty
-              newcost.cost += 300;
+              newcost.cost += kOperatorChangePenalty;
             }
           }
 
@@ -509,13 +485,24 @@ bool MultiModalPathAlgorithm::CanReachDestination(const PathLocation& destinatio
   // Assume pedestrian mode for now
   mode_ = dest_mode;
 
-  // Local edge labels and edge status info
-  EdgeStatus edgestatus;
+  // Check the stop index first. Walking distance is at least the straight
+  // line distance, so there is no need to walk if there are no stops within
+  // the maximum walking distance of the pedestrian costing. Otherwise walk,
+  // since even a nearby stop may be cut off by barriers.
+  if (max_walking_distance_ > 0 &&
+      !stop_index_.HasStopWithin(graphreader, destination.latlng_,
+                                 max_walking_distance_)) {
+    return false;
+  }
+
+  // Local edge labels and edge status info. The walk is bounded so reserve
+  // much less edge status than for a path search.
+  EdgeStatus edgestatus(kWalkEdgeStatusSize);
   std::vector<EdgeLabel> edgelabels;
 
   // Set up lambda to get sort costs (use the local edgelabels, not the class
   // member!)
-  const auto edgecost = [edgelabels](const uint32_t label) {
+  const auto edgecost = [&edgelabels](const uint32_t label) {
     return edgelabels[label].sortcost();
   };
 
@@ -2,6 +2,9 @@
 
 using namespace prime_server;
 
+#include <fstream>
+#include <iomanip>
+
 #include <valhalla/midgard/logging.h>
 #include <valhalla/midgard/constants.h>
 #include <valhalla/baldr/json.h>
@@ -11,6 +14,7 @@ using namespace prime_server;
 
 #include "thor/service.h"
 #include "thor/optimizer.h"
+#include "thor/local_search_optimizer.h"
 #include "thor/costmatrix.h"
 
 using namespace valhalla;
@@ -25,6 +29,24 @@ namespace {
   const headers_t::value_type JSON_MIME{"Content-type", "application/json;charset=utf-8"};
   const headers_t::value_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
 
+  // Record the cost matrix sent to the optimizer as an instance for
+  // bench/optimizer_quality: the number of locations followed by the
+  // row-major costs
+  void record_matrix(const std::string& dir, const size_t count,
+                     const std::vector<float>& costs) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    std::string path = dir + "/optimized_route_" +
+        std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(now).count()) +
+        "_" + std::to_string(count) + ".matrix";
+    std::ofstream file(path);
+    file << count << std::setprecision(9);
+    for (size_t i = 0; i < costs.size(); ++i)
+      file << ((i % count == 0) ? '\n' : ' ') << costs[i];
+    file << '\n';
+    if (!file)
+      LOG_WARN("thor::optimized_route could not record cost matrix::" + path);
+  }
+
 }
 
 namespace valhalla {
@@ -45,6 +67,7 @@ namespace valhalla {
 
     // Use CostMatrix to find costs from each location to every other location
     CostMatrix costmatrix;
+    costmatrix.set_speed_store(speed_store, speed_level);
     std::vector<thor::TimeDistance> td = costmatrix.SourceToTarget(correlated_s, correlated_t, reader, mode_costing, mode);
 
     // Return an error if any locations are totally unreachable
@@ -65,16 +88,42 @@ namespace valhalla {
       time_costs.emplace_back(static_cast<float>(td[i].time));
     }
 
-    Optimizer optimizer;
+    if (!optimizer_record_dir.empty())
+      record_matrix(optimizer_record_dir, correlated.size(), time_costs);
+
     //returns the optimal order of the path_locations
-    auto order = optimizer.Solve(correlated.size(), time_costs);
+    std::vector<uint32_t> order;
+    if (optimizer_algorithm == LOCAL_SEARCH) {
+      // The request may lower the time limit (milliseconds) but not raise it
+      auto time_limit = std::min(optimizer_time_limit,
+        request.get<uint32_t>("optimizer_time_limit", optimizer_time_limit));
+      LocalSearchOptimizer optimizer(optimizer_threads, time_limit);
+      if (optimizer_seed)
+        optimizer.Seed(*optimizer_seed);
+      optimizer.set_max_iterations(optimizer_max_iterations);
+      optimizer.set_exact_max_count(optimizer_exact_max_count);
+      order = optimizer.Solve(correlated.size(), time_costs);
+    } else {
+      Optimizer optimizer;
+      optimizer.set_exact_max_count(optimizer_exact_max_count);
+      order = optimizer.Solve(correlated.size(), time_costs);
+    }
     std::vector<PathLocation> best_order;
     for (size_t i = 0; i< order.size(); i++)
       best_order.emplace_back(correlated[order[i]]);
 
-    auto trippaths = path_depart_at(best_order, costing, date_time_type, request_str);
-    for (const auto &trippath: trippaths)
-      result.messages.emplace_back(trippath.SerializeAsString());
+    // Form the path for each leg from the cost matrix search trees so the
+    // legs do not need to be routed again. Any leg without a path (e.g. the
+    // same location) is routed as usual.
+    std::vector<std::vector<thor::PathInfo>> leg_paths;
+    if (correlated_s.size() == correlated.size() && correlated_t.size() == correlated.size()) {
+      for (size_t i = 1; i < order.size(); i++)
+        leg_paths.emplace_back(costmatrix.FormPath(order[i-1], order[i]));
+    }
+
+    auto trippaths = path_depart_at(best_order, costing, date_time_type, request_str, leg_paths);
+    for (const auto* trippath: trippaths)
+      result.messages.emplace_back(trippath->SerializeAsString());
 
     //get processing time for thor
     auto e = std::chrono::system_clock::now();
@@ -1,3 +1,4 @@
+#include <limits>
 #include "thor/optimizer.h"
 #include <valhalla/midgard/logging.h>
 
@@ -22,10 +23,18 @@ std::vector<uint32_t> Optimizer::Solve(const uint32_t count,
     return (TourCost(costs, tour1) < TourCost(costs, tour2)) ? tour1 : tour2;
   }
 
+  // Solve small tours exactly
+  if (count_ <= exact_max_count_) {
+    return ExactTour(count_, costs);
+  }
+
   // Populate the initial tour with a random order. The first and last
   // locations must remain fixed as the tour begin and end locations do not
   // change.
   CreateRandomTour();
+  forward_costs_.assign(count_, 0.0);
+  reverse_costs_.assign(count_, 0.0);
+  UpdatePrefixCosts(costs, 0);
 
   // Copy current tour to best tour and get the tour cost. Set the initial
   // temperature based on tour cost
@@ -85,8 +94,11 @@ uint32_t Optimizer::Anneal(const std::vector<float>& costs, float temperature) {
       }
       success_count++;
 
-      // Get the tour cost and update the best tour if less cost
-      float cost = TourCost(costs, tour_);
+      // Update the prefix costs from the start of the alteration. The tour
+      // cost is the last forward prefix cost. Update the best tour if less
+      // cost.
+      UpdatePrefixCosts(costs, alteration.start - 1);
+      float cost = forward_costs_.back();
       if (cost < best_cost_) {
         best_cost_ = cost;
         best_tour_ = tour_;
@@ -105,7 +117,7 @@ void Optimizer::CreateRandomTour() {
   for (uint32_t i = 1; i < count_ - 1; i++) {
     tour_.push_back(i);
   }
-  std::random_shuffle(tour_.begin(), tour_.end());
+  std::shuffle(tour_.begin(), tour_.end(), random_generator_);
   tour_.insert(tour_.begin(), 0);
   tour_.push_back(count_ - 1);
 }
@@ -152,22 +164,103 @@ float Optimizer::TemperatureDifference(const std::vector<float>& costs,
     c += Cost(costs, tour_[end], tour_[start]);
     c += Cost(costs, tour_[end-1], tour_[start]);
   } else {
-    // Reverse tour locations between a start and an end index.
-    // Subtract costs between successive locations from start-1 to end+1
-    for (uint32_t i = start - 1, j = i+1; i <= end; i++, j++) {
-      c -= Cost(costs, tour_[i], tour_[j]);
-    }
-
-    // Add costs for the new connections and the reversed order
+    // Reverse tour locations between a start and an end index. Subtract
+    // the connections broken at start-1 and end+1 and add the new ones.
+    c -= Cost(costs, tour_[start-1], tour_[start]);
+    c -= Cost(costs, tour_[end], tour_[end+1]);
     c += Cost(costs, tour_[start-1], tour_[end]);
     c += Cost(costs, tour_[start], tour_[end+1]);
-    for (uint32_t i = end, j = i-1; i > start; i--, j--) {
-      c += Cost(costs, tour_[i], tour_[j]);
-    }
+
+    // Replace the cost of traversing start to end with the cost of the
+    // reversed order using the prefix costs (costs may be asymmetric).
+    c -= static_cast<float>(forward_costs_[end] - forward_costs_[start]);
+    c += static_cast<float>(reverse_costs_[end] - reverse_costs_[start]);
   }
   return (c / static_cast<float>(count_));
 }
 
+// Update the forward and reverse prefix costs of the current tour from
+// the specified tour index to the end of the tour.
+void Optimizer::UpdatePrefixCosts(const std::vector<float>& costs,
+                                  const uint32_t index) {
+  for (uint32_t i = index; i < count_ - 1; i++) {
+    forward_costs_[i+1] = forward_costs_[i] + Cost(costs, tour_[i], tour_[i+1]);
+    reverse_costs_[i+1] = reverse_costs_[i] + Cost(costs, tour_[i+1], tour_[i]);
+  }
+}
+
+// Exact tour optimization using the Held-Karp dynamic programming method.
+std::vector<uint32_t> ExactTour(const uint32_t count,
+                                const std::vector<float>& costs) {
+  // Handle trivial cases.
+  if (count <= 3) {
+    std::vector<uint32_t> tour(count);
+    for (uint32_t i = 0; i < count; i++) {
+      tour[i] = i;
+    }
+    return tour;
+  }
+
+  // Locations between the fixed origin and destination are indexed from 0
+  // (location 1) to n-1 (location count-2). cost[set * n + j] is the least
+  // cost path from the origin through the locations in the set (bitmask)
+  // ending at location j. pred stores the location prior to j on that path.
+  const uint32_t n = count - 2;
+  const uint32_t nsets = 1 << n;
+  const uint32_t destination = count - 1;
+  std::vector<float> cost(nsets * n, std::numeric_limits<float>::max());
+  std::vector<uint8_t> pred(nsets * n, 0);
+  for (uint32_t j = 0; j < n; j++) {
+    cost[(1 << j) * n + j] = costs[j + 1];
+  }
+  for (uint32_t set = 1; set < nsets; set++) {
+    for (uint32_t j = 0; j < n; j++) {
+      float c = cost[set * n + j];
+      if (!(set & (1 << j)) || c == std::numeric_limits<float>::max()) {
+        continue;
+      }
+
+      // Extend the path to each location not yet in the set
+      const float* from_j = &costs[(j + 1) * count + 1];
+      for (uint32_t k = 0; k < n; k++) {
+        if (set & (1 << k)) {
+          continue;
+        }
+        uint32_t idx = (set | (1 << k)) * n + k;
+        float newcost = c + from_j[k];
+        if (newcost < cost[idx]) {
+          cost[idx] = newcost;
+          pred[idx] = j;
+        }
+      }
+    }
+  }
+
+  // Find the best last location before the destination
+  uint32_t set = nsets - 1;
+  uint32_t last = 0;
+  float best = std::numeric_limits<float>::max();
+  for (uint32_t j = 0; j < n; j++) {
+    float c = cost[set * n + j] + costs[(j + 1) * count + destination];
+    if (c < best) {
+      best = c;
+      last = j;
+    }
+  }
+
+  // Walk the predecessors back to form the tour
+  std::vector<uint32_t> tour(count);
+  tour[0] = 0;
+  tour[destination] = destination;
+  for (uint32_t i = n; i > 0; i--) {
+    tour[i] = last + 1;
+    uint32_t prior = pred[set * n + last];
+    set &= ~(1 << last);
+    last = prior;
+  }
+  return tour;
+}
+
 // Get the cost for the specified tour (order of locations).
 float Optimizer::TourCost(const std::vector<float>& costs,
                           const std::vector<uint32_t>& tour) const {
@@ -0,0 +1,662 @@
+#include <algorithm>
+#include <limits>
+#include <valhalla/baldr/datetime.h>
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/midgard/logging.h>
+#include "thor/raptor.h"
+#include "thor/edgestatus.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Size to reserve for the edge status of a walk. Walks are limited by the
+// walking distance so reserve much less than for a path search.
+constexpr uint32_t kWalkEdgeStatusSize = 20000;
+
+// Check if an edge is a transition edge. Transition edges are optional in a
+// path and are left out of each walking leg (the egress walk cannot include
+// them since they have no opposing edge).
+bool IsTransition(GraphReader& graphreader, const GraphId& edgeid) {
+  const DirectedEdge* edge = graphreader.GetGraphTile(edgeid)->directededge(edgeid);
+  return edge->trans_up() || edge->trans_down();
+}
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Default constructor
+RaptorPathAlgorithm::RaptorPathAlgorithm()
+    : PathAlgorithm(),
+      date_set_(false),
+      day_(0),
+      dow_(0),
+      date_before_tile_(false),
+      transit_operators_(new TransitOperators()) {
+}
+
+// Destructor
+RaptorPathAlgorithm::~RaptorPathAlgorithm() {
+  Clear();
+}
+
+// Clear the temporary information generated during path construction.
+void RaptorPathAlgorithm::Clear() {
+  access_.edgelabels.clear();
+  access_.stops.clear();
+  egress_.edgelabels.clear();
+  egress_.stops.clear();
+  rounds_.clear();
+  rides_.clear();
+  best_.clear();
+  footpaths_.clear();
+  trips_.clear();
+  date_set_ = false;
+}
+
+// Calculate best path using walking and transit.
+std::vector<PathInfo> RaptorPathAlgorithm::GetBestPath(
+            PathLocation& origin, PathLocation& destination,
+            GraphReader& graphreader,
+            const std::shared_ptr<DynamicCost>* mode_costing,
+            const TravelMode mode) {
+  // For now the date_time must be set on the origin.
+  if (!origin.date_time_)
+    return { };
+
+  // For pedestrian costing - set flag allowing use of transit connections
+  // Set pedestrian costing to use max distance.
+  const auto& pc = mode_costing[static_cast<uint32_t>(TravelMode::kPedestrian)];
+  pc->SetAllowTransitConnections(true);
+  pc->UseMaxMultiModalDistance();
+  const auto& tc = mode_costing[static_cast<uint32_t>(TravelMode::kPublicTransit)];
+  bool wheelchair = tc->wheelchair();
+  bool bicycle = tc->bicycle();
+  uint32_t max_transfer_distance = mode_costing[static_cast<uint32_t>(mode)]->
+                  GetMaxTransferDistanceMM();
+
+  // Set route start time (seconds from midnight), date, and day of week
+  Clear();
+  uint32_t start_time = DateTime::seconds_from_midnight(*origin.date_time_);
+  uint32_t date = DateTime::days_from_pivot_date(
+                  DateTime::get_formatted_date(*origin.date_time_));
+  dow_ = DateTime::day_of_week_mask(*origin.date_time_);
+
+  // Walk from the origin (to the transit stops and the destination)
+  std::unordered_map<uint64_t, Cost> destinations;
+  for (const auto& edge : destination.edges) {
+    if (!edge.begin_node()) {
+      const GraphTile* tile = graphreader.GetGraphTile(edge.id);
+      destinations[edge.id.value] = pc->EdgeCost(tile->directededge(edge.id)) *
+                                    (1.0f - edge.dist);
+    }
+  }
+  for (const auto& edge : origin.edges) {
+    if (edge.end_node()) {
+      continue;
+    }
+    const GraphTile* tile = graphreader.GetGraphTile(edge.id);
+    const DirectedEdge* directededge = tile->directededge(edge.id);
+    Cost cost = pc->EdgeCost(directededge) * (1.0f - edge.dist);
+    uint32_t length = static_cast<uint32_t>(directededge->length() * (1.0f - edge.dist));
+    access_.edgelabels.emplace_back(kInvalidLabel, edge.id, directededge,
+              cost, cost.cost, 0.0f, TravelMode::kPedestrian, length);
+  }
+  Walk(graphreader, pc, std::numeric_limits<uint32_t>::max(), access_, &destinations);
+
+  // Walk from the destination to the transit stops. Pedestrian access is
+  // the same in either direction so walk the opposing edges forward.
+  for (const auto& edge : destination.edges) {
+    GraphId oppedge = graphreader.GetOpposingEdgeId(edge.id);
+    const GraphTile* tile = graphreader.GetGraphTile(oppedge);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(oppedge);
+    Cost cost = pc->EdgeCost(directededge) * edge.dist;
+    uint32_t length = static_cast<uint32_t>(directededge->length() * edge.dist);
+    egress_.edgelabels.emplace_back(kInvalidLabel, oppedge, directededge,
+              cost, cost.cost, 0.0f, TravelMode::kPedestrian, length);
+  }
+  Walk(graphreader, pc, std::numeric_limits<uint32_t>::max(), egress_, nullptr);
+
+  // Walking the whole way is the journey to beat. Each transfer and each
+  // change of transit operator adds a penalty when comparing journeys.
+  uint32_t latest = std::numeric_limits<uint32_t>::max();
+  float best_score = std::numeric_limits<float>::max();
+  if (access_.destination != kInvalidLabel) {
+    latest = start_time + static_cast<uint32_t>(access_.destination_secs);
+    best_score = latest;
+  }
+  float transfer_penalty = tc->TransferCost().cost;
+  bool found = false;
+  Journey journey{0, GraphId(), false};
+
+  // Round 0 - stops reached walking from the origin. Add the transfer time
+  // when entering a stop as a pedestrian.
+  uint32_t entry_secs = tc->DefaultTransferCost().secs;
+  rounds_.emplace_back();
+  std::vector<GraphId> marked;
+  for (const auto& stop : access_.stops) {
+    uint32_t arrival = start_time + entry_secs +
+        static_cast<uint32_t>(access_.edgelabels[stop.second].cost().secs);
+    rounds_[0].walks[stop.first] = { arrival, GraphId(), stop.second, 0, 0.0f };
+    best_[stop.first] = arrival;
+    marked.emplace_back(stop.first);
+  }
+
+  // Each round takes one more transit trip
+  std::unordered_set<uint32_t> processed_tiles;
+  for (uint32_t k = 1; k <= kMaxTransitRounds && !marked.empty(); k++) {
+    // Allow this process to be aborted
+    if (interrupt) {
+      (*interrupt)();
+    }
+
+    // Board the next departure of each transit line from the stops marked
+    // in the last round and ride the trips
+    rounds_.emplace_back();
+    Round& round = rounds_[k];
+    const Round& last = rounds_[k - 1];
+    std::unordered_map<uint64_t, uint32_t> departed;
+    std::vector<GraphId> improved;
+    for (const auto& stop : marked) {
+      const GraphTile* tile = graphreader.GetGraphTile(stop);
+      if (tile == nullptr) {
+        continue;
+      }
+      const NodeInfo* nodeinfo = tile->node(stop);
+      if (processed_tiles.find(tile->id().tileid()) == processed_tiles.end()) {
+        tc->AddToExcludeList(tile);
+        processed_tiles.emplace(tile->id().tileid());
+      }
+      if (tc->IsExcluded(tile, nodeinfo)) {
+        continue;
+      }
+
+      // We must get the date from the transit tiles. The date is set when
+      // the schedules were fetched.
+      if (!date_set_) {
+        uint32_t date_created = tile->header()->date_created();
+        date_before_tile_ = (date < date_created);
+        day_ = date_before_tile_ ? 0 : date - date_created;
+        date_set_ = true;
+      }
+
+      // Time the stop can be left
+      bool after_ride = BoardAfterRide(last, stop.value);
+      const StopLabel& from = after_ride ? last.rides.at(stop.value) :
+                                           last.walks.at(stop.value);
+      uint32_t board_time = from.arrival + (after_ride ? kInStationTransferTime : 0);
+
+      GraphId edgeid(stop.tileid(), stop.level(), nodeinfo->edge_index());
+      const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+      for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, edgeid++) {
+        if (!directededge->IsTransitLine() || tc->IsExcluded(tile, directededge)) {
+          continue;
+        }
+        // Skip if a trip that can no longer be boarded was ridden along the
+        // edge in this round - later trips cannot reach any stop earlier
+        auto ridden = departed.find(edgeid.value);
+        if (ridden != departed.end() && ridden->second <= board_time) {
+          continue;
+        }
+        EdgeLabel pred(kInvalidLabel, edgeid, directededge, Cost{}, 0.0f, 0.0f,
+                       TravelMode::kPedestrian, 0);
+        if (!tc->Allowed(directededge, pred, tile, edgeid)) {
+          continue;
+        }
+        const TransitDeparture* departure = tile->GetNextDeparture(
+                directededge->lineid(), board_time, day_, dow_,
+                date_before_tile_, wheelchair, bicycle);
+        if (departure) {
+          uint32_t operator_id = transit_operators_->GetOperatorId(tile, departure->routeid());
+          Ride(graphreader, stop, edgeid, departure, latest, wheelchair, bicycle,
+               operator_id, BoardingPenalty(from, operator_id), round, departed,
+               improved);
+        }
+      }
+    }
+
+    // Walk from the stops reached earlier by riding to nearby stops
+    uint32_t transfer_secs = tc->TransferCost().secs;
+    for (const auto& stop : improved) {
+      const StopLabel ride = round.rides.at(stop.value);
+      const auto& footpaths = Footpaths(graphreader, stop, pc, max_transfer_distance);
+      for (uint32_t i = 0; i < footpaths.size(); i++) {
+        uint32_t walk_arrival = ride.arrival + footpaths[i].secs + transfer_secs;
+        auto best = best_.find(footpaths[i].stop.value);
+        if (walk_arrival < latest &&
+            (best == best_.end() || walk_arrival < best->second)) {
+          best_[footpaths[i].stop.value] = walk_arrival;
+          round.walks[footpaths[i].stop.value] = { walk_arrival, stop, i,
+                                                   ride.operator_id, ride.penalty };
+        }
+      }
+    }
+
+    // Mark the stops reached earlier in this round. Walk to the destination
+    // from each.
+    marked = improved;
+    for (const auto& stop : round.walks) {
+      if (round.rides.find(stop.first) == round.rides.end()) {
+        marked.emplace_back(stop.first);
+      }
+    }
+    for (const auto& stop : marked) {
+      auto egress = egress_.stops.find(stop.value);
+      if (egress == egress_.stops.end()) {
+        continue;
+      }
+      auto ride = round.rides.find(stop.value);
+      auto walk = round.walks.find(stop.value);
+      bool by_ride = ride != round.rides.end() &&
+          (walk == round.walks.end() || ride->second.arrival <= walk->second.arrival);
+      const StopLabel& label = by_ride ? ride->second : walk->second;
+      uint32_t arrival = label.arrival +
+          static_cast<uint32_t>(egress_.edgelabels[egress->second].cost().secs);
+      float score = arrival + (k - 1) * transfer_penalty + label.penalty;
+      if (score < best_score) {
+        best_score = score;
+        journey = { k, stop, by_ride };
+        found = true;
+      }
+      latest = std::min(latest, arrival);
+    }
+  }
+
+  LOG_DEBUG("RAPTOR rounds = " + std::to_string(rounds_.size() - 1) +
+            " ride edges = " + std::to_string(rides_.size()));
+  if (found) {
+    return FormPath(graphreader, journey, start_time);
+  }
+  return (access_.destination != kInvalidLabel) ? FormWalkingPath(graphreader) :
+          std::vector<PathInfo>{};
+}
+
+// Walk from the seed edge labels (a simple Dijkstra). Transit stops are
+// recorded but not walked through - that would be like entering a station
+// and exiting without getting on transit.
+void RaptorPathAlgorithm::Walk(GraphReader& graphreader,
+                  const std::shared_ptr<DynamicCost>& costing,
+                  const uint32_t max_distance, WalkTree& walk,
+                  const std::unordered_map<uint64_t, Cost>* destinations) {
+  walk.destination = kInvalidLabel;
+  auto& edgelabels = walk.edgelabels;
+  const auto edgecost = [&edgelabels](const uint32_t label) {
+    return edgelabels[label].sortcost();
+  };
+  uint32_t bucketsize = costing->UnitSize();
+  DoubleBucketQueue adjlist(0.0f, kBucketCount * bucketsize, bucketsize, edgecost);
+  EdgeStatus edgestatus(kWalkEdgeStatusSize);
+  for (uint32_t i = 0; i < edgelabels.size(); i++) {
+    adjlist.add(i, edgelabels[i].sortcost());
+    edgestatus.Set(edgelabels[i].edgeid(), EdgeSet::kTemporary, i);
+  }
+
+  const GraphTile* tile;
+  size_t total_labels = 0;
+  while (true) {
+    // Allow this process to be aborted
+    size_t current_labels = edgelabels.size();
+    if (interrupt && total_labels/kInterruptIterationsInterval < current_labels/kInterruptIterationsInterval)
+      (*interrupt)();
+    total_labels = current_labels;
+
+    uint32_t predindex = adjlist.pop();
+    if (predindex == kInvalidLabel) {
+      return;
+    }
+    EdgeLabel pred = edgelabels[predindex];
+    edgestatus.Update(pred.edgeid(), EdgeSet::kPermanent);
+
+    // Keep the first (lowest cost) path to a destination edge (other than
+    // along an origin edge)
+    if (destinations != nullptr && walk.destination == kInvalidLabel &&
+        pred.predecessor() != kInvalidLabel) {
+      auto p = destinations->find(pred.edgeid().value);
+      if (p != destinations->end()) {
+        walk.destination = predindex;
+        walk.destination_secs = pred.cost().secs - p->second.secs;
+      }
+    }
+
+    // Get the end node. Skip if tile not found (can happen with
+    // regional data sets).
+    GraphId node = pred.endnode();
+    if ((tile = graphreader.GetGraphTile(node)) == nullptr) {
+      continue;
+    }
+    const NodeInfo* nodeinfo = tile->node(node);
+    if (nodeinfo->type() == NodeType::kMultiUseTransitStop) {
+      walk.stops.emplace(node.value, predindex);
+      continue;
+    }
+    if (!costing->Allowed(nodeinfo)) {
+      continue;
+    }
+
+    GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, edgeid++) {
+      if (directededge->is_shortcut() || directededge->IsTransitLine()) {
+        continue;
+      }
+      EdgeStatusInfo es = edgestatus.Get(edgeid);
+      if (es.set() == EdgeSet::kPermanent) {
+        continue;
+      }
+
+      // Handle transition edges
+      if (directededge->trans_up() || directededge->trans_down()) {
+        adjlist.add(edgelabels.size(), pred.sortcost());
+        edgestatus.Set(edgeid, EdgeSet::kTemporary, edgelabels.size());
+        edgelabels.emplace_back(predindex, edgeid, directededge->endnode(), pred);
+        continue;
+      }
+
+      // Skip if access is not allowed or the walking distance is exceeded
+      uint32_t walking_distance = pred.path_distance() + directededge->length();
+      if (walking_distance > max_distance ||
+          !costing->Allowed(directededge, pred, tile, edgeid)) {
+        continue;
+      }
+      Cost newcost = pred.cost() + costing->EdgeCost(directededge) +
+                     costing->TransitionCost(directededge, nodeinfo, pred);
+
+      // Check if lower cost path
+      if (es.set() == EdgeSet::kTemporary) {
+        uint32_t idx = es.index();
+        float dc = edgelabels[idx].cost().cost - newcost.cost;
+        if (dc > 0) {
+          float oldsortcost = edgelabels[idx].sortcost();
+          float newsortcost = oldsortcost - dc;
+          edgelabels[idx].Update(predindex, newcost, newsortcost,
+                                 walking_distance, 0, 0);
+          adjlist.decrease(idx, newsortcost, oldsortcost);
+        }
+        continue;
+      }
+
+      // Add edge label, add to the adjacency list and set edge status
+      adjlist.add(edgelabels.size(), newcost.cost);
+      edgestatus.Set(edgeid, EdgeSet::kTemporary, edgelabels.size());
+      edgelabels.emplace_back(predindex, edgeid, directededge, newcost,
+                    newcost.cost, 0.0f, TravelMode::kPedestrian, walking_distance);
+    }
+  }
+}
+
+// Get the walking transfers from a stop to nearby stops.
+const std::vector<RaptorPathAlgorithm::Footpath>& RaptorPathAlgorithm::Footpaths(
+                  GraphReader& graphreader, const GraphId& stop,
+                  const std::shared_ptr<DynamicCost>& costing,
+                  const uint32_t max_distance) {
+  auto cached = footpaths_.find(stop.value);
+  if (cached != footpaths_.end()) {
+    return cached->second;
+  }
+
+  // Walk from the edges leaving the stop (other than transit lines)
+  WalkTree walk;
+  const GraphTile* tile = graphreader.GetGraphTile(stop);
+  if (tile != nullptr) {
+    const NodeInfo* nodeinfo = tile->node(stop);
+    GraphId edgeid(stop.tileid(), stop.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, edgeid++) {
+      if (directededge->IsTransitLine() || directededge->is_shortcut() ||
+          directededge->length() > max_distance) {
+        continue;
+      }
+      Cost cost = costing->EdgeCost(directededge);
+      walk.edgelabels.emplace_back(kInvalidLabel, edgeid, directededge, cost,
+                cost.cost, 0.0f, TravelMode::kPedestrian, directededge->length());
+    }
+    Walk(graphreader, costing, max_distance, walk, nullptr);
+  }
+
+  // Keep the edges walked to each stop
+  auto& footpaths = footpaths_[stop.value];
+  for (const auto& reached : walk.stops) {
+    if (reached.first == stop.value) {
+      continue;
+    }
+    Footpath footpath{ GraphId(reached.first),
+          static_cast<uint32_t>(walk.edgelabels[reached.second].cost().secs), {} };
+    for (uint32_t idx = reached.second; idx != kInvalidLabel;
+         idx = walk.edgelabels[idx].predecessor()) {
+      if (!IsTransition(graphreader, walk.edgelabels[idx].edgeid())) {
+        footpath.edges.emplace_back(walk.edgelabels[idx].edgeid(),
+                    static_cast<uint32_t>(walk.edgelabels[idx].cost().secs));
+      }
+    }
+    std::reverse(footpath.edges.begin(), footpath.edges.end());
+    footpaths.emplace_back(std::move(footpath));
+  }
+  return footpaths;
+}
+
+// Get the timetable of the trip of a departure. A trip boarded before at an
+// edge further along is extended back to this edge.
+std::pair<const std::vector<RaptorPathAlgorithm::TripEdge>*, uint32_t>
+RaptorPathAlgorithm::Timetable(GraphReader& graphreader, const GraphId& edgeid,
+                  const TransitDeparture* departure, const bool wheelchair,
+                  const bool bicycle) {
+  uint32_t tripid = departure->tripid();
+  auto& trip = trips_[tripid];
+  for (uint32_t i = 0; i < trip.size(); i++) {
+    if (trip[i].edgeid == edgeid) {
+      return { &trip, i };
+    }
+  }
+
+  // Follow the trip along the subsequent stops until its end or the start
+  // of the timetable read before
+  std::vector<TripEdge> edges;
+  GraphId next = edgeid;
+  const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+  bool joined = false;
+  while (departure != nullptr && tile != nullptr) {
+    if (!trip.empty() && trip.front().edgeid == next) {
+      joined = true;
+      break;
+    }
+
+    // Stop if the trip loops back to an edge it already departed along
+    if (std::find_if(edges.begin(), edges.end(), [&next](const TripEdge& e) {
+          return e.edgeid == next; }) != edges.end()) {
+      break;
+    }
+    GraphId stop = tile->directededge(next)->endnode();
+    uint32_t arrival = departure->departure_time() + departure->elapsed_time();
+    edges.push_back({ next, stop, departure->departure_time(), arrival });
+
+    // Continue along the transit line edge leaving the stop with the next
+    // departure on the same trip
+    departure = nullptr;
+    if ((tile = graphreader.GetGraphTile(stop)) == nullptr) {
+      break;
+    }
+    const NodeInfo* nodeinfo = tile->node(stop);
+    GraphId edge(stop.tileid(), stop.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, edge++) {
+      if (!directededge->IsTransitLine()) {
+        continue;
+      }
+      const TransitDeparture* d = tile->GetNextDeparture(directededge->lineid(),
+              arrival, day_, dow_, date_before_tile_, wheelchair, bicycle);
+      if (d != nullptr && d->tripid() == tripid) {
+        departure = d;
+        next = edge;
+        break;
+      }
+    }
+  }
+  if (joined) {
+    trip.insert(trip.begin(), edges.begin(), edges.end());
+  } else {
+    trip = std::move(edges);
+  }
+  return { &trip, 0 };
+}
+
+// Ride a trip from the boarding stop along its timetable. Under the no
+// overtaking assumption a trip is not ridden on along an edge where an
+// earlier (or the same) trip departed in this round.
+void RaptorPathAlgorithm::Ride(GraphReader& graphreader, const GraphId& board_stop,
+                  const GraphId& edgeid, const TransitDeparture* departure,
+                  const uint32_t latest, const bool wheelchair, const bool bicycle,
+                  const uint32_t operator_id, const float penalty,
+                  Round& round, std::unordered_map<uint64_t, uint32_t>& departed,
+                  std::vector<GraphId>& improved) {
+  uint32_t tripid = departure->tripid();
+  auto timetable = Timetable(graphreader, edgeid, departure, wheelchair, bicycle);
+  const std::vector<TripEdge>& trip = *timetable.first;
+  uint32_t prior = kInvalidLabel;
+  for (uint32_t i = timetable.second; i < trip.size(); i++) {
+    const TripEdge& edge = trip[i];
+    if (edge.arrival >= latest) {
+      return;
+    }
+    auto ridden = departed.emplace(edge.edgeid.value, edge.departure);
+    if (!ridden.second) {
+      if (ridden.first->second <= edge.departure) {
+        return;
+      }
+      ridden.first->second = edge.departure;
+    }
+    rides_.push_back({ edge.edgeid, tripid, edge.arrival, prior });
+    prior = rides_.size() - 1;
+
+    // Update the stop at the end of the edge if reached earlier
+    auto best = best_.find(edge.stop.value);
+    if (best == best_.end() || edge.arrival < best->second) {
+      best_[edge.stop.value] = edge.arrival;
+      if (round.rides.find(edge.stop.value) == round.rides.end()) {
+        improved.push_back(edge.stop);
+      }
+      round.rides[edge.stop.value] = { edge.arrival, board_stop, prior,
+                                       operator_id, penalty };
+    }
+  }
+}
+
+// Board after riding to the stop if that is earlier (including the in station
+// transfer time) than after walking to it.
+bool RaptorPathAlgorithm::BoardAfterRide(const Round& round, const uint64_t stop) const {
+  auto ride = round.rides.find(stop);
+  if (ride == round.rides.end()) {
+    return false;
+  }
+  auto walk = round.walks.find(stop);
+  return walk == round.walks.end() ||
+         ride->second.arrival + kInStationTransferTime < walk->second.arrival;
+}
+
+// Get the operator change penalties of a journey boarding a trip from a stop.
+float RaptorPathAlgorithm::BoardingPenalty(const StopLabel& from,
+                                           const uint32_t operator_id) {
+  return (from.operator_id > 0 && from.operator_id != operator_id) ?
+         from.penalty + kOperatorChangePenalty : from.penalty;
+}
+
+// Form the path of the journey, working backwards from the destination.
+std::vector<PathInfo> RaptorPathAlgorithm::FormPath(GraphReader& graphreader,
+                  const Journey& journey, const uint32_t start_time) {
+  std::vector<PathInfo> path;
+
+  // Walk from the stop to the destination. The egress edges were walked in
+  // reverse so the path is along their opposing edges.
+  const Round& last = rounds_[journey.round];
+  uint32_t arrival = journey.by_ride ?
+      last.rides.at(journey.stop.value).arrival : last.walks.at(journey.stop.value).arrival;
+  uint32_t elapsed = arrival - start_time;
+  uint32_t idx = egress_.stops.at(journey.stop.value);
+  float egress_secs = egress_.edgelabels[idx].cost().secs;
+  for (; idx != kInvalidLabel; idx = egress_.edgelabels[idx].predecessor()) {
+    const EdgeLabel& edgelabel = egress_.edgelabels[idx];
+    if (IsTransition(graphreader, edgelabel.edgeid())) {
+      continue;
+    }
+    float secs = (edgelabel.predecessor() == kInvalidLabel) ? 0.0f :
+        egress_.edgelabels[edgelabel.predecessor()].cost().secs;
+    path.emplace_back(TravelMode::kPedestrian,
+                      elapsed + static_cast<uint32_t>(egress_secs - secs),
+                      graphreader.GetOpposingEdgeId(edgelabel.edgeid()), 0);
+  }
+  std::reverse(path.begin(), path.end());
+
+  // Work back through the rounds adding rides, walking transfers and the
+  // walk from the origin (each in reverse order)
+  uint32_t k = journey.round;
+  GraphId stop = journey.stop;
+  bool by_ride = journey.by_ride;
+  std::vector<PathInfo> legs;
+  while (true) {
+    const Round& round = rounds_[k];
+    if (by_ride) {
+      const StopLabel& label = round.rides.at(stop.value);
+      for (uint32_t r = label.index; r != kInvalidLabel; r = rides_[r].prior) {
+        legs.emplace_back(TravelMode::kPublicTransit, rides_[r].arrival - start_time,
+                          rides_[r].edgeid, rides_[r].tripid);
+      }
+      stop = label.from_stop;
+      k--;
+      by_ride = BoardAfterRide(rounds_[k], stop.value);
+    } else if (k > 0) {
+      // The transfer time is spent entering the stop at the end of the walk
+      const StopLabel& label = round.walks.at(stop.value);
+      const Footpath& footpath = footpaths_.at(label.from_stop.value)[label.index];
+      uint32_t depart = round.rides.at(label.from_stop.value).arrival - start_time;
+      for (auto edge = footpath.edges.rbegin(); edge != footpath.edges.rend(); ++edge) {
+        uint32_t elapsed = (edge == footpath.edges.rbegin()) ?
+            label.arrival - start_time : depart + edge->second;
+        legs.emplace_back(TravelMode::kPedestrian, elapsed, edge->first, 0);
+      }
+      stop = label.from_stop;
+      by_ride = true;
+    } else {
+      // The time to enter the stop is spent at the end of the walk
+      const StopLabel& label = round.walks.at(stop.value);
+      bool last_edge = true;
+      for (uint32_t i = label.index; i != kInvalidLabel;
+           i = access_.edgelabels[i].predecessor()) {
+        const EdgeLabel& edgelabel = access_.edgelabels[i];
+        if (!IsTransition(graphreader, edgelabel.edgeid())) {
+          uint32_t elapsed = last_edge ? label.arrival - start_time :
+                             static_cast<uint32_t>(edgelabel.cost().secs);
+          legs.emplace_back(TravelMode::kPedestrian, elapsed, edgelabel.edgeid(), 0);
+          last_edge = false;
+        }
+      }
+      break;
+    }
+  }
+  std::reverse(legs.begin(), legs.end());
+  legs.insert(legs.end(), path.begin(), path.end());
+  return legs;
+}
+
+// Form the path walking from the origin to the destination.
+std::vector<PathInfo> RaptorPathAlgorithm::FormWalkingPath(GraphReader& graphreader) const {
+  std::vector<PathInfo> path;
+  for (uint32_t idx = access_.destination; idx != kInvalidLabel;
+       idx = access_.edgelabels[idx].predecessor()) {
+    const EdgeLabel& edgelabel = access_.edgelabels[idx];
+    if (!IsTransition(graphreader, edgelabel.edgeid())) {
+      path.emplace_back(TravelMode::kPedestrian, edgelabel.cost().secs,
+                        edgelabel.edgeid(), 0);
+    }
+  }
+  std::reverse(path.begin(), path.end());
+  path.back().elapsed_time = access_.destination_secs;
+  return path;
+}
+
+}
+}
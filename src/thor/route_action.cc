@@ -44,8 +44,8 @@ namespace valhalla {
     auto trippaths = (date_time_type && *date_time_type == 2) ?
         path_arrive_by(correlated, costing, request_str) :
         path_depart_at(correlated, costing, date_time_type, request_str);
-    for (const auto &trippath: trippaths) {
-      result.messages.emplace_back(trippath.SerializeAsString());
+    for (const auto* trippath: trippaths) {
+      result.messages.emplace_back(trippath->SerializeAsString());
     }
     //get processing time for thor
     auto e = std::chrono::system_clock::now();
@@ -111,15 +111,37 @@ namespace valhalla {
   thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routetype,
         const baldr::PathLocation& origin, const baldr::PathLocation& destination) {
     if (routetype == "multimodal" || routetype == "transit") {
+      // RAPTOR walks to and from transit. Use multimodal A* for other modes
+      // from the origin or paths along a single edge.
+      if (transit_algorithm == RAPTOR && mode == sif::TravelMode::kPedestrian) {
+        for (auto& edge1 : origin.edges) {
+          for (auto& edge2 : destination.edges) {
+            if (edge1.id == edge2.id) {
+              return &multi_modal_astar;
+            }
+          }
+        }
+        return &raptor;
+      }
       return &multi_modal_astar;
     } else {
       // Use A* if any origin and destination edges are the same - otherwise
       // use bidirectional A*. Bidirectional A* does not handle trivial cases
-      // with oneways.
+      // with oneways. When driving with traffic, use the traffic (real-time
+      // speed) A* in place of A*. Bidirectional A* uses the real-time speeds
+      // itself, and historical speeds at the departure hour, but cannot know
+      // the time each edge is reached. So the traffic A* is used for time
+      // dependent (historical speed) paths, but only short ones since it
+      // does not take upward hierarchy transitions.
+      bool traffic = speed_store && mode == sif::TravelMode::kDrive;
+      if (traffic && traffic_astar.time_dependent() && origin.date_time_ &&
+          origin.latlng_.Distance(destination.latlng_) < kMaxTrafficPathDistance) {
+        return &traffic_astar;
+      }
       for (auto& edge1 : origin.edges) {
         for (auto& edge2 : destination.edges) {
           if (edge1.id == edge2.id) {
-            return &astar;
+            return traffic ? static_cast<PathAlgorithm*>(&traffic_astar) : &astar;
           }
         }
       }
@@ -139,7 +161,8 @@ namespace valhalla {
       if (cost->AllowMultiPass()) {
         // 2nd pass. Less aggressive hierarchy transitioning
         path_algorithm->Clear();
-        bool using_astar = (path_algorithm == &astar);
+        bool using_astar = (path_algorithm == &astar ||
+                            path_algorithm == &traffic_astar);
         float relax_factor = using_astar ? 16.0f : 8.0f;
         float expansion_within_factor = using_astar ? 4.0f : 2.0f;
         cost->RelaxHierarchyLimits(relax_factor, expansion_within_factor);
@@ -149,7 +172,7 @@ namespace valhalla {
     }
   }
 
-  std::list<valhalla::odin::TripPath> thor_worker_t::path_arrive_by(std::vector<PathLocation>& correlated, const std::string &costing, const std::string &request_str) {
+  std::list<valhalla::odin::TripPath*> thor_worker_t::path_arrive_by(std::vector<PathLocation>& correlated, const std::string &costing, const std::string &request_str) {
     //get time for start of request
     auto s = std::chrono::system_clock::now();
     // For each pair of origin/destination
@@ -159,7 +182,7 @@ namespace valhalla {
     std::vector<thor::PathInfo> path_edges;
     std::string origin_date_time;
 
-    std::list<valhalla::odin::TripPath> trippaths;
+    std::list<valhalla::odin::TripPath*> trippaths;
     baldr::PathLocation& last_break_dest = *correlated.rbegin();
 
     for(auto path_location = ++correlated.crbegin(); path_location != correlated.crend(); ++path_location) {
@@ -215,18 +238,21 @@ namespace valhalla {
           // Create controller for default route attributes
           TripPathController controller;
 
-          // Form output information based on path edges
-          auto trip_path = thor::TripPathBuilder::Build(controller, reader,
-                                                        mode_costing, path_edges,
-                                                        origin, last_break_dest,
-                                                        through_loc, interrupt_callback);
-          log_admin(trip_path);
+          // Form output information based on path edges. The protobuf path
+          // is allocated on the arena.
+          auto trip_path = new_trip_path();
+          thor::TripPathBuilder::Build(controller, reader, mode_costing,
+                                       path_edges, origin, last_break_dest,
+                                       through_loc, *trip_path,
+                                       interrupt_callback, shape_cache.get(),
+                                       &admin_cache, &trip_admins);
+          log_admin(trip_admins);
 
           if (origin.date_time_)
             origin_date_time = *origin.date_time_;
 
           // The protobuf path
-          trippaths.emplace_front(std::move(trip_path));
+          trippaths.emplace_front(trip_path);
 
           // Clear path edges and set through edge to invalid
           path_edges.clear();
@@ -254,7 +280,10 @@ namespace valhalla {
     return trippaths;
   }
 
-  std::list<valhalla::odin::TripPath> thor_worker_t::path_depart_at(std::vector<PathLocation>& correlated, const std::string &costing, const boost::optional<int> &date_time_type, const std::string &request_str) {
+  // Paths for any leg (pair of consecutive locations) can be supplied in
+  // leg_paths, in which case no search is done for that leg unless it starts
+  // at a through location.
+  std::list<valhalla::odin::TripPath*> thor_worker_t::path_depart_at(std::vector<PathLocation>& correlated, const std::string &costing, const boost::optional<int> &date_time_type, const std::string &request_str, const std::vector<std::vector<thor::PathInfo>>& leg_paths) {
     //get time for start of request
     auto s = std::chrono::system_clock::now();
     bool prior_is_node = false;
@@ -263,7 +292,7 @@ namespace valhalla {
     std::vector<thor::PathInfo> path_edges;
     std::string origin_date_time, dest_date_time;
 
-    std::list<valhalla::odin::TripPath> trippaths;
+    std::list<valhalla::odin::TripPath*> trippaths;
     baldr::PathLocation& last_break_origin = correlated[0];
     for(auto path_location = ++correlated.cbegin(); path_location != correlated.cend(); ++path_location) {
       auto origin = *std::prev(path_location);
@@ -284,9 +313,20 @@ namespace valhalla {
       thor::PathAlgorithm* path_algorithm = get_path_algorithm(costing,
                            origin, destination);
 
+      // Use the supplied path for this leg if there is one
+      size_t leg = path_location - correlated.cbegin() - 1;
+      const std::vector<thor::PathInfo>* leg_path = nullptr;
+      if (leg < leg_paths.size() && !leg_paths[leg].empty() && !through_edge.Is_Valid()) {
+        leg_path = &leg_paths[leg];
+      }
+
       // Get best path
       if (path_edges.size() == 0) {
-        get_path(path_algorithm, origin, destination, path_edges);
+        if (leg_path) {
+          path_edges = *leg_path;
+        } else {
+          get_path(path_algorithm, origin, destination, path_edges);
+        }
         if (path_edges.size() == 0) {
           throw valhalla_exception_t{400, 442};
         }
@@ -297,7 +337,11 @@ namespace valhalla {
       } else {
         // Get the path in a temporary vector
         std::vector<thor::PathInfo> temp_path;
-        get_path(path_algorithm, origin, destination, temp_path);
+        if (leg_path) {
+          temp_path = *leg_path;
+        } else {
+          get_path(path_algorithm, origin, destination, temp_path);
+        }
         if (temp_path.size() == 0) {
           throw valhalla_exception_t{400, 442};
         }
@@ -327,13 +371,15 @@ namespace valhalla {
           // Create controller for default route attributes
           TripPathController controller;
 
-          // Form output information based on path edges
-          auto trip_path = thor::TripPathBuilder::Build(controller, reader,
-                                                        mode_costing, path_edges,
-                                                        last_break_origin,
-                                                        destination, through_loc,
-                                                        interrupt_callback);
-          log_admin(trip_path);
+          // Form output information based on path edges. The protobuf path
+          // is allocated on the arena.
+          auto trip_path = new_trip_path();
+          thor::TripPathBuilder::Build(controller, reader, mode_costing,
+                                       path_edges, last_break_origin,
+                                       destination, through_loc, *trip_path,
+                                       interrupt_callback, shape_cache.get(),
+                                       &admin_cache, &trip_admins);
+          log_admin(trip_admins);
 
           if (date_time_type) {
             origin_date_time = *last_break_origin.date_time_;
@@ -341,7 +387,7 @@ namespace valhalla {
           }
 
           // The protobuf path
-          trippaths.emplace_back(std::move(trip_path));
+          trippaths.emplace_back(trip_path);
 
           // Clear path edges and set through edge to invalid
           path_edges.clear();
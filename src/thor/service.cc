@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <cstdint>
 #include <sstream>
+#include <algorithm>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -17,8 +18,10 @@
 
 #include <prime_server/prime_server.hpp>
 
+#include "config.h"
 #include "thor/service.h"
 #include "thor/isochrone.h"
+#include "thor/local_search_optimizer.h"
 
 using namespace prime_server;
 using namespace valhalla;
@@ -52,6 +55,18 @@ namespace {
     }while(++i);
     return correlated;
   }
+
+  // Arena options that start with the worker owned block, so resetting the
+  // arena keeps that block, and grow in larger blocks than the default
+  google::protobuf::ArenaOptions arena_options(std::vector<char>& block,
+                                               const size_t max_block_size) {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = block.data();
+    options.initial_block_size = block.size();
+    options.start_block_size = std::min(block.size(), max_block_size);
+    options.max_block_size = max_block_size;
+    return options;
+  }
 }
 
 namespace valhalla {
@@ -66,6 +81,9 @@ namespace valhalla {
     thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config):
       mode(valhalla::sif::TravelMode::kPedestrian),
       config(config), matcher_factory(config), reader(config.get_child("mjolnir")),
+      arena_block(config.get<size_t>("thor.arena.initial_block_size", kDefaultArenaInitialBlockSize)),
+      arena(arena_options(arena_block, config.get<size_t>("thor.arena.max_block_size", kDefaultArenaMaxBlockSize))),
+      admin_cache(config.get<size_t>("thor.admin_cache.max_size", kDefaultAdminCacheSize)),
       long_request(config.get<float>("thor.logging.long_request")){
       // Register edge/node costing methods
       factory.Register("auto", sif::CreateAutoCost);
@@ -93,6 +111,120 @@ namespace valhalla {
         source_to_target_algorithm = SELECT_OPTIMAL;
       }
 
+      // Share the transit operator Ids between the transit path algorithms
+      // and isochrones
+      transit_operators.reset(new TransitOperators());
+      multi_modal_astar.set_transit_operators(transit_operators);
+      raptor.set_transit_operators(transit_operators);
+      isochrone_gen.set_transit_operators(transit_operators);
+
+      // Use real-time speeds (traffic) if enabled in the conf file. Speed
+      // tiles are for the local hierarchy level and are shared by the route
+      // and matrix algorithms.
+      speed_level = reader.GetTileHierarchy().levels().rbegin()->first;
+      if (config.get<bool>("thor.traffic.enabled", false)) {
+        speed_store = std::make_shared<SpeedStore>(
+            reader.GetTileHierarchy().tile_dir() + "/traffic/",
+            config.get<uint32_t>("thor.traffic.max_tiles", kDefaultMaxSpeedTiles),
+            config.get<uint32_t>("thor.traffic.reload_interval",
+                                 kDefaultSpeedReloadInterval));
+        bidir_astar.set_speed_store(speed_store, speed_level);
+        traffic_astar.set_speed_store(speed_store, speed_level);
+
+        // Route short driving paths that have a departure time with
+        // historical speeds at the time each edge is reached if enabled.
+        // Longer paths use historical speeds at the departure hour.
+        if (config.get<bool>("thor.traffic.historical", false)) {
+          auto historical_store = std::make_shared<SpeedStore>(
+              reader.GetTileHierarchy().tile_dir() + "/traffic/",
+              config.get<uint32_t>("thor.traffic.max_tiles", kDefaultMaxSpeedTiles),
+              config.get<uint32_t>("thor.traffic.reload_interval",
+                                   kDefaultSpeedReloadInterval), ".hsp");
+          traffic_astar.set_historical_store(historical_store);
+          traffic_astar.set_time_dependent(true);
+          bidir_astar.set_historical_store(historical_store);
+        }
+      }
+
+      // Cache decoded edge shapes across requests for the trip path builder
+      // and isochrones unless disabled (maximum size 0) in the conf file.
+      // The cache use is logged every report interval of requests.
+      auto shape_cache_size = config.get<size_t>("thor.shape_cache.max_size",
+                                                 kDefaultShapeCacheSize);
+      if (shape_cache_size > 0) {
+        shape_cache = std::make_shared<ShapeCache>(shape_cache_size);
+        isochrone_gen.set_shape_cache(shape_cache);
+      }
+      shape_cache_report_interval = config.get<uint32_t>(
+          "thor.shape_cache.report_interval", kDefaultShapeCacheReportInterval);
+      shape_cache_requests = 0;
+
+      // Select the transit (multimodal) route algorithm based on the conf file
+      // (defaults to multimodal A* if not present)
+      transit_algorithm = (config.get<std::string>("thor.transit_algorithm",
+                    "multimodal") == "raptor") ? RAPTOR : MULTIMODAL_ASTAR;
+
+      // Largest walking distance a transit route may start or end with (the
+      // upper limit on the pedestrian costing's transit_start_end_max_distance
+      // in the service limits). Bounds the transit stops checked before the
+      // walk when a request does not set the distance (0 if not limited).
+      transit_max_walking_distance = config.get<uint32_t>(
+          "service_limits.pedestrian.max_transit_walking_distance", 0);
+
+      // Select the optimized route algorithm based on the conf file (defaults
+      // to local_search if not present). Get the number of threads, the time
+      // limit (milliseconds), the iteration limit and the seed for the local
+      // search. With a seed the search runs to the iteration limit (ignoring
+      // the time limit) so the same request always gets the same order.
+      // Without one it also stops at the time limit.
+      auto conf_optimizer = config.get<std::string>("thor.optimizer.algorithm",
+                                                    "local_search");
+      optimizer_algorithm = (conf_optimizer == "simulated_annealing") ?
+                  SIMULATED_ANNEALING : LOCAL_SEARCH;
+      optimizer_threads = config.get<uint32_t>("thor.optimizer.threads",
+                                               kDefaultOptimizerThreads);
+      optimizer_time_limit = config.get<uint32_t>("thor.optimizer.time_limit",
+                                                  kDefaultOptimizerTimeLimit);
+      optimizer_max_iterations = config.get<uint32_t>(
+          "thor.optimizer.max_iterations", kDefaultOptimizerMaxIterations);
+      optimizer_seed = config.get_optional<uint64_t>("thor.optimizer.seed");
+
+      // Tours with up to this many locations are solved exactly
+      optimizer_exact_max_count = config.get<uint32_t>(
+          "thor.optimizer.exact_max_count", kDefaultExactMaxCount);
+
+      // Directory to record the cost matrices sent to the optimizer in, as
+      // instances for bench/optimizer_quality (not recorded if empty)
+      optimizer_record_dir = config.get<std::string>(
+          "thor.optimizer.record_dir", "");
+
+      // Number of isotiles kept for reuse by isochrone requests from the
+      // same origins and costing
+      isochrone_cache = IsochroneCache(config.get<uint32_t>(
+          "thor.isochrone.cache_size", kDefaultIsochroneCacheSize));
+
+      // Keep the isochrone search state between requests so a request from
+      // the same origins and costing with a larger time can resume it
+      isochrone_resume = config.get<bool>("thor.isochrone.resume", false);
+
+      // Number of threads used to generate the contours of an isochrone
+      isochrone_contour_threads = config.get<uint32_t>(
+          "thor.isochrone.contour_threads", kDefaultContourThreads);
+
+      // Maximum number of departures in the departure window of a multimodal
+      // isochrone profile
+      isochrone_max_profile_departures = config.get<uint32_t>(
+          "thor.isochrone.max_profile_departures", kDefaultMaxProfileDepartures);
+
+      // Number of threads used to search groups of widely separated isochrone
+      // origins (each needs its own graph reader) and the distance within
+      // which origins are searched together
+      auto origin_threads = config.get<uint32_t>("thor.isochrone.origin_threads", 1);
+      for (uint32_t i = 1; i < origin_threads; ++i)
+        isochrone_readers.emplace_back(new baldr::GraphReader(config.get_child("mjolnir")));
+      isochrone_origin_group_distance = config.get<float>(
+          "thor.isochrone.origin_group_distance", kDefaultOriginGroupDistance);
+
       interrupt_callback = nullptr;
     }
 
@@ -157,6 +289,8 @@ namespace valhalla {
         astar.set_interrupt(&interrupt);
         bidir_astar.set_interrupt(&interrupt);
         multi_modal_astar.set_interrupt(&interrupt);
+        raptor.set_interrupt(&interrupt);
+        traffic_astar.set_interrupt(&interrupt);
         //what action is it
         switch (action) {
           case ONE_TO_MANY:
@@ -211,6 +345,13 @@ namespace valhalla {
         mode_costing[2] = get_costing(request, "bicycle");
         mode_costing[3] = get_costing(request, "transit");
         mode = valhalla::sif::TravelMode::kPedestrian;
+
+        // The walk to transit at the destination is limited by the
+        // pedestrian costing: use its distance if the request sets it,
+        // otherwise the service limit on it
+        multi_modal_astar.set_max_walking_distance(request.get<uint32_t>(
+            "costing_options.pedestrian.transit_start_end_max_distance",
+            transit_max_walking_distance));
       } else {
         valhalla::sif::cost_ptr_t cost = get_costing(request, costing);
         mode = cost->travel_mode();
@@ -306,27 +447,41 @@ namespace valhalla {
       }
     }
 
-    void thor_worker_t::log_admin(valhalla::odin::TripPath& trip_path) {
-      if (!healthcheck) {
-        std::unordered_set<std::string> state_iso;
-        std::unordered_set<std::string> country_iso;
-        std::stringstream s_ss, c_ss;
-        if (trip_path.admin_size() > 0) {
-          for (const auto& admin : trip_path.admin()) {
-            if (admin.has_state_code())
-              state_iso.insert(admin.state_code());
-            if (admin.has_country_code())
-              country_iso.insert(admin.country_code());
+    // Create a trip path on the arena. With protobuf 3.14 or later (arenas
+    // enabled for every message, see configure.ac) the trip path and its
+    // sub-messages are constructed on it. Otherwise the trip path is only
+    // owned by the arena (destroyed when it is reset) and its sub-messages are
+    // allocated on the heap.
+    odin::TripPath* thor_worker_t::new_trip_path() {
+#ifdef HAVE_ARENA_TRIP_PATH
+      return google::protobuf::Arena::CreateMessage<odin::TripPath>(&arena);
+#else
+      return google::protobuf::Arena::Create<odin::TripPath>(&arena);
+#endif
+    }
+
+    // Log the distinct state and country codes of the trip path admins. Codes
+    // are compared by their interned Ids.
+    void thor_worker_t::log_admin(const std::vector<const AdminRecord*>& admins) {
+      if (!healthcheck && admins.size() > 0) {
+        std::vector<uint32_t> state_codes, country_codes;
+        std::string state_iso, country_iso;
+        for (const auto* admin : admins) {
+          if (!admin->state_iso.empty() &&
+              std::find(state_codes.begin(), state_codes.end(),
+                        admin->state_code) == state_codes.end()) {
+            state_codes.push_back(admin->state_code);
+            state_iso += " " + admin->state_iso;
+          }
+          if (!admin->country_iso.empty() &&
+              std::find(country_codes.begin(), country_codes.end(),
+                        admin->country_code) == country_codes.end()) {
+            country_codes.push_back(admin->country_code);
+            country_iso += " " + admin->country_iso;
           }
-          for (const std::string& x: state_iso)
-            s_ss << " " << x;
-          std::cout <<  std::endl;
-          for (const std::string& x: country_iso)
-            c_ss << " " << x;
-          std::cout <<  std::endl;
-          if (!s_ss.eof()) valhalla::midgard::logging::Log("admin_state_iso::" + s_ss.str() + ' ', " [ANALYTICS] ");
-          if (!c_ss.eof()) valhalla::midgard::logging::Log("admin_country_iso::" + c_ss.str() + ' ', " [ANALYTICS] ");
         }
+        valhalla::midgard::logging::Log("admin_state_iso::" + state_iso + ' ', " [ANALYTICS] ");
+        valhalla::midgard::logging::Log("admin_country_iso::" + country_iso + ' ', " [ANALYTICS] ");
       }
     }
 
@@ -335,15 +490,40 @@ namespace valhalla {
       astar.Clear();
       bidir_astar.Clear();
       multi_modal_astar.Clear();
+      raptor.Clear();
+      traffic_astar.Clear();
       locations.clear();
       shape.clear();
       correlated.clear();
       correlated_s.clear();
       correlated_t.clear();
-      isochrone_gen.Clear();
+      if (!isochrone_resume)
+        isochrone_gen.Clear();
       matcher_factory.ClearFullCache();
-      if(reader.OverCommitted())
+      trip_admins.clear();
+      if(reader.OverCommitted()) {
+        // Admin records are cached by tile Id, so drop them with the tiles
+        // (a tile may be reloaded with new data)
         reader.Clear();
+        admin_cache.Clear();
+        // Operator Ids and transit stops are kept by tile, so drop them with
+        // the tiles (unless an isochrone with labels holding operator Ids is
+        // resumed)
+        if (!isochrone_resume)
+          transit_operators->Clear();
+        multi_modal_astar.ClearTransitStops();
+      }
+      for (auto& isochrone_reader : isochrone_readers) {
+        if (isochrone_reader->OverCommitted())
+          isochrone_reader->Clear();
+      }
+      arena.Reset();
+      if (admin_cache.OverCommitted())
+        admin_cache.Clear();
+      if (shape_cache && shape_cache_report_interval > 0 &&
+          ++shape_cache_requests % shape_cache_report_interval == 0) {
+        LOG_INFO("thor::shape_cache " + shape_cache->Report());
+      }
     }
 
     void run_service(const boost::property_tree::ptree& config) {
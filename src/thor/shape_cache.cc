@@ -0,0 +1,116 @@
+#include <sstream>
+#include <iomanip>
+#include "thor/shape_cache.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// Approximate memory (bytes) used per cached shape besides its points: the
+// list entry, the index node and the shared vector.
+constexpr size_t kShapeEntryOverhead = 128;
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+ShapeCache::ShapeCache(const size_t max_size)
+    : max_size_(max_size),
+      memory_(0),
+      hits_(0),
+      misses_(0) {
+}
+
+// Get the decoded shape of an edge
+std::shared_ptr<const ShapeCache::Shape> ShapeCache::Get(const GraphTile* tile,
+                                     const uint32_t edgeinfo_offset) {
+  return Get(Key(tile->id().value, edgeinfo_offset),
+             [tile, edgeinfo_offset]() {
+               return tile->edgeinfo(edgeinfo_offset).shape();
+             });
+}
+
+// Get a decoded shape. The shape is decoded without holding the lock so
+// threads do not wait on each other's decoding.
+std::shared_ptr<const ShapeCache::Shape> ShapeCache::Get(const uint64_t key,
+                                     const std::function<Shape ()>& decode) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = index_.find(key);
+    if (found != index_.end()) {
+      hits_++;
+      entries_.splice(entries_.begin(), entries_, found->second);
+      return found->second->shape;
+    }
+    misses_++;
+  }
+  std::shared_ptr<const Shape> shape = std::make_shared<Shape>(decode());
+
+  // Add the shape (unless another thread added it meanwhile) and evict the
+  // least recently used shapes until within the maximum size
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(key);
+  if (found != index_.end()) {
+    return found->second->shape;
+  }
+  size_t memory = shape->capacity() * sizeof(PointLL) + kShapeEntryOverhead;
+  entries_.push_front({key, memory, shape});
+  index_[key] = entries_.begin();
+  memory_ += memory;
+  while (memory_ > max_size_ && !entries_.empty()) {
+    memory_ -= entries_.back().memory;
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+  return shape;
+}
+
+// Remove all shapes
+void ShapeCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.clear();
+  entries_.clear();
+  memory_ = 0;
+}
+
+// Get the number of shapes in the cache
+size_t ShapeCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+// Get the memory used by the shapes in the cache
+size_t ShapeCache::memory() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return memory_;
+}
+
+// Get the number of hits
+uint64_t ShapeCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+// Get the number of misses
+uint64_t ShapeCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+// Describe the cache use
+std::string ShapeCache::Report() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t lookups = hits_ + misses_;
+  std::stringstream report;
+  report << "shapes=" << entries_.size() << " memory=" << memory_
+         << " hits=" << hits_ << " misses=" << misses_ << " hit_rate="
+         << std::fixed << std::setprecision(3)
+         << (lookups > 0 ? static_cast<double>(hits_) / lookups : 0.0);
+  return report.str();
+}
+
+}
+}
@@ -0,0 +1,159 @@
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <valhalla/midgard/logging.h>
+#include "thor/speed_store.h"
+
+namespace valhalla {
+namespace thor {
+
+// Map the speed file
+SpeedTile::SpeedTile(const int fd, const size_t size)
+    : speeds_(nullptr),
+      size_(size) {
+  void* speeds = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  if (speeds == MAP_FAILED) {
+    throw std::runtime_error("Could not map speed file");
+  }
+  speeds_ = static_cast<const uint8_t*>(speeds);
+}
+
+// Unmap the speed file
+SpeedTile::~SpeedTile() {
+  munmap(const_cast<uint8_t*>(speeds_), size_);
+}
+
+// Constructor
+SpeedStore::SpeedStore(const std::string& traffic_dir,
+                       const uint32_t max_tiles,
+                       const uint32_t reload_interval,
+                       const std::string& extension)
+    : traffic_dir_(traffic_dir),
+      extension_(extension),
+      max_tiles_(max_tiles),
+      reload_interval_(reload_interval) {
+}
+
+// Get the real-time speeds of a tile. The speed file is only checked for
+// updates once the reload interval has passed since it was last checked: its
+// identity is checked with stat and the file is only mapped again if it
+// changed. Files are checked and mapped without holding the lock so other
+// threads are not blocked by the file system.
+std::shared_ptr<const SpeedTile> SpeedStore::Get(const uint32_t tileid) {
+  auto now = std::chrono::steady_clock::now();
+  bool stale = false;
+  FileId cached = {0, 0, 0, 0};
+  std::shared_ptr<const SpeedTile> speeds;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = index_.find(tileid);
+    if (found != index_.end()) {
+      auto entry = found->second;
+      entries_.splice(entries_.begin(), entries_, entry);
+      if (now - entry->checked < reload_interval_) {
+        return entry->speeds;
+      }
+
+      // Check the file (once for all threads wanting the tile meanwhile)
+      stale = true;
+      entry->checked = now;
+      cached = entry->file;
+      speeds = entry->speeds;
+    }
+  }
+
+  // Return the mapped tile if the speed file has not changed
+  if (stale && Stat(tileid) == cached) {
+    return speeds;
+  }
+
+  // Map the new or changed speed file
+  FileId file;
+  speeds = Map(tileid, file);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = index_.find(tileid);
+  if (found != index_.end()) {
+    // Another thread may have added the tile meanwhile. Replace the speeds
+    // unless they are the same file.
+    auto entry = found->second;
+    if (!(file == entry->file)) {
+      if (stale) {
+        LOG_INFO("Reload real time speeds: tile = " + std::to_string(tileid));
+      }
+      entry->file = file;
+      entry->speeds = speeds;
+    }
+    entry->checked = now;
+    return entry->speeds;
+  }
+
+  // Add the tile, evicting the least recently used if the store is full.
+  // Tiles without speeds are kept so the file is not looked up every time.
+  entries_.push_front({tileid, file, now, speeds});
+  index_[tileid] = entries_.begin();
+  if (entries_.size() > max_tiles_) {
+    index_.erase(entries_.back().tileid);
+    entries_.pop_back();
+  }
+  return speeds;
+}
+
+// Remove all speed tiles
+void SpeedStore::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.clear();
+  entries_.clear();
+}
+
+// Get the number of tiles in the store
+size_t SpeedStore::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+// Get the name of the speed file of a tile
+std::string SpeedStore::FileName(const uint32_t tileid) const {
+  return traffic_dir_ + std::to_string(tileid) + extension_;
+}
+
+// Get the identity of the speed file of a tile without opening it. A missing
+// file has the same identity as from Map.
+SpeedStore::FileId SpeedStore::Stat(const uint32_t tileid) const {
+  struct stat st;
+  if (stat(FileName(tileid).c_str(), &st) != 0) {
+    return {0, 0, 0, 0};
+  }
+  return {st.st_dev, st.st_ino, st.st_mtime, st.st_size};
+}
+
+// Map the speed file of a tile. The file is opened before checking its
+// identity so the identity is that of the file mapped even if the file is
+// replaced meanwhile.
+std::shared_ptr<const SpeedTile> SpeedStore::Map(const uint32_t tileid,
+                                                 FileId& file) const {
+  file = {0, 0, 0, 0};
+  std::string fname = FileName(tileid);
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  std::shared_ptr<const SpeedTile> speeds;
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    file = {st.st_dev, st.st_ino, st.st_mtime, st.st_size};
+    if (st.st_size > 0) {
+      try {
+        speeds = std::make_shared<SpeedTile>(fd, st.st_size);
+      } catch (const std::exception& e) {
+        LOG_ERROR(std::string(e.what()) + ": " + fname);
+      }
+    }
+  }
+  close(fd);
+  return speeds;
+}
+
+}
+}
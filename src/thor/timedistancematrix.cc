@@ -30,7 +30,10 @@ namespace thor {
 TimeDistanceMatrix::TimeDistanceMatrix(float initial_cost_threshold)
     : settled_count_(0),
       initial_cost_threshold_(initial_cost_threshold),
-      cost_threshold_(initial_cost_threshold) {
+      cost_threshold_(initial_cost_threshold),
+      max_time_(kMaxCost),
+      max_distance_(kMaxCost),
+      k_nearest_(0) {
 }
 
 // Clear the temporary information generated during time + distance matrix
@@ -46,6 +49,9 @@ void TimeDistanceMatrix::Clear() {
 
   // Clear the edge status flags
   edgestatus_.reset();
+
+  // Clear the speed tiles used
+  traffic_.Clear();
 }
 
 // Calculate time and distance from one origin location to many destination
@@ -55,8 +61,14 @@ std::vector<TimeDistance> TimeDistanceMatrix::OneToMany(
             const std::vector<PathLocation>& locations,
             GraphReader& graphreader,
             const std::shared_ptr<DynamicCost>* mode_costing,
-            const TravelMode mode) {
+            const TravelMode mode,
+            const float max_matrix_time,
+            const float max_matrix_distance,
+            const uint32_t k_nearest) {
   cost_threshold_ = initial_cost_threshold_;
+  max_time_ = max_matrix_time;
+  max_distance_ = max_matrix_distance;
+  k_nearest_ = (k_nearest < locations.size()) ? k_nearest : 0;
 
   // Set the mode and costing
   mode_ = mode;
@@ -109,7 +121,7 @@ std::vector<TimeDistance> TimeDistanceMatrix::OneToMany(
       tile = graphreader.GetGraphTile(pred.edgeid());
       const DirectedEdge* edge = tile->directededge(pred.edgeid());
       if (UpdateDestinations(origin, locations, destedge->second, edge,
-                             pred, predindex, costing)) {
+                             pred.edgeid(), pred, predindex, costing)) {
         return FormTimeDistanceMatrix();
       }
     }
@@ -119,6 +131,11 @@ std::vector<TimeDistance> TimeDistanceMatrix::OneToMany(
       return FormTimeDistanceMatrix();
     }
 
+    // Do not expand beyond the time or distance limits
+    if (pred.cost().secs > max_time_ || pred.path_distance() > max_distance_) {
+      continue;
+    }
+
     // Get the end node of the prior directed edge. Skip if tile not found
     // (can happen with regional data sets).
     GraphId node = pred.endnode();
@@ -164,9 +181,9 @@ std::vector<TimeDistance> TimeDistanceMatrix::OneToMany(
       }
 
       // Get cost and update distance
-      Cost newcost = pred.cost() +
-                     costing->EdgeCost(directededge) +
-                     costing->TransitionCost(directededge, nodeinfo, pred);
+      Cost tc = costing->TransitionCost(directededge, nodeinfo, pred);
+      Cost edgecost = traffic_.EdgeCost(costing, directededge, edgeid, tc);
+      Cost newcost = pred.cost() + edgecost + tc;
       uint32_t distance = pred.path_distance() + directededge->length();
 
       // Check if edge is temporarily labeled and this path has less cost. If
@@ -208,8 +225,14 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToOne(
             const std::vector<PathLocation>& locations,
             GraphReader& graphreader,
             const std::shared_ptr<DynamicCost>* mode_costing,
-            const TravelMode mode) {
+            const TravelMode mode,
+            const float max_matrix_time,
+            const float max_matrix_distance,
+            const uint32_t k_nearest) {
   cost_threshold_ = initial_cost_threshold_;
+  max_time_ = max_matrix_time;
+  max_distance_ = max_matrix_distance;
+  k_nearest_ = (k_nearest < locations.size()) ? k_nearest : 0;
 
   // Set the mode and costing
   mode_ = mode;
@@ -258,10 +281,13 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToOne(
     if (destedge != dest_edges_.end()) {
       // Update any destinations along this edge. Return if all destinations
       // have been settled.
-      tile = graphreader.GetGraphTile(pred.edgeid());
-      const DirectedEdge* edge = tile->directededge(pred.edgeid());
-      if (UpdateDestinations(dest, locations, destedge->second, edge,
-                             pred, predindex, costing)) {
+      // The label is costed along the opposing edge (the edge in the
+      // direction of travel) so use it for the partial edge cost.
+      GraphId opp_edge_id = graphreader.GetOpposingEdgeId(pred.edgeid());
+      const DirectedEdge* opp_edge = graphreader.GetOpposingEdge(pred.edgeid());
+      if (opp_edge != nullptr &&
+          UpdateDestinations(dest, locations, destedge->second, opp_edge,
+                             opp_edge_id, pred, predindex, costing)) {
         return FormTimeDistanceMatrix();
       }
     }
@@ -271,6 +297,11 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToOne(
       return FormTimeDistanceMatrix();
     }
 
+    // Do not expand beyond the time or distance limits
+    if (pred.cost().secs > max_time_ || pred.path_distance() > max_distance_) {
+      continue;
+    }
+
     // Get the end node of the prior directed edge. Skip if tile not found
     // (can happen with regional data sets).
     GraphId node = pred.endnode();
@@ -322,11 +353,15 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToOne(
         continue;
       }
 
-      // Get cost. Use the opposing edge for EdgeCost.
-      Cost newcost = pred.cost() +
-                    costing->EdgeCost(opp_edge) +
-                    costing->TransitionCostReverse(directededge->localedgeidx(),
+      // Get cost. Use the opposing edge for EdgeCost. Only look up the
+      // opposing edge Id if it is needed for its real-time speed.
+      Cost tc = costing->TransitionCostReverse(directededge->localedgeidx(),
                                         nodeinfo, opp_edge, opp_pred_edge);
+      Cost edgecost = traffic_.enabled(costing) ?
+          traffic_.EdgeCost(costing, opp_edge,
+                            graphreader.GetOpposingEdgeId(edgeid), tc) :
+          costing->EdgeCost(opp_edge);
+      Cost newcost = pred.cost() + edgecost + tc;
       uint32_t distance = pred.path_distance() + directededge->length();
 
       // Check if edge is temporarily labeled and this path has less cost. If
@@ -360,8 +395,11 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToMany(
            const std::vector<PathLocation>& locations,
            GraphReader& graphreader,
            const std::shared_ptr<DynamicCost>* mode_costing,
-           const sif::TravelMode mode) {
-  return SourceToTarget(locations, locations, graphreader, mode_costing, mode);
+           const sif::TravelMode mode,
+           const float max_matrix_time,
+           const float max_matrix_distance) {
+  return SourceToTarget(locations, locations, graphreader, mode_costing, mode,
+                        max_matrix_time, max_matrix_distance);
 }
 
 std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
@@ -369,20 +407,26 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
         const std::vector<baldr::PathLocation>& target_location_list,
         baldr::GraphReader& graphreader,
         const std::shared_ptr<sif::DynamicCost>* mode_costing,
-        const sif::TravelMode mode) {
+        const sif::TravelMode mode,
+        const float max_matrix_time,
+        const float max_matrix_distance) {
   // Run a series of one to many calls and concatenate the results.
   std::vector<TimeDistance> many_to_many;
   if (source_location_list.size() <= target_location_list.size()) {
     for (const auto& origin: source_location_list) {
       std::vector<TimeDistance> td = OneToMany(origin, target_location_list,
-                                               graphreader, mode_costing, mode);
+                                               graphreader, mode_costing, mode,
+                                               max_matrix_time,
+                                               max_matrix_distance);
       many_to_many.insert(many_to_many.end(), td.begin(), td.end());
       Clear();
     }
   } else {
     for (const auto& destination: target_location_list) {
       std::vector<TimeDistance> td = ManyToOne(destination, source_location_list,
-                                               graphreader, mode_costing, mode);
+                                               graphreader, mode_costing, mode,
+                                               max_matrix_time,
+                                               max_matrix_distance);
       many_to_many.insert(many_to_many.end(), td.begin(), td.end());
       Clear();
     }
@@ -415,7 +459,7 @@ void TimeDistanceMatrix::SetOriginOneToMany(GraphReader& graphreader,
 
     // Get cost. Use this as sortcost since A* is not used for time+distance
     // matrix computations. . Get distance along the remainder of this edge.
-    Cost cost = costing->EdgeCost(directededge) * (1.0f - edge.dist);
+    Cost cost = traffic_.EdgeCost(costing, directededge, edgeid) * (1.0f - edge.dist);
     uint32_t d = static_cast<uint32_t>(directededge->length() *
                              (1.0f - edge.dist));
 
@@ -457,7 +501,7 @@ void TimeDistanceMatrix::SetOriginManyToOne(GraphReader& graphreader,
 
     // Get cost. Use this as sortcost since A* is not used for time
     // distance matrix computations. Get the distance along the edge.
-    Cost cost = costing->EdgeCost(opp_dir_edge) * edge.dist;
+    Cost cost = traffic_.EdgeCost(costing, opp_dir_edge, opp_edge_id) * edge.dist;
     uint32_t d = static_cast<uint32_t>(directededge->length() * edge.dist);
 
     // Add EdgeLabel to the adjacency list (but do not set its status).
@@ -491,7 +535,7 @@ void TimeDistanceMatrix::SetDestinations(GraphReader& graphreader,
 
       // Form a threshold cost (the total cost to traverse the edge)
       const GraphTile* tile = graphreader.GetGraphTile(edge.id);
-      float c = costing->EdgeCost(tile->directededge(edge.id)).cost;
+      float c = traffic_.EdgeCost(costing, tile->directededge(edge.id), edge.id).cost;
       if (c > d.threshold) {
         d.threshold = c;
       }
@@ -528,7 +572,7 @@ void TimeDistanceMatrix::SetDestinationsManyToOne(GraphReader& graphreader,
 
       // Form a threshold cost (the total cost to traverse the edge)
       const GraphTile* tile = graphreader.GetGraphTile(edge.id);
-      float c = costing->EdgeCost(tile->directededge(edge.id)).cost;
+      float c = traffic_.EdgeCost(costing, tile->directededge(edge.id), edge.id).cost;
       if (c > d.threshold) {
         d.threshold = c;
       }
@@ -547,6 +591,7 @@ bool TimeDistanceMatrix::UpdateDestinations(const PathLocation& origin,
                                 const std::vector<PathLocation>& locations,
                                 std::vector<uint32_t>& destinations,
                                 const DirectedEdge* edge,
+                                const GraphId& edgeid,
                                 const EdgeLabel& pred,
                                 const uint32_t predindex,
                                 const std::shared_ptr<DynamicCost>& costing) {
@@ -580,7 +625,8 @@ bool TimeDistanceMatrix::UpdateDestinations(const PathLocation& origin,
     // Get the cost. The predecessor cost is cost to the end of the edge.
     // Subtract the partial remaining cost and distance along the edge.
     float remainder = dest_edge->second;
-    Cost newcost = pred.cost() - (costing->EdgeCost(edge) * remainder);
+    Cost newcost = pred.cost() -
+        (traffic_.EdgeCost(costing, edge, edgeid) * remainder);
     if (newcost.cost < dest.best_cost.cost) {
       dest.best_cost = newcost;
       dest.distance = pred.path_distance() - (edge->length() * remainder);
@@ -627,14 +673,61 @@ bool TimeDistanceMatrix::UpdateDestinations(const PathLocation& origin,
   if (allfound) {
     cost_threshold_ = maxcost;
   }
+
+  // In k-nearest mode, once k destinations are settled no unsettled
+  // destination can cost less than the current cost minus its largest
+  // partial edge cost. Stop once that is beyond the k-th best cost.
+  if (k_nearest_ > 0 && settled_count_ >= k_nearest_) {
+    std::vector<float> settled_costs;
+    float max_threshold = 0.0f;
+    for (const auto& d : destinations_) {
+      if (d.settled) {
+        settled_costs.push_back(d.best_cost.cost);
+      } else {
+        max_threshold = std::max(max_threshold, d.threshold);
+      }
+    }
+    std::nth_element(settled_costs.begin(),
+                     settled_costs.begin() + (k_nearest_ - 1),
+                     settled_costs.end());
+    float kth_cost = settled_costs[k_nearest_ - 1] + max_threshold;
+    cost_threshold_ = std::min(cost_threshold_, kth_cost);
+    if (pred.cost().cost > kth_cost) {
+      return true;
+    }
+  }
   return settled_count_ == destinations_.size();
 }
 
-// Form the time, distance matrix from the destinations list
+// Form the time, distance matrix from the destinations list. Destinations
+// beyond the time or distance limits are marked as not found.
 std::vector<TimeDistance> TimeDistanceMatrix::FormTimeDistanceMatrix() {
+  // In k-nearest mode mark all but the k least cost destinations as not
+  // found by giving them the maximum cost. Ties go to the lower location
+  // index so results do not depend on the nth_element implementation.
+  if (k_nearest_ > 0) {
+    std::vector<uint32_t> order(destinations_.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+    std::nth_element(order.begin(), order.begin() + k_nearest_, order.end(),
+             [this](const uint32_t a, const uint32_t b) {
+               float cost_a = destinations_[a].best_cost.cost;
+               float cost_b = destinations_[b].best_cost.cost;
+               return cost_a < cost_b || (cost_a == cost_b && a < b);
+             });
+    for (auto it = order.begin() + k_nearest_; it != order.end(); it++) {
+      destinations_[*it].best_cost = Cost(kMaxCost, kMaxCost);
+    }
+  }
+
   std::vector<TimeDistance> td;
   for (auto& dest : destinations_) {
-    td.emplace_back(dest.best_cost.secs, dest.distance);
+    if (dest.best_cost.secs > max_time_ || dest.distance > max_distance_) {
+      td.emplace_back(kMaxCost, kMaxCost);
+    } else {
+      td.emplace_back(dest.best_cost.secs, dest.distance);
+    }
   }
   return td;
 }
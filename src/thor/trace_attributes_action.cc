@@ -170,7 +170,7 @@ namespace {
         }
 
         // Process edge end node only if any node items are enabled
-        if (controller.category_attribute_enabled(kNodeCategory)) {
+        if (controller.category_enabled(TripPathCategory::kNode)) {
           const auto& node = trip_path.node(i);
           auto end_node_map = json::map({});
 
@@ -293,12 +293,12 @@ void thor_worker_t::filter_attributes(const boost::property_tree::ptree& request
   if (filter_action.size() && filter_action == "include") {
     controller.disable_all();
     for (const auto& kv : request.get_child("filters.attributes"))
-      controller.attributes.at(kv.second.get_value<std::string>()) = true;
+      controller.set_attribute(kv.second.get_value<std::string>(), true);
 
   } else if (filter_action.size() && filter_action == "exclude") {
     controller.enable_all();
     for (const auto& kv : request.get_child("filters.attributes"))
-      controller.attributes.at(kv.second.get_value<std::string>()) = false;
+      controller.set_attribute(kv.second.get_value<std::string>(), false);
 
   } else {
     controller.enable_all();
@@ -328,7 +328,7 @@ worker_t::result_t thor_worker_t::trace_attributes(
    * Valhalla will allow an efficient “edge-walking” algorithm rather than a more extensive
    * map-matching method. If true, this enforces to only use exact route match algorithm.
    */
-  odin::TripPath trip_path;
+  odin::TripPath* trip_path = nullptr;
   TripPathController controller;
   filter_attributes(request, controller);
   auto shape_match = STRING_TO_MATCH.find(request.get<std::string>("shape_match", "walk_or_snap"));
@@ -343,7 +343,7 @@ worker_t::result_t thor_worker_t::trace_attributes(
           //TODO: remove after dev complete
           LOG_INFO("in " + shape_match->first);
           trip_path = route_match(controller);
-          if (trip_path.node().size() == 0)
+          if (trip_path->node().size() == 0)
             throw valhalla_exception_t{400, 443};
         } catch (const valhalla_exception_t& e) {
           LOG_INFO(shape_match->first + " algorithm failed to find exact route match.  Try using shape_match:'walk_or_snap' to fallback to map-matching algorithm");
@@ -369,7 +369,7 @@ worker_t::result_t thor_worker_t::trace_attributes(
         //TODO: remove after dev complete
         LOG_INFO("in " + shape_match->first);
         trip_path = route_match(controller);
-        if (trip_path.node().size() == 0) {
+        if (trip_path->node().size() == 0) {
           LOG_INFO(shape_match->first + " algorithm failed to find exact route match; Falling back to map_match...");
           try {
             trip_path = map_match(controller);
@@ -391,8 +391,8 @@ worker_t::result_t thor_worker_t::trace_attributes(
 
   //serialize output to Thor
   json::MapPtr json;
-  if (trip_path.node().size() > 0)
-    json = serialize(controller, trip_path, id, directions_options);
+  if (trip_path->node().size() > 0)
+    json = serialize(controller, *trip_path, id, directions_options);
   else throw valhalla_exception_t{400, 442};
 
   //jsonp callback if need be
@@ -44,7 +44,7 @@ worker_t::result_t thor_worker_t::trace_route(const boost::property_tree::ptree
    * Valhalla will allow an efficient “edge-walking” algorithm rather than a more extensive
    * map-matching method. If true, this enforces to only use exact route match algorithm.
    */
-  odin::TripPath trip_path;
+  odin::TripPath* trip_path = nullptr;
   TripPathController controller;
 
   worker_t::result_t result { true };
@@ -63,7 +63,7 @@ worker_t::result_t thor_worker_t::trace_route(const boost::property_tree::ptree
           //TODO: remove after dev complete
           LOG_INFO("in " + shape_match->first);
           trip_path = route_match(controller);
-          if (trip_path.node().size() == 0)
+          if (trip_path->node().size() == 0)
             throw valhalla_exception_t{400, 443};
         } catch (const valhalla_exception_t& e) {
           LOG_INFO(shape_match->first + " algorithm failed to find exact route match.  Try using shape_match:'walk_or_snap' to fallback to map-matching algorithm");
@@ -89,7 +89,7 @@ worker_t::result_t thor_worker_t::trace_route(const boost::property_tree::ptree
         //TODO: remove after dev complete
         LOG_INFO("in " + shape_match->first);
         trip_path = route_match(controller);
-        if (trip_path.node().size() == 0) {
+        if (trip_path->node().size() == 0) {
           LOG_INFO(shape_match->first + " algorithm failed to find exact route match; Falling back to map_match...");
           try {
             trip_path = map_match(controller);
@@ -100,10 +100,10 @@ worker_t::result_t thor_worker_t::trace_route(const boost::property_tree::ptree
         }
         break;
       }
-      log_admin(trip_path);
+      log_admin(trip_admins);
     }
 
-  result.messages.emplace_back(trip_path.SerializeAsString());
+  result.messages.emplace_back(trip_path->SerializeAsString());
 
   // Get processing time for thor
   auto e = std::chrono::system_clock::now();
@@ -129,18 +129,19 @@ worker_t::result_t thor_worker_t::trace_route(const boost::property_tree::ptree
  * form the list of edges. It will return no nodes if path not found.
  *
  */
-odin::TripPath thor_worker_t::route_match(const TripPathController& controller) {
-  odin::TripPath trip_path;
+odin::TripPath* thor_worker_t::route_match(const TripPathController& controller) {
+  auto trip_path = new_trip_path();
   std::vector<PathInfo> path_infos;
   if (RouteMatcher::FormPath(mode_costing, mode, reader, shape, correlated, path_infos)) {
     // Empty through location list
     std::vector<baldr::PathLocation> through_loc;
 
     // Form the trip path based on mode costing, origin, destination, and path edges
-    trip_path = thor::TripPathBuilder::Build(controller, reader, mode_costing,
-                                             path_infos, correlated.front(),
-                                             correlated.back(), through_loc,
-                                             interrupt_callback);
+    thor::TripPathBuilder::Build(controller, reader, mode_costing,
+                                 path_infos, correlated.front(),
+                                 correlated.back(), through_loc, *trip_path,
+                                 interrupt_callback, shape_cache.get(),
+                                 &admin_cache, &trip_admins);
   }
 
   return trip_path;
@@ -150,8 +151,8 @@ odin::TripPath thor_worker_t::route_match(const TripPathController& controller)
 // PathInfo is primarily a list of edge Ids but it also include elapsed time to the end
 // of each edge. We will need to use the existing costing method to form the elapsed time
 // the path. We will start with just using edge costs and will add transition costs.
-odin::TripPath thor_worker_t::map_match(const TripPathController& controller) {
-  odin::TripPath trip_path;
+odin::TripPath* thor_worker_t::map_match(const TripPathController& controller) {
+  auto trip_path = new_trip_path();
   // Call Meili for map matching to get a collection of pathLocation Edges
   // Create a matcher
   std::shared_ptr<meili::MapMatcher> matcher;
@@ -253,10 +254,11 @@ odin::TripPath thor_worker_t::map_match(const TripPathController& controller) {
     std::vector<baldr::PathLocation> through_loc;
 
     // Form the trip path based on mode costing, origin, destination, and path edges
-    trip_path = thor::TripPathBuilder::Build(controller, matcher->graphreader(),
-                                             mode_costing, path_edges, origin,
-                                             destination, through_loc,
-                                             interrupt_callback);
+    thor::TripPathBuilder::Build(controller, matcher->graphreader(),
+                                 mode_costing, path_edges, origin,
+                                 destination, through_loc, *trip_path,
+                                 interrupt_callback, shape_cache.get(),
+                                 &admin_cache, &trip_admins);
   } else {
     throw baldr::valhalla_exception_t { 400, 442 };
   }
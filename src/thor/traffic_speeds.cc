@@ -0,0 +1,151 @@
+#include <valhalla/midgard/constants.h>
+#include <valhalla/baldr/datetime.h>
+#include "thor/traffic_speeds.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+TrafficSpeeds::TrafficSpeeds()
+    : level_(0),
+      use_historical_(false),
+      hour_(0),
+      tile_(nullptr),
+      tileid_(0),
+      tile_set_(false) {
+}
+
+// Set the real-time speed store
+void TrafficSpeeds::set_speed_store(const std::shared_ptr<SpeedStore>& speed_store,
+                                    const uint32_t level) {
+  Clear();
+  speed_store_ = speed_store;
+  level_ = level;
+}
+
+// Set the historical speed store
+void TrafficSpeeds::set_historical_store(
+                const std::shared_ptr<SpeedStore>& historical_store) {
+  Clear();
+  historical_store_ = historical_store;
+}
+
+// Set the hour of the week at which historical speeds are used. Historical
+// speeds are only read while used, so tiles read before are dropped when
+// they start being used.
+void TrafficSpeeds::SetDeparture(GraphReader& graphreader,
+                                 PathLocation& origin) {
+  uint32_t seconds;
+  bool use_historical = historical_store_ &&
+                        WeekSeconds(graphreader, origin, seconds);
+  if (use_historical && !use_historical_) {
+    Clear();
+  }
+  use_historical_ = use_historical;
+  hour_ = use_historical_ ? HistoricalSpeeds::HourOfWeek(seconds) : 0;
+}
+
+// Get the seconds from the start of the week (Sunday 00:00) at the origin
+// date_time. A "current" date_time is resolved using the timezone at the
+// end of the first origin edge.
+bool TrafficSpeeds::WeekSeconds(GraphReader& graphreader,
+                                PathLocation& origin, uint32_t& seconds) {
+  if (!origin.date_time_ || origin.edges.empty()) {
+    return false;
+  }
+  if (*origin.date_time_ == "current") {
+    const GraphTile* tile = graphreader.GetGraphTile(origin.edges.front().id);
+    if (tile == nullptr) {
+      return false;
+    }
+    const DirectedEdge* edge = tile->directededge(origin.edges.front().id);
+    const GraphTile* endtile = graphreader.GetGraphTile(edge->endnode());
+    if (endtile == nullptr) {
+      return false;
+    }
+    origin.date_time_ = DateTime::iso_date_time(DateTime::get_tz_db().from_index(
+                            endtile->node(edge->endnode())->timezone()));
+  }
+
+  uint32_t dow = DateTime::day_of_week_mask(*origin.date_time_);
+  uint32_t day = 0;
+  while (day < 7 && (dow & (1 << day)) == 0) {
+    day++;
+  }
+  seconds = (day % 7) * 24 * 3600 +
+            DateTime::seconds_from_midnight(*origin.date_time_);
+  return true;
+}
+
+// Get the real-time speed of a directed edge or else its historical speed.
+// Consecutive lookups are usually within the same tile so the tile last
+// used is checked first.
+uint8_t TrafficSpeeds::speed(const GraphId& edgeid) {
+  if (!enabled() || edgeid.level() != level_) {
+    return 0;
+  }
+  uint32_t tileid = edgeid.tileid();
+  if (!tile_set_ || tileid != tileid_) {
+    auto found = tiles_.find(tileid);
+    if (found == tiles_.end()) {
+      TileSpeeds speeds;
+      if (speed_store_) {
+        speeds.realtime = speed_store_->Get(tileid);
+      }
+      if (use_historical_) {
+        speeds.historical = HistoricalSpeeds(historical_store_->Get(tileid));
+      }
+      found = tiles_.emplace(tileid, std::move(speeds)).first;
+    }
+    tile_ = &found->second;
+    tileid_ = tileid;
+    tile_set_ = true;
+  }
+  uint8_t s = tile_->realtime ? tile_->realtime->speed(edgeid.id()) : 0;
+  if (s == 0 && use_historical_) {
+    s = tile_->historical.speed(edgeid.id(), hour_);
+  }
+  return s;
+}
+
+// Get the cost of traversing a directed edge. Real-time speeds are only
+// used when driving.
+Cost TrafficSpeeds::EdgeCost(const std::shared_ptr<DynamicCost>& costing,
+                             const DirectedEdge* edge, const GraphId& edgeid) {
+  uint8_t s = enabled(costing) ? speed(edgeid) : 0;
+  if (s == 0) {
+    return costing->EdgeCost(edge);
+  }
+  float sec = edge->length() * (midgard::kSecPerHour * 0.001f) /
+              static_cast<float>(s);
+  return { sec, sec };
+}
+
+// Get the cost of traversing a directed edge and halve the transition cost
+// if the edge has a real-time speed
+Cost TrafficSpeeds::EdgeCost(const std::shared_ptr<DynamicCost>& costing,
+                             const DirectedEdge* edge, const GraphId& edgeid,
+                             Cost& transition_cost) {
+  uint8_t s = enabled(costing) ? speed(edgeid) : 0;
+  if (s == 0) {
+    return costing->EdgeCost(edge);
+  }
+  transition_cost.cost *= 0.5f;
+  transition_cost.secs *= 0.5f;
+  float sec = edge->length() * (midgard::kSecPerHour * 0.001f) /
+              static_cast<float>(s);
+  return { sec, sec };
+}
+
+// Clear the speed tiles used by the search
+void TrafficSpeeds::Clear() {
+  tiles_.clear();
+  tile_ = nullptr;
+  tile_set_ = false;
+}
+
+}
+}
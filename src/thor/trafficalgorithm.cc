@@ -1,9 +1,8 @@
-#include <iostream> // TODO remove if not needed
 #include <map>
 #include <algorithm>
 #include "thor/trafficalgorithm.h"
-#include <valhalla/baldr/datetime.h>
 #include <valhalla/midgard/logging.h>
+#include <valhalla/midgard/constants.h>
 
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
@@ -11,12 +10,38 @@ using namespace valhalla::sif;
 // TODO: make a class that extends std::exception, with messages and
 // error codes and return the appropriate error codes
 
+namespace {
+
+// Cost (seconds) of traversing an edge at a traffic speed (kph)
+Cost SpeedCost(const DirectedEdge* edge, const uint8_t speed) {
+  float sec = edge->length() * (valhalla::midgard::kSecPerHour * 0.001f) /
+          static_cast<float>(speed);
+  return { sec, sec };
+}
+
+// Part of a destination edge beyond the destination location
+float Remainder(const PathLocation& dest, const GraphId& edgeid) {
+  for (const auto& edge : dest.edges) {
+    if (edge.id == edgeid) {
+      return 1.0f - edge.dist;
+    }
+  }
+  return 0.0f;
+}
+
+}
+
 namespace valhalla {
 namespace thor {
 
 // Default constructor
 TrafficAlgorithm::TrafficAlgorithm()
-    : AStarPathAlgorithm() {
+    : AStarPathAlgorithm(),
+      time_dependent_(false),
+      use_historical_(false),
+      week_start_(0),
+      speed_level_(0),
+      speed_level_set_(false) {
 }
 
 // Destructor
@@ -24,7 +49,8 @@ TrafficAlgorithm::~TrafficAlgorithm() {
   Clear();
 }
 
-// Calculate best path. This method is single mode, not time-dependent.
+// Calculate best path. This method is single mode. It is time-dependent
+// only when set to use historical speeds and the origin has a date_time.
 std::vector<PathInfo> TrafficAlgorithm::GetBestPath(PathLocation& origin,
              PathLocation& destination, GraphReader& graphreader,
              const std::shared_ptr<DynamicCost>* mode_costing,
@@ -37,11 +63,26 @@ std::vector<PathInfo> TrafficAlgorithm::GetBestPath(PathLocation& origin,
   Init(origin.edges.front().projected, destination.edges.front().projected, costing);
   float mindist = astarheuristic_.GetDistance(origin.edges.front().projected);
 
-  // Initialize the origin and destination locations. Initialize the
+  // Speed tiles are for the local level unless a level was set with the
+  // speed store
+  if (!speed_level_set_) {
+    speed_level_ = graphreader.GetTileHierarchy().levels().rbegin()->first;
+    speed_level_set_ = true;
+  }
+
+  // Get the time of the week at the origin before the origin edges are
+  // costed. Initialize the origin and destination locations. Initialize the
   // destination first in case the origin edge includes a destination edge.
+  SetWeekStart(graphreader, origin);
   uint32_t density = SetDestination(graphreader, destination, costing);
   SetOrigin(graphreader, origin, destination, costing);
 
+  // Real-time and historical speeds of the tile last expanded
+  std::shared_ptr<const SpeedTile> speeds;
+  HistoricalSpeeds historical;
+  GraphId speeds_tile;
+  bool speeds_set = false;
+
   // Find shortest path
   uint32_t nc = 0;       // Count of iterations with no convergence
                          // towards destination
@@ -102,8 +143,20 @@ std::vector<PathInfo> TrafficAlgorithm::GetBestPath(PathLocation& origin,
       continue;
     }
 
-    // Check if this tile has real-time speeds
-    std::vector<uint8_t>& speeds = GetRealTimeSpeeds(node.tileid(), graphreader);
+    // Check if this tile has real-time speeds. Consecutive expansions are
+    // usually within the same tile so only look up the store on a change.
+    // Only tiles on the speed level have speeds.
+    if (!speeds_set || node.tileid() != speeds_tile.tileid() ||
+        node.level() != speeds_tile.level()) {
+      bool speed_level = node.level() == speed_level_;
+      speeds = speed_level ? GetRealTimeSpeeds(node.tileid(), graphreader) :
+                             nullptr;
+      historical = (speed_level && use_historical_) ?
+                   GetHistoricalSpeeds(node.tileid(), graphreader) :
+                   HistoricalSpeeds();
+      speeds_tile = GraphId(node.tileid(), node.level(), 0);
+      speeds_set = true;
+    }
 
     // Expand from end node.
     GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
@@ -131,13 +184,17 @@ std::vector<PathInfo> TrafficAlgorithm::GetBestPath(PathLocation& origin,
       // TODO - want to add a traffic costing method in sif
       Cost edge_cost;
       Cost tc = costing->TransitionCost(directededge, nodeinfo, pred);
-      if (speeds.size() == 0 || speeds[edgeid.id()] == 0) {
+      uint8_t speed = (speeds == nullptr) ? 0 : speeds->speed(edgeid.id());
+      if (speed == 0 && use_historical_) {
+        // Historical speed at the time the edge is reached
+        uint32_t secs = week_start_ + static_cast<uint32_t>(pred.cost().secs);
+        speed = historical.speed(edgeid.id(), HistoricalSpeeds::HourOfWeek(secs));
+      }
+      if (speed == 0) {
         edge_cost = costing->EdgeCost(directededge);
       } else {
         // Traffic exists for this edge
-        float sec = directededge->length() * (kSecPerHour * 0.001f) /
-                static_cast<float>(speeds[edgeid.id()]);
-        edge_cost = { sec, sec };
+        edge_cost = SpeedCost(directededge, speed);
 
         // For now reduce transition cost by half...thought is that traffic
         // will account for some of the transition cost
@@ -149,10 +206,11 @@ std::vector<PathInfo> TrafficAlgorithm::GetBestPath(PathLocation& origin,
       Cost newcost = pred.cost() + edge_cost + tc;
 
       // If this edge is a destination, subtract the partial/remainder cost
-      // (cost from the dest. location to the end of the edge).
+      // (cost from the dest. location to the end of the edge). The remainder
+      // is costed at the speed the edge is reached with.
       auto p = destinations_.find(edgeid);
       if (p != destinations_.end()) {
-        newcost -= p->second;
+        newcost -= edge_cost * Remainder(destination, edgeid);
       }
 
       // Check if edge is temporarily labeled and this path has less cost. If
@@ -187,33 +245,58 @@ std::vector<PathInfo> TrafficAlgorithm::GetBestPath(PathLocation& origin,
   return {};      // Should never get here
 }
 
-std::vector<uint8_t>& TrafficAlgorithm::GetRealTimeSpeeds(const uint32_t tileid,
+// Get the real-time speed tile for the specified tile. Creates the speed
+// store for the tile directory if one has not been set.
+std::shared_ptr<const SpeedTile> TrafficAlgorithm::GetRealTimeSpeeds(
+                               const uint32_t tileid,
                                GraphReader& graphreader) {
-  // Check if this tile has real-time speeds
-  auto rts = real_time_speeds_.find(tileid);
-  if (rts == real_time_speeds_.end()) {
-    // Try to load the speeds file
-    std::ifstream rtsfile;
-    std::string traffic_dir = graphreader.GetTileHierarchy().tile_dir() + "/traffic/";
-    std::string fname = traffic_dir + std::to_string(tileid) + ".spd";
-    rtsfile.open(fname, std::ios::binary | std::ios::in | std::ios::ate);
-    if (rtsfile.is_open()) {
-      uint32_t count = rtsfile.tellg();
-      LOG_INFO("Load real time speeds: count = " + std::to_string(count));
-      rtsfile.seekg(0, rtsfile.beg);
-      std::vector<uint8_t> spds(count);
-      rtsfile.read((char*)(&spds.front()), count);
-      rtsfile.close();
-      real_time_speeds_[tileid] = spds;
-      return real_time_speeds_[tileid];
-    } else {
-      return empty_speeds_;
-    }
-  } else {
-    return rts->second;
+  if (!speed_store_) {
+    speed_store_ = std::make_shared<SpeedStore>(
+        graphreader.GetTileHierarchy().tile_dir() + "/traffic/");
+  }
+  return speed_store_->Get(tileid);
+}
+
+// Get the historical speeds for the specified tile. Creates the historical
+// speed store for the tile directory if one has not been set.
+HistoricalSpeeds TrafficAlgorithm::GetHistoricalSpeeds(const uint32_t tileid,
+                               GraphReader& graphreader) {
+  if (!historical_store_) {
+    historical_store_ = std::make_shared<SpeedStore>(
+        graphreader.GetTileHierarchy().tile_dir() + "/traffic/",
+        kDefaultMaxSpeedTiles, kDefaultSpeedReloadInterval, ".hsp");
   }
+  return HistoricalSpeeds(historical_store_->Get(tileid));
+}
+
+// Set whether the path uses historical speeds and the seconds from the start
+// of the week (Sunday 00:00) at the origin. A "current" origin date_time is
+// resolved here rather than by SetOrigin so origin edges are costed at the
+// origin time.
+void TrafficAlgorithm::SetWeekStart(GraphReader& graphreader,
+                                    PathLocation& origin) {
+  week_start_ = 0;
+  use_historical_ = time_dependent_ &&
+        TrafficSpeeds::WeekSeconds(graphreader, origin, week_start_);
 }
 
+// Get the cost of a directed edge at the origin or destination with its
+// real-time speed or its historical speed at the origin time.
+Cost TrafficAlgorithm::LocationEdgeCost(GraphReader& graphreader,
+                 const std::shared_ptr<DynamicCost>& costing,
+                 const DirectedEdge* edge, const GraphId& edgeid,
+                 const bool origin) {
+  if (edgeid.level() != speed_level_) {
+    return costing->EdgeCost(edge);
+  }
+  auto speeds = GetRealTimeSpeeds(edgeid.tileid(), graphreader);
+  uint8_t speed = (speeds == nullptr) ? 0 : speeds->speed(edgeid.id());
+  if (speed == 0 && use_historical_) {
+    speed = GetHistoricalSpeeds(edgeid.tileid(), graphreader).speed(
+                edgeid.id(), HistoricalSpeeds::HourOfWeek(week_start_));
+  }
+  return (speed == 0) ? costing->EdgeCost(edge) : SpeedCost(edge, speed);
+}
 
 }
 }
@@ -0,0 +1,81 @@
+#include "thor/transit_operators.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// Operator Id of a transit route not yet looked up
+constexpr uint32_t kUnknownOperator = 0xffffffff;
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+TransitOperators::TransitOperators()
+    : last_tileid_(0),
+      last_routes_(nullptr) {
+}
+
+// Get the operator Id of a transit route. Reads the operator name only the
+// first time the route is looked up.
+uint32_t TransitOperators::GetOperatorId(const GraphTile* tile,
+                                         const uint32_t routeid) {
+  auto& routes = Routes(tile->id().value);
+  if (routeid < routes.size() && routes[routeid] != kUnknownOperator) {
+    return routes[routeid];
+  }
+  const TransitRoute* transit_route = tile->GetTransitRoute(routeid);
+  return AddRoute(routes, routeid,
+                  (transit_route && transit_route->op_by_onestop_id_offset()) ?
+                  tile->GetName(transit_route->op_by_onestop_id_offset()) : "");
+}
+
+// Get the operator Id of a transit route, resolving the operator only the
+// first time the route is looked up.
+uint32_t TransitOperators::GetOperatorId(const uint64_t tileid,
+                         const uint32_t routeid,
+                         const std::function<std::string ()>& resolve) {
+  auto& routes = Routes(tileid);
+  if (routeid < routes.size() && routes[routeid] != kUnknownOperator) {
+    return routes[routeid];
+  }
+  return AddRoute(routes, routeid, resolve());
+}
+
+// Clear the operator Ids
+void TransitOperators::Clear() {
+  operators_.clear();
+  route_operators_.clear();
+  last_routes_ = nullptr;
+}
+
+// Get the operator Ids of the routes within a tile. References to the
+// routes stay valid as other tiles are added.
+std::vector<uint32_t>& TransitOperators::Routes(const uint64_t tileid) {
+  if (last_routes_ == nullptr || tileid != last_tileid_) {
+    last_routes_ = &route_operators_[tileid];
+    last_tileid_ = tileid;
+  }
+  return *last_routes_;
+}
+
+// Set the operator Id of a route. Look up the operator name in the operators
+// map, adding the operator if not found.
+uint32_t TransitOperators::AddRoute(std::vector<uint32_t>& routes,
+                                    const uint32_t routeid,
+                                    const std::string& operator_name) {
+  if (routeid >= routes.size()) {
+    routes.resize(routeid + 1, kUnknownOperator);
+  }
+  uint32_t id = 0;
+  if (!operator_name.empty()) {
+    id = operators_.emplace(operator_name, operators_.size() + 1).first->second;
+  }
+  routes[routeid] = id;
+  return id;
+}
+
+}
+}
@@ -0,0 +1,60 @@
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/distanceapproximator.h>
+#include <valhalla/baldr/tilehierarchy.h>
+#include "thor/transit_stop_index.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+
+namespace valhalla {
+namespace thor {
+
+// Check if there is a transit stop within a straight line distance of a
+// location. Transit tiles are one level below the local level and use the
+// same tiling.
+bool TransitStopIndex::HasStopWithin(GraphReader& graphreader,
+                                     const PointLL& ll, const float distance) {
+  const auto& local = graphreader.GetTileHierarchy().levels().rbegin()->second;
+  uint32_t transit_level = local.level + 1;
+  float dlat = distance / kMetersPerDegreeLat;
+  float dlng = distance / DistanceApproximator::MetersPerLngDegree(ll.lat());
+  AABB2<PointLL> bbox(ll.lng() - dlng, ll.lat() - dlat,
+                      ll.lng() + dlng, ll.lat() + dlat);
+  for (auto tileid : local.tiles.TileList(bbox)) {
+    for (const auto& stop : Stops(graphreader, GraphId(tileid, transit_level, 0))) {
+      if (stop.Distance(ll) < distance) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Clear the index
+void TransitStopIndex::Clear() {
+  stops_.clear();
+}
+
+// Get the transit stops in a tile, finding them if not yet indexed. Tiles
+// that do not exist are indexed with no stops.
+const std::vector<PointLL>& TransitStopIndex::Stops(GraphReader& graphreader,
+                                                    const GraphId& tileid) {
+  auto cached = stops_.find(tileid.value);
+  if (cached != stops_.end()) {
+    return cached->second;
+  }
+  auto& stops = stops_[tileid.value];
+  const GraphTile* tile = graphreader.GetGraphTile(tileid);
+  if (tile != nullptr) {
+    for (uint32_t i = 0; i < tile->header()->nodecount(); i++) {
+      const NodeInfo* nodeinfo = tile->node(i);
+      if (nodeinfo->type() == NodeType::kMultiUseTransitStop) {
+        stops.push_back(nodeinfo->latlng());
+      }
+    }
+  }
+  return stops;
+}
+
+}
+}
@@ -2,6 +2,110 @@
 #include <string>
 
 
+namespace {
+
+using namespace valhalla::thor;
+
+// Attribute keys in TripPathAttribute order
+const std::string* const kAttributeKeys[] = {
+  &kEdgeNames,
+  &kEdgeLength,
+  &kEdgeSpeed,
+  &kEdgeRoadClass,
+  &kEdgeBeginHeading,
+  &kEdgeEndHeading,
+  &kEdgeBeginShapeIndex,
+  &kEdgeEndShapeIndex,
+  &kEdgeTraversability,
+  &kEdgeUse,
+  &kEdgeToll,
+  &kEdgeUnpaved,
+  &kEdgeTunnel,
+  &kEdgeBridge,
+  &kEdgeRoundabout,
+  &kEdgeInternalIntersection,
+  &kEdgeDriveOnRight,
+  &kEdgeSurface,
+  &kEdgeSignExitNumber,
+  &kEdgeSignExitBranch,
+  &kEdgeSignExitToward,
+  &kEdgeSignExitName,
+  &kEdgeTravelMode,
+  &kEdgeVehicleType,
+  &kEdgePedestrianType,
+  &kEdgeBicycleType,
+  &kEdgeTransitType,
+  &kEdgeTransitRouteInfoOnestopId,
+  &kEdgeTransitRouteInfoBlockId,
+  &kEdgeTransitRouteInfoTripId,
+  &kEdgeTransitRouteInfoShortName,
+  &kEdgeTransitRouteInfoLongName,
+  &kEdgeTransitRouteInfoHeadsign,
+  &kEdgeTransitRouteInfoColor,
+  &kEdgeTransitRouteInfoTextColor,
+  &kEdgeTransitRouteInfoDescription,
+  &kEdgeTransitRouteInfoOperatorOnestopId,
+  &kEdgeTransitRouteInfoOperatorName,
+  &kEdgeTransitRouteInfoOperatorUrl,
+  &kEdgeId,
+  &kEdgeWayId,
+  &kEdgeWeightedGrade,
+  &kEdgeMaxUpwardGrade,
+  &kEdgeMaxDownwardGrade,
+  &kEdgeLaneCount,
+  &kEdgeCycleLane,
+  &kEdgeBicycleNetwork,
+  &kEdgeSidewalk,
+  &kEdgeDensity,
+  &kEdgeSpeedLimit,
+  &kEdgeTruckSpeed,
+  &kEdgeTruckRoute,
+  &kNodeIntersectingEdgeBeginHeading,
+  &kNodeIntersectingEdgeFromEdgeNameConsistency,
+  &kNodeIntersectingEdgeToEdgeNameConsistency,
+  &kNodeIntersectingEdgeDriveability,
+  &kNodeIntersectingEdgeCyclability,
+  &kNodeIntersectingEdgeWalkability,
+  &kNodeElapsedTime,
+  &kNodeaAdminIndex,
+  &kNodeType,
+  &kNodeFork,
+  &kNodeTransitStopInfoType,
+  &kNodeTransitStopInfoOnestopId,
+  &kNodetransitStopInfoName,
+  &kNodeTransitStopInfoArrivalDateTime,
+  &kNodeTransitStopInfoDepartureDateTime,
+  &kNodeTransitStopInfoIsParentStop,
+  &kNodeTransitStopInfoAssumedSchedule,
+  &kNodeTransitStopInfoLatLon,
+  &kNodeTimeZone,
+  &kOsmChangeset,
+  &kAdminCountryCode,
+  &kAdminCountryText,
+  &kAdminStateCode,
+  &kAdminStateText,
+  &kShape,
+};
+static_assert(sizeof(kAttributeKeys) / sizeof(kAttributeKeys[0]) ==
+                  kTripPathAttributeCount,
+              "An attribute key is needed for each trip path attribute");
+
+// Mask of the attributes whose keys start with the category
+std::bitset<kTripPathAttributeCount> CategoryMask(const std::string& category) {
+  std::bitset<kTripPathAttributeCount> mask;
+  for (size_t i = 0; i < kTripPathAttributeCount; i++) {
+    if (kAttributeKeys[i]->compare(0, category.size(), category) == 0) {
+      mask.set(i);
+    }
+  }
+  return mask;
+}
+
+const std::bitset<kTripPathAttributeCount> kNodeMask = CategoryMask(kNodeCategory);
+const std::bitset<kTripPathAttributeCount> kAdminMask = CategoryMask(kAdminCategory);
+
+}
+
 namespace valhalla {
 namespace thor {
 
@@ -92,24 +196,33 @@ const std::unordered_map<std::string, bool> TripPathController::kRouteAttributes
 
 TripPathController::TripPathController(
     const std::unordered_map<std::string, bool>& new_attributes) {
-  attributes = new_attributes;
+  attributes_ = new_attributes;
+  compile();
 }
 
 void TripPathController::enable_all() {
-  for (auto& pair : attributes) {
+  for (auto& pair : attributes_) {
     pair.second = true;
   }
+  compile();
 }
 
 void TripPathController::disable_all() {
-  for (auto& pair : attributes) {
+  for (auto& pair : attributes_) {
     pair.second = false;
   }
+  compile();
+}
+
+void TripPathController::set_attribute(const std::string& key,
+                                       const bool enabled) {
+  attributes_.at(key) = enabled;
+  compile();
 }
 
 bool TripPathController::category_attribute_enabled(
     const std::string& category) const {
-  for (const auto& pair : attributes) {
+  for (const auto& pair : attributes_) {
     // if the key starts with the specified category and it is enabled
     // then return true
     if ((pair.first.compare(0, category.size(), category) == 0)
@@ -120,5 +233,19 @@ bool TripPathController::category_attribute_enabled(
   return false;
 }
 
+// Compile the attributes into the bitset. Attributes missing from the
+// attributes map are disabled.
+void TripPathController::compile() {
+  enabled_.reset();
+  for (size_t i = 0; i < kTripPathAttributeCount; i++) {
+    auto attribute = attributes_.find(*kAttributeKeys[i]);
+    if (attribute != attributes_.end() && attribute->second) {
+      enabled_.set(i);
+    }
+  }
+  node_enabled_ = (enabled_ & kNodeMask).any();
+  admin_enabled_ = (enabled_ & kAdminMask).any();
+}
+
 }
 }
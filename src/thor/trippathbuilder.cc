@@ -4,6 +4,7 @@
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <stdexcept>
 
 #include "thor/trippathbuilder.h"
 #include "thor/trip_path_controller.h"
@@ -26,6 +27,18 @@ using namespace valhalla::thor;
 
 namespace {
 
+// Get the decoded shape of a directed edge (in the direction of its edge
+// info). Uses the shape cache if there is one.
+std::shared_ptr<const std::vector<PointLL> > GetShape(ShapeCache* shape_cache,
+                                   const GraphTile* tile,
+                                   const DirectedEdge* edge) {
+  if (shape_cache != nullptr) {
+    return shape_cache->Get(tile, edge->edgeinfo_offset());
+  }
+  return std::make_shared<std::vector<PointLL> >(
+      tile->edgeinfo(edge->edgeinfo_offset()).shape());
+}
+
 template<class iter>
 void AddPartialShape(std::vector<PointLL>& shape, iter start, iter end,
                      float partial_length, bool back_insert,
@@ -91,25 +104,27 @@ void TrimShape(std::vector<PointLL>& shape, const float start,
   }
 }
 
+// Get the trip path admin index of an admin record. Admins are compared by
+// the Id of the distinct admin.
 uint32_t GetAdminIndex(
-    const AdminInfo& admin_info,
-    std::unordered_map<AdminInfo, uint32_t, AdminInfo::AdminInfoHasher>& admin_info_map,
-    std::vector<AdminInfo>& admin_info_list) {
+    const AdminRecord* admin,
+    std::unordered_map<uint32_t, uint32_t>& admin_index_map,
+    std::vector<const AdminRecord*>& admin_list) {
 
   uint32_t admin_index = 0;
-  auto existing_admin = admin_info_map.find(admin_info);
+  auto existing_admin = admin_index_map.find(admin->id);
 
   // If admin was not processed yet
-  if (existing_admin == admin_info_map.end()) {
+  if (existing_admin == admin_index_map.end()) {
 
     // Assign new admin index
-    admin_index = admin_info_list.size();
+    admin_index = admin_list.size();
 
-    // Add admin info to list
-    admin_info_list.emplace_back(admin_info);
+    // Add admin record to list
+    admin_list.emplace_back(admin);
 
-    // Add admin info/index pair to map
-    admin_info_map.emplace(admin_info, admin_index);
+    // Add admin Id/index pair to map
+    admin_index_map.emplace(admin->id, admin_index);
   }
   // Use known admin
   else {
@@ -120,27 +135,27 @@ uint32_t GetAdminIndex(
 
 void AssignAdmins(const TripPathController& controller,
                   TripPath& trip_path,
-                  const std::vector<AdminInfo>& admin_info_list) {
-  if (controller.category_attribute_enabled(kAdminCategory)) {
+                  const std::vector<const AdminRecord*>& admin_list) {
+  if (controller.category_enabled(TripPathCategory::kAdmin)) {
     // Assign the admins
-    for (const auto& admin_info : admin_info_list) {
+    for (const auto* admin : admin_list) {
       TripPath_Admin* trip_admin = trip_path.add_admin();
 
       // Set country code if requested
-      if (controller.attributes.at(kAdminCountryCode))
-        trip_admin->set_country_code(admin_info.country_iso());
+      if (controller.enabled(TripPathAttribute::kAdminCountryCode))
+        trip_admin->set_country_code(admin->country_iso);
 
       // Set country text if requested
-      if (controller.attributes.at(kAdminCountryText))
-        trip_admin->set_country_text(admin_info.country_text());
+      if (controller.enabled(TripPathAttribute::kAdminCountryText))
+        trip_admin->set_country_text(admin->country_text);
 
       // Set state code if requested
-      if (controller.attributes.at(kAdminStateCode))
-        trip_admin->set_state_code(admin_info.state_iso());
+      if (controller.enabled(TripPathAttribute::kAdminStateCode))
+        trip_admin->set_state_code(admin->state_iso);
 
       // Set state text if requested
-      if (controller.attributes.at(kAdminStateText))
-        trip_admin->set_state_text(admin_info.state_text());
+      if (controller.enabled(TripPathAttribute::kAdminStateText))
+        trip_admin->set_state_text(admin->state_text);
     }
   }
 }
@@ -382,20 +397,26 @@ TripPathBuilder::~TripPathBuilder() {
 // For now just find the length of the path!
 // TODO - probably need the location information passed in - to
 // add to the TripPath
-TripPath TripPathBuilder::Build(
+void TripPathBuilder::Build(
     const TripPathController& controller, GraphReader& graphreader,
     const std::shared_ptr<sif::DynamicCost>* mode_costing,
     const std::vector<PathInfo>& path, PathLocation& origin, PathLocation& dest,
-    const std::vector<PathLocation>& through_loc,
-    const std::function<void ()>* interrupt_callback) {
+    const std::vector<PathLocation>& through_loc, TripPath& trip_path,
+    const std::function<void ()>* interrupt_callback,
+    ShapeCache* shape_cache, AdminCache* admin_cache,
+    std::vector<const AdminRecord*>* admins) {
+  // Returned admin records point into the admin cache, so one must be given
+  if (admins != nullptr && admin_cache == nullptr) {
+    throw std::invalid_argument("Admin records require an admin cache");
+  }
+
   // Test interrupt prior to building trip path
   if (interrupt_callback) {
     (*interrupt_callback)();
   }
 
-  // TripPath is a protocol buffer that contains information about the trip
-  TripPath trip_path;
-
+  // TripPath is a protocol buffer that contains information about the trip.
+  // It is created by the caller (e.g. on an arena).
   // Get the local tile level
   uint32_t local_level = graphreader.GetTileHierarchy().levels().rbegin()->first;
 
@@ -520,9 +541,13 @@ TripPath TripPathBuilder::Build(
   if (end_sos != PathLocation::SideOfStreet::NONE)
     tp_dest->set_side_of_street(GetTripPathSideOfStreet(end_sos));
 
-  // Structures to process admins
-  std::unordered_map<AdminInfo, uint32_t, AdminInfo::AdminInfoHasher> admin_info_map;
-  std::vector<AdminInfo> admin_info_list;
+  // Structures to process admins. Admin records are resolved once per tile
+  // admin, in the admin cache if there is one.
+  AdminCache local_admin_cache;
+  AdminCache& admin_records = (admin_cache != nullptr) ? *admin_cache :
+                               local_admin_cache;
+  std::unordered_map<uint32_t, uint32_t> admin_index_map;
+  std::vector<const AdminRecord*> admin_list;
   uint32_t last_node_admin_index;
 
   // If the path was only one edge we have a special case
@@ -530,11 +555,15 @@ TripPath TripPathBuilder::Build(
     const GraphTile* tile = graphreader.GetGraphTile(path.front().edgeid);
     const DirectedEdge* edge = tile->directededge(path.front().edgeid);
 
-    // Get the shape. Reverse if the directed edge direction does
+    // Get the shape, copied in reverse if the directed edge direction does
     // not match the traversal direction (based on start and end percent).
-    auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
+    // The copy is trimmed to the partial edge.
+    auto edge_shape = GetShape(shape_cache, tile, edge);
+    std::vector<PointLL> shape;
     if (edge->forward() != (start_pct < end_pct)) {
-      std::reverse(shape.begin(), shape.end());
+      shape.assign(edge_shape->rbegin(), edge_shape->rend());
+    } else {
+      shape.assign(edge_shape->begin(), edge_shape->end());
     }
 
     // If traversing the opposing direction: adjust start and end percent
@@ -558,30 +587,31 @@ TripPath TripPathBuilder::Build(
     auto trip_edge = AddTripEdge(
         controller, path.front().edgeid, path.front().trip_id, 0,
         path.front().mode, travel_types[static_cast<int>(path.front().mode)],
-        edge, trip_path.add_node(), tile, std::abs(end_pct - start_pct));
+        edge, trip_path.add_node(), tile, *edge_shape,
+        std::abs(end_pct - start_pct));
 
     // Set begin shape index if requested
-    if (controller.attributes.at(kEdgeBeginShapeIndex))
+    if (controller.enabled(TripPathAttribute::kEdgeBeginShapeIndex))
       trip_edge->set_begin_shape_index(0);
     // Set end shape index if requested
-    if (controller.attributes.at(kEdgeEndShapeIndex))
+    if (controller.enabled(TripPathAttribute::kEdgeEndShapeIndex))
       trip_edge->set_end_shape_index(shape.size()-1);
 
     auto* node = trip_path.add_node();
-    if (controller.attributes.at(kNodeElapsedTime))
+    if (controller.enabled(TripPathAttribute::kNodeElapsedTime))
       node->set_elapsed_time(path.front().elapsed_time);
 
     const GraphTile* end_tile = graphreader.GetGraphTile(edge->endnode());
     if (end_tile == nullptr) {
-      if (controller.attributes.at(kNodeaAdminIndex))
+      if (controller.enabled(TripPathAttribute::kNodeaAdminIndex))
           node->set_admin_index(0);
     }
     else {
-      if (controller.attributes.at(kNodeaAdminIndex)) {
+      if (controller.enabled(TripPathAttribute::kNodeaAdminIndex)) {
         node->set_admin_index(
             GetAdminIndex(
-                end_tile->admininfo(end_tile->node(edge->endnode())->admin_index()),
-                admin_info_map, admin_info_list));
+                admin_records.Get(end_tile, end_tile->node(edge->endnode())->admin_index()),
+                admin_index_map, admin_list));
       }
     }
 
@@ -634,15 +664,17 @@ TripPath TripPathBuilder::Build(
     max_ll->set_lng(bbox.maxx());
 
     // Set shape if requested
-    if (controller.attributes.at(kShape))
+    if (controller.enabled(TripPathAttribute::kShape))
       trip_path.set_shape(encode<std::vector<PointLL> >(shape));
 
-    if (controller.attributes.at(kOsmChangeset))
+    if (controller.enabled(TripPathAttribute::kOsmChangeset))
       trip_path.set_osm_changeset(tile->header()->dataset_id());
 
     // Assign the trip path admins
-    AssignAdmins(controller, trip_path, admin_info_list);
-    return trip_path;
+    AssignAdmins(controller, trip_path, admin_list);
+    if (admins != nullptr)
+      *admins = admin_list;
+    return;
   }
 
   // Iterate through path
@@ -677,29 +709,29 @@ TripPath TripPathBuilder::Build(
     const GraphTile* start_tile = graphreader.GetGraphTile(startnode);
     const NodeInfo* node = start_tile->node(startnode);
 
-    if (osmchangeset == 0 && controller.attributes.at(kOsmChangeset))
+    if (osmchangeset == 0 && controller.enabled(TripPathAttribute::kOsmChangeset))
       osmchangeset = start_tile->header()->dataset_id();
 
-    if (controller.attributes.at(kNodeType))
+    if (controller.enabled(TripPathAttribute::kNodeType))
       trip_node->set_type(GetTripPathNodeType(node->type()));
 
     if (node->intersection() == IntersectionType::kFork) {
-      if (controller.attributes.at(kNodeFork))
+      if (controller.enabled(TripPathAttribute::kNodeFork))
         trip_node->set_fork(true);
     }
 
     // Assign the elapsed time from the start of the leg
-    if (controller.attributes.at(kNodeElapsedTime))
+    if (controller.enabled(TripPathAttribute::kNodeElapsedTime))
       trip_node->set_elapsed_time(elapsedtime);
 
     // Assign the admin index
-    if (controller.attributes.at(kNodeaAdminIndex)) {
+    if (controller.enabled(TripPathAttribute::kNodeaAdminIndex)) {
       trip_node->set_admin_index(GetAdminIndex(
-          start_tile->admininfo(node->admin_index()),
-          admin_info_map, admin_info_list));
+          admin_records.Get(start_tile, node->admin_index()),
+          admin_index_map, admin_list));
     }
 
-    if (controller.attributes.at(kNodeTimeZone)) {
+    if (controller.enabled(TripPathAttribute::kNodeTimeZone)) {
       const auto& tz_db = DateTime::get_tz_db();
       auto tz = DateTime::get_tz_db().from_index(node->timezone());
       if(tz)
@@ -721,33 +753,33 @@ TripPath TripPathBuilder::Build(
       // Set type
       if (directededge->use() == Use::kRail) {
         // Set node transit info type if requested
-        if (controller.attributes.at(kNodeTransitStopInfoType))
+        if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoType))
           transit_stop_info->set_type(TripPath_TransitStopInfo_Type_kStation);
         prev_transit_node_type = TripPath_TransitStopInfo_Type_kStation;
       } else if (directededge->use() == Use::kTransitConnection) {
         // Set node transit info type if requested
-        if (controller.attributes.at(kNodeTransitStopInfoType))
+        if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoType))
           transit_stop_info->set_type(prev_transit_node_type);
       } else {
         // Set node transit info type if requested
-        if (controller.attributes.at(kNodeTransitStopInfoType))
+        if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoType))
           transit_stop_info->set_type(TripPath_TransitStopInfo_Type_kStop);
         prev_transit_node_type = TripPath_TransitStopInfo_Type_kStop;
       }
 
       if (transit_stop) {
         // Set onstop_id if requested
-        if (controller.attributes.at(kNodeTransitStopInfoOnestopId) && transit_stop->one_stop_offset())
+        if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoOnestopId) && transit_stop->one_stop_offset())
           transit_stop_info->set_onestop_id(graphtile->GetName(transit_stop->one_stop_offset()));
 
         // Set name if requested
-        if (controller.attributes.at(kNodetransitStopInfoName) && transit_stop->name_offset())
+        if (controller.enabled(TripPathAttribute::kNodetransitStopInfoName) && transit_stop->name_offset())
           transit_stop_info->set_name(graphtile->GetName(transit_stop->name_offset()));
 
         // Set latitude and longitude
         TripPath_LatLng* stop_ll = transit_stop_info->mutable_ll();
         // Set transit stop lat/lon if requested
-        if (controller.attributes.at(kNodeTransitStopInfoLatLon)) {
+        if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoLatLon)) {
           stop_ll->set_lat(node->latlng().lat());
           stop_ll->set_lng(node->latlng().lng());
         }
@@ -755,7 +787,7 @@ TripPath TripPathBuilder::Build(
 
       // Set the arrival time at this node (based on schedule from last trip
       // departure) if requested
-      if (controller.attributes.at(kNodeTransitStopInfoArrivalDateTime) && !arrival_time.empty()) {
+      if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoArrivalDateTime) && !arrival_time.empty()) {
         transit_stop_info->set_arrival_date_time(arrival_time);
       }
 
@@ -772,14 +804,14 @@ TripPath TripPathBuilder::Build(
 
           if (graphtile->header()->date_created() > date) {
             // Set assumed schedule if requested
-            if (controller.attributes.at(kNodeTransitStopInfoAssumedSchedule))
+            if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoAssumedSchedule))
               transit_stop_info->set_assumed_schedule(true);
             assumed_schedule = true;
           } else {
             day = date - graphtile->header()->date_created();
             if (day > graphtile->GetTransitSchedule(transit_departure->schedule_index())->end_day()) {
               // Set assumed schedule if requested
-              if (controller.attributes.at(kNodeTransitStopInfoAssumedSchedule))
+              if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoAssumedSchedule))
                 transit_stop_info->set_assumed_schedule(true);
               assumed_schedule = true;
             }
@@ -797,7 +829,7 @@ TripPath TripPathBuilder::Build(
             dt = dt.substr(0,found);
 
           // Set departure time from this transit stop if requested
-          if (controller.attributes.at(kNodeTransitStopInfoDepartureDateTime))
+          if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoDepartureDateTime))
             transit_stop_info->set_departure_date_time(dt);
 
           //TODO:  set removed tz abbrev on transit_stop_info for departure.
@@ -825,13 +857,13 @@ TripPath TripPathBuilder::Build(
         block_id = 0;
 
         // Set assumed schedule if requested
-        if (controller.attributes.at(kNodeTransitStopInfoAssumedSchedule) && assumed_schedule)
+        if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoAssumedSchedule) && assumed_schedule)
           transit_stop_info->set_assumed_schedule(true);
         assumed_schedule = false;
       }
 
       // Set is_parent_stop if requested. TODO - update with station hierarchy
-      if (controller.attributes.at(kNodeTransitStopInfoIsParentStop))
+      if (controller.enabled(TripPathAttribute::kNodeTransitStopInfoIsParentStop))
         transit_stop_info->set_is_parent_stop(false);
     }
 
@@ -840,20 +872,22 @@ TripPath TripPathBuilder::Build(
     auto is_last_edge = edge_itr == path.end() - 1;
     float length_pct = (
         is_first_edge ? 1.f - start_pct : (is_last_edge ? end_pct : 1.f));
+    // Get the shape once for the edge headings and the trip shape
+    auto edge_shape = GetShape(shape_cache, graphtile, directededge);
     TripPath_Edge* trip_edge = AddTripEdge(controller, edge, trip_id, block_id,
                                            mode, travel_type, directededge,
-                                           trip_node, graphtile, length_pct);
+                                           trip_node, graphtile, *edge_shape,
+                                           length_pct);
 
-    // Get the shape and set shape indexes (directed edge forward flag
-    // determines whether shape is traversed forward or reverse).
-    auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
+    // Set shape indexes (directed edge forward flag determines whether shape
+    // is traversed forward or reverse).
     if (is_first_edge) {
       // Set begin shape index if requested
-      if (controller.attributes.at(kEdgeBeginShapeIndex))
+      if (controller.enabled(TripPathAttribute::kEdgeBeginShapeIndex))
         trip_edge->set_begin_shape_index(0);
     } else {
       // Set begin shape index if requested
-      if (controller.attributes.at(kEdgeBeginShapeIndex))
+      if (controller.enabled(TripPathAttribute::kEdgeBeginShapeIndex))
         trip_edge->set_begin_shape_index(trip_shape.size() - 1);
     }
 
@@ -862,24 +896,24 @@ TripPath TripPathBuilder::Build(
       float length = static_cast<float>(directededge->length()) * length_pct;
       if (directededge->forward() == is_last_edge) {
         AddPartialShape<std::vector<PointLL>::const_iterator>(
-            trip_shape, edgeinfo.shape().begin(), edgeinfo.shape().end(),
+            trip_shape, edge_shape->begin(), edge_shape->end(),
             length, is_last_edge, is_last_edge ? end_vrt : start_vrt);
       } else {
         AddPartialShape<std::vector<PointLL>::const_reverse_iterator>(
-            trip_shape, edgeinfo.shape().rbegin(), edgeinfo.shape().rend(),
+            trip_shape, edge_shape->rbegin(), edge_shape->rend(),
             length, is_last_edge, is_last_edge ? end_vrt : start_vrt);
       }
     }    // Just get the shape in there in the right direction
     else {
       if (directededge->forward())
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().begin() + 1,
-                          edgeinfo.shape().end());
+        trip_shape.insert(trip_shape.end(), edge_shape->begin() + 1,
+                          edge_shape->end());
       else
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().rbegin() + 1,
-                          edgeinfo.shape().rend());
+        trip_shape.insert(trip_shape.end(), edge_shape->rbegin() + 1,
+                          edge_shape->rend());
     }
     // Set end shape index if requested
-    if (controller.attributes.at(kEdgeEndShapeIndex))
+    if (controller.enabled(TripPathAttribute::kEdgeEndShapeIndex))
       trip_edge->set_end_shape_index(trip_shape.size() - 1);
 
     // Add connected edges from the start node. Do this after the first trip
@@ -1010,16 +1044,18 @@ TripPath TripPathBuilder::Build(
 
   // Add the last node
   auto* node = trip_path.add_node();
-  if (controller.attributes.at(kNodeaAdminIndex)) {
+  if (controller.enabled(TripPathAttribute::kNodeaAdminIndex)) {
     node->set_admin_index(GetAdminIndex(
-        last_tile->admininfo(last_tile->node(startnode)->admin_index()),
-        admin_info_map, admin_info_list));
+        admin_records.Get(last_tile, last_tile->node(startnode)->admin_index()),
+        admin_index_map, admin_list));
   }
-  if (controller.attributes.at(kNodeElapsedTime))
+  if (controller.enabled(TripPathAttribute::kNodeElapsedTime))
     node->set_elapsed_time(elapsedtime);
 
   // Assign the admins
-  AssignAdmins(controller, trip_path, admin_info_list);
+  AssignAdmins(controller, trip_path, admin_list);
+  if (admins != nullptr)
+    *admins = admin_list;
 
   // Set the bounding box of the shape
   AABB2<PointLL> bbox(trip_shape);
@@ -1033,14 +1069,11 @@ TripPath TripPathBuilder::Build(
   max_ll->set_lng(bbox.maxx());
 
   // Set shape if requested
-  if (controller.attributes.at(kShape))
+  if (controller.enabled(TripPathAttribute::kShape))
     trip_path.set_shape(encode<std::vector<PointLL> >(trip_shape));
 
-  if (osmchangeset != 0 && controller.attributes.at(kOsmChangeset))
+  if (osmchangeset != 0 && controller.enabled(TripPathAttribute::kOsmChangeset))
     trip_path.set_osm_changeset(osmchangeset);
-
-  //hand it back
-  return trip_path;
 }
 
 // Add a trip edge to the trip node and set its attributes
@@ -1053,6 +1086,7 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
                                             const DirectedEdge* directededge,
                                             TripPath_Node* trip_node,
                                             const GraphTile* graphtile,
+                                            const std::vector<PointLL>& shape,
                                             const float length_percentage) {
 
   // Index of the directed edge within the tile
@@ -1064,7 +1098,7 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
   auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
 
   // Add names to edge if requested
-  if (controller.attributes.at(kEdgeNames)) {
+  if (controller.enabled(TripPathAttribute::kEdgeNames)) {
     std::vector<std::string> names = edgeinfo.GetNames();
     for (const auto& name : names) {
       trip_edge->add_name(name);
@@ -1083,22 +1117,22 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
       for (const auto& sign : signs) {
         switch (sign.type()) {
           case Sign::Type::kExitNumber: {
-            if (controller.attributes.at(kEdgeSignExitNumber))
+            if (controller.enabled(TripPathAttribute::kEdgeSignExitNumber))
               trip_exit->add_exit_number(sign.text());
             break;
           }
           case Sign::Type::kExitBranch: {
-            if (controller.attributes.at(kEdgeSignExitBranch))
+            if (controller.enabled(TripPathAttribute::kEdgeSignExitBranch))
               trip_exit->add_exit_branch(sign.text());
             break;
           }
           case Sign::Type::kExitToward: {
-            if (controller.attributes.at(kEdgeSignExitToward))
+            if (controller.enabled(TripPathAttribute::kEdgeSignExitToward))
               trip_exit->add_exit_toward(sign.text());
             break;
           }
           case Sign::Type::kExitName: {
-            if (controller.attributes.at(kEdgeSignExitName))
+            if (controller.enabled(TripPathAttribute::kEdgeSignExitName))
               trip_exit->add_exit_name(sign.text());
             break;
           }
@@ -1108,17 +1142,17 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
   }
 
   // Set road class if requested
-  if (controller.attributes.at(kEdgeRoadClass)) {
+  if (controller.enabled(TripPathAttribute::kEdgeRoadClass)) {
     trip_edge->set_road_class(
         GetTripPathRoadClass(directededge->classification()));
   }
 
   // Set length if requested
-  if (controller.attributes.at(kEdgeLength))
+  if (controller.enabled(TripPathAttribute::kEdgeLength))
     trip_edge->set_length(directededge->length() * 0.001f * length_percentage);  // Convert to km
 
   // Set speed if requested
-  if (controller.attributes.at(kEdgeSpeed))
+  if (controller.enabled(TripPathAttribute::kEdgeSpeed))
     trip_edge->set_speed(directededge->speed());
 
   uint8_t kAccess = 0;
@@ -1132,7 +1166,7 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
   // Test whether edge is traversed forward or reverse
   if (directededge->forward()) {
     // Set traversability for forward directededge if requested
-    if (controller.attributes.at(kEdgeTraversability)) {
+    if (controller.enabled(TripPathAttribute::kEdgeTraversability)) {
       if ((directededge->forwardaccess() & kAccess)
           && (directededge->reverseaccess() & kAccess))
         trip_edge->set_traversability(
@@ -1151,27 +1185,27 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
     }
 
     // Set begin heading if requested
-    if (controller.attributes.at(kEdgeBeginHeading)) {
+    if (controller.enabled(TripPathAttribute::kEdgeBeginHeading)) {
       trip_edge->set_begin_heading(
           std::round(
               PointLL::HeadingAlongPolyline(
-                  edgeinfo.shape(),
+                  shape,
                   GetOffsetForHeading(directededge->classification(),
                                       directededge->use()))));
     }
 
     // Set end heading if requested
-    if (controller.attributes.at(kEdgeEndHeading)) {
+    if (controller.enabled(TripPathAttribute::kEdgeEndHeading)) {
       trip_edge->set_end_heading(
           std::round(
               PointLL::HeadingAtEndOfPolyline(
-                  edgeinfo.shape(),
+                  shape,
                   GetOffsetForHeading(directededge->classification(),
                                       directededge->use()))));
     }
   } else {
     // Set traversability for reverse directededge if requested
-    if (controller.attributes.at(kEdgeTraversability)) {
+    if (controller.enabled(TripPathAttribute::kEdgeTraversability)) {
       if ((directededge->forwardaccess() & kAccess)
           && (directededge->reverseaccess() & kAccess))
         trip_edge->set_traversability(
@@ -1190,24 +1224,24 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
     }
 
     // Set begin heading if requested
-    if (controller.attributes.at(kEdgeBeginHeading)) {
+    if (controller.enabled(TripPathAttribute::kEdgeBeginHeading)) {
       trip_edge->set_begin_heading(
           std::round(
               fmod(
                   (PointLL::HeadingAtEndOfPolyline(
-                      edgeinfo.shape(),
+                      shape,
                       GetOffsetForHeading(directededge->classification(),
                                           directededge->use())) + 180.0f),
                   360)));
     }
 
     // Set end heading if requested
-    if (controller.attributes.at(kEdgeEndHeading)) {
+    if (controller.enabled(TripPathAttribute::kEdgeEndHeading)) {
       trip_edge->set_end_heading(
           std::round(
               fmod(
                   (PointLL::HeadingAlongPolyline(
-                      edgeinfo.shape(),
+                      shape,
                       GetOffsetForHeading(directededge->classification(),
                                           directededge->use())) + 180.0f),
                   360)));
@@ -1215,92 +1249,92 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
   }
 
   // Set the trip path use based on directed edge use if requested
-  if (controller.attributes.at(kEdgeUse))
+  if (controller.enabled(TripPathAttribute::kEdgeUse))
     trip_edge->set_use(GetTripPathUse(directededge->use()));
 
   // Set toll flag if requested
-  if (directededge->toll() && controller.attributes.at(kEdgeToll))
+  if (directededge->toll() && controller.enabled(TripPathAttribute::kEdgeToll))
     trip_edge->set_toll(true);
 
   // Set unpaved flag if requested
-  if (directededge->unpaved() && controller.attributes.at(kEdgeUnpaved))
+  if (directededge->unpaved() && controller.enabled(TripPathAttribute::kEdgeUnpaved))
     trip_edge->set_unpaved(true);
 
   // Set tunnel flag if requested
-  if (directededge->tunnel() && controller.attributes.at(kEdgeTunnel))
+  if (directededge->tunnel() && controller.enabled(TripPathAttribute::kEdgeTunnel))
     trip_edge->set_tunnel(true);
 
   // Set bridge flag if requested
-  if (directededge->bridge() && controller.attributes.at(kEdgeBridge))
+  if (directededge->bridge() && controller.enabled(TripPathAttribute::kEdgeBridge))
     trip_edge->set_bridge(true);
 
   // Set roundabout flag if requested
-  if (directededge->roundabout() && controller.attributes.at(kEdgeRoundabout))
+  if (directededge->roundabout() && controller.enabled(TripPathAttribute::kEdgeRoundabout))
     trip_edge->set_roundabout(true);
 
   // Set internal intersection flag if requested
-  if (directededge->internal() && controller.attributes.at(kEdgeInternalIntersection))
+  if (directededge->internal() && controller.enabled(TripPathAttribute::kEdgeInternalIntersection))
     trip_edge->set_internal_intersection(true);
 
   // Set drive_on_right if requested
-  if (controller.attributes.at(kEdgeDriveOnRight))
+  if (controller.enabled(TripPathAttribute::kEdgeDriveOnRight))
     trip_edge->set_drive_on_right(directededge->drive_on_right());
 
   // Set surface if requested
-  if (controller.attributes.at(kEdgeSurface))
+  if (controller.enabled(TripPathAttribute::kEdgeSurface))
     trip_edge->set_surface(GetTripPathSurface(directededge->surface()));
 
   // Set the mode and travel type
   if (mode == sif::TravelMode::kBicycle) {
-    if (controller.attributes.at(kEdgeTravelMode))
+    if (controller.enabled(TripPathAttribute::kEdgeTravelMode))
       trip_edge->set_travel_mode(TripPath_TravelMode::TripPath_TravelMode_kBicycle);
-    if (controller.attributes.at(kEdgeBicycleType))
+    if (controller.enabled(TripPathAttribute::kEdgeBicycleType))
       trip_edge->set_bicycle_type(GetTripPathBicycleType(travel_type));
   } else if (mode == sif::TravelMode::kDrive) {
-    if (controller.attributes.at(kEdgeTravelMode))
+    if (controller.enabled(TripPathAttribute::kEdgeTravelMode))
       trip_edge->set_travel_mode(TripPath_TravelMode::TripPath_TravelMode_kDrive);
-    if (controller.attributes.at(kEdgeVehicleType))
+    if (controller.enabled(TripPathAttribute::kEdgeVehicleType))
       trip_edge->set_vehicle_type(GetTripPathVehicleType(travel_type));
   } else if (mode == sif::TravelMode::kPedestrian) {
-    if (controller.attributes.at(kEdgeTravelMode))
+    if (controller.enabled(TripPathAttribute::kEdgeTravelMode))
       trip_edge->set_travel_mode(TripPath_TravelMode::TripPath_TravelMode_kPedestrian);
-    if (controller.attributes.at(kEdgePedestrianType))
+    if (controller.enabled(TripPathAttribute::kEdgePedestrianType))
       trip_edge->set_pedestrian_type(GetTripPathPedestrianType(travel_type));
   } else if (mode == sif::TravelMode::kPublicTransit) {
-    if (controller.attributes.at(kEdgeTravelMode))
+    if (controller.enabled(TripPathAttribute::kEdgeTravelMode))
       trip_edge->set_travel_mode(TripPath_TravelMode::TripPath_TravelMode_kTransit);
   }
 
   // Set edge id (graphid value) if requested
-  if (controller.attributes.at(kEdgeId))
+  if (controller.enabled(TripPathAttribute::kEdgeId))
     trip_edge->set_id(edge.value);
 
   // Set way id (base data id) if requested
-  if (controller.attributes.at(kEdgeWayId))
+  if (controller.enabled(TripPathAttribute::kEdgeWayId))
     trip_edge->set_way_id(edgeinfo.wayid());
 
   // Set weighted grade if requested
-  if (controller.attributes.at(kEdgeWeightedGrade))
+  if (controller.enabled(TripPathAttribute::kEdgeWeightedGrade))
     trip_edge->set_weighted_grade((directededge->weighted_grade() - 6.f) / 0.6f);
 
   // Set maximum upward grade if requested
-  if (controller.attributes.at(kEdgeMaxUpwardGrade))
+  if (controller.enabled(TripPathAttribute::kEdgeMaxUpwardGrade))
     trip_edge->set_max_upward_grade(directededge->max_up_slope());
 
   // Set maximum downward grade if requested
-  if (controller.attributes.at(kEdgeMaxDownwardGrade))
+  if (controller.enabled(TripPathAttribute::kEdgeMaxDownwardGrade))
     trip_edge->set_max_downward_grade(directededge->max_down_slope());
 
-  if (controller.attributes.at(kEdgeLaneCount))
+  if (controller.enabled(TripPathAttribute::kEdgeLaneCount))
     trip_edge->set_lane_count(directededge->lanecount());
 
-  if (directededge->cyclelane() != CycleLane::kNone && controller.attributes.at(kEdgeCycleLane))
+  if (directededge->cyclelane() != CycleLane::kNone && controller.enabled(TripPathAttribute::kEdgeCycleLane))
     trip_edge->set_cycle_lane(GetTripPathCycleLane(directededge->cyclelane()));
 
-  if (controller.attributes.at(kEdgeBicycleNetwork))
+  if (controller.enabled(TripPathAttribute::kEdgeBicycleNetwork))
     trip_edge->set_bicycle_network(directededge->bike_network());
 
-  if (controller.attributes.at(kEdgeSidewalk)) {
+  if (controller.enabled(TripPathAttribute::kEdgeSidewalk)) {
     if (directededge->sidewalk_left() && directededge->sidewalk_right())
       trip_edge->set_sidewalk(TripPath_Sidewalk::TripPath_Sidewalk_kBothSides);
     else if (directededge->sidewalk_left())
@@ -1309,16 +1343,16 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
       trip_edge->set_sidewalk(TripPath_Sidewalk::TripPath_Sidewalk_kRight);
   }
 
-  if (controller.attributes.at(kEdgeDensity))
+  if (controller.enabled(TripPathAttribute::kEdgeDensity))
     trip_edge->set_density(directededge->density());
 
-  if (controller.attributes.at(kEdgeSpeedLimit))
+  if (controller.enabled(TripPathAttribute::kEdgeSpeedLimit))
     trip_edge->set_speed_limit(directededge->speed_limit());
 
-  if (controller.attributes.at(kEdgeTruckSpeed))
+  if (controller.enabled(TripPathAttribute::kEdgeTruckSpeed))
     trip_edge->set_truck_speed(directededge->truck_speed());
 
-  if (directededge->truck_route() && controller.attributes.at(kEdgeTruckRoute))
+  if (directededge->truck_route() && controller.enabled(TripPathAttribute::kEdgeTruckRoute))
     trip_edge->set_truck_route(true);
 
   /////////////////////////////////////////////////////////////////////////////
@@ -1330,11 +1364,11 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
         ->mutable_transit_route_info();
 
     // Set block_id if requested
-    if (controller.attributes.at(kEdgeTransitRouteInfoBlockId))
+    if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoBlockId))
       transit_route_info->set_block_id(block_id);
 
     // Set trip_id if requested
-    if (controller.attributes.at(kEdgeTransitRouteInfoTripId))
+    if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoTripId))
       transit_route_info->set_trip_id(trip_id);
 
     const TransitDeparture* transit_departure = graphtile->GetTransitDeparture(
@@ -1343,7 +1377,7 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
     if (transit_departure) {
 
       // Set headsign if requested
-      if (controller.attributes.at(kEdgeTransitRouteInfoHeadsign)
+      if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoHeadsign)
           && transit_departure->headsign_offset()) {
         transit_route_info->set_headsign(
             graphtile->GetName(transit_departure->headsign_offset()));
@@ -1354,63 +1388,63 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const TripPathController& controller
 
       if (transit_route) {
         // Set transit type if requested
-        if (controller.attributes.at(kEdgeTransitType)) {
+        if (controller.enabled(TripPathAttribute::kEdgeTransitType)) {
           trip_edge->set_transit_type(
               GetTripPathTransitType(transit_route->route_type()));
         }
 
         // Set onestop_id if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoOnestopId)
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoOnestopId)
             && transit_route->one_stop_offset()) {
           transit_route_info->set_onestop_id(
               graphtile->GetName(transit_route->one_stop_offset()));
         }
 
         // Set short_name if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoShortName)
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoShortName)
             && transit_route->short_name_offset()) {
           transit_route_info->set_short_name(
               graphtile->GetName(transit_route->short_name_offset()));
         }
 
         // Set long_name if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoLongName)
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoLongName)
             && transit_route->long_name_offset()) {
           transit_route_info->set_long_name(
               graphtile->GetName(transit_route->long_name_offset()));
         }
 
         // Set color if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoColor))
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoColor))
           transit_route_info->set_color(transit_route->route_color());
 
         // Set text_color if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoTextColor))
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoTextColor))
           transit_route_info->set_text_color(transit_route->route_text_color());
 
         // Set description if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoDescription)
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoDescription)
             && transit_route->desc_offset()) {
           transit_route_info->set_description(
               graphtile->GetName(transit_route->desc_offset()));
         }
 
         // Set operator_onestop_id if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoOperatorOnestopId)
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoOperatorOnestopId)
             && transit_route->op_by_onestop_id_offset()) {
           transit_route_info->set_operator_onestop_id(
               graphtile->GetName(transit_route->op_by_onestop_id_offset()));
         }
 
         // Set operator_name if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoOperatorName)
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoOperatorName)
             && transit_route->op_by_name_offset()) {
           transit_route_info->set_operator_name(
               graphtile->GetName(transit_route->op_by_name_offset()));
         }
 
         // Set operator_url if requested
-        if (controller.attributes.at(kEdgeTransitRouteInfoOperatorUrl)
+        if (controller.enabled(TripPathAttribute::kEdgeTransitRouteInfoOperatorUrl)
             && transit_route->op_by_website_offset()) {
           transit_route_info->set_operator_url(
               graphtile->GetName(transit_route->op_by_website_offset()));
@@ -1433,7 +1467,7 @@ void TripPathBuilder::AddTripIntersectingEdge(const TripPathController& controll
       trip_node->add_intersecting_edge();
 
   // Set the heading for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeBeginHeading))
+  if (controller.enabled(TripPathAttribute::kNodeIntersectingEdgeBeginHeading))
     itersecting_edge->set_begin_heading(nodeinfo->heading(local_edge_index));
 
   Traversability traversability = Traversability::kNone;
@@ -1447,7 +1481,7 @@ void TripPathBuilder::AddTripIntersectingEdge(const TripPathController& controll
     }
   }
   // Set the walkability flag for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeWalkability))
+  if (controller.enabled(TripPathAttribute::kNodeIntersectingEdgeWalkability))
     itersecting_edge->set_walkability(GetTripPathTraversability(traversability));
 
   traversability = Traversability::kNone;
@@ -1461,23 +1495,23 @@ void TripPathBuilder::AddTripIntersectingEdge(const TripPathController& controll
     }
   }
   // Set the cyclability flag for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeCyclability))
+  if (controller.enabled(TripPathAttribute::kNodeIntersectingEdgeCyclability))
     itersecting_edge->set_cyclability(GetTripPathTraversability(traversability));
 
   // Set the driveability flag for the intersecting edge if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeDriveability)) {
+  if (controller.enabled(TripPathAttribute::kNodeIntersectingEdgeDriveability)) {
     itersecting_edge->set_driveability(
         GetTripPathTraversability(nodeinfo->local_driveability(local_edge_index)));
   }
 
   // Set the previous/intersecting edge name consistency if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeFromEdgeNameConsistency)) {
+  if (controller.enabled(TripPathAttribute::kNodeIntersectingEdgeFromEdgeNameConsistency)) {
     itersecting_edge->set_prev_name_consistency(
         nodeinfo->name_consistency(prev_edge_index, local_edge_index));
   }
 
   // Set the current/intersecting edge name consistency if requested
-  if (controller.attributes.at(kNodeIntersectingEdgeToEdgeNameConsistency)) {
+  if (controller.enabled(TripPathAttribute::kNodeIntersectingEdgeToEdgeNameConsistency)) {
     itersecting_edge->set_curr_name_consistency(
         nodeinfo->name_consistency(curr_edge_index, local_edge_index));
   }
@@ -0,0 +1,88 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/admin_cache.h"
+
+#include <stdexcept>
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace {
+
+void TestGet() {
+  AdminCache cache;
+  uint32_t resolved = 0;
+  auto pennsylvania = [&resolved]() {
+    resolved++;
+    return AdminInfo("United States", "Pennsylvania", "US", "PA");
+  };
+
+  auto record = cache.Get(AdminCache::Key(1, 2), pennsylvania);
+  if (record->country_text != "United States" ||
+      record->state_text != "Pennsylvania" ||
+      record->country_iso != "US" || record->state_iso != "PA")
+    throw runtime_error("Incorrect admin record strings");
+  if (cache.Get(AdminCache::Key(1, 2), pennsylvania) != record || resolved != 1)
+    throw runtime_error("Admin record should be found in the cache");
+
+  // The same admin in another tile shares the record
+  if (cache.Get(AdminCache::Key(2, 5), pennsylvania) != record || resolved != 2)
+    throw runtime_error("Tile admins with the same strings should share a record");
+  if (cache.size() != 2 || cache.admin_count() != 1)
+    throw runtime_error("Incorrect cache counts");
+}
+
+void TestCodes() {
+  AdminCache cache;
+  auto pa = cache.Get(AdminCache::Key(1, 0), []() {
+    return AdminInfo("United States", "Pennsylvania", "US", "PA");
+  });
+  auto nj = cache.Get(AdminCache::Key(1, 1), []() {
+    return AdminInfo("United States", "New Jersey", "US", "NJ");
+  });
+  auto on = cache.Get(AdminCache::Key(2, 0), []() {
+    return AdminInfo("Canada", "Ontario", "CA", "ON");
+  });
+
+  // Distinct admins have distinct Ids and equal codes have equal Ids
+  if (pa->id == nj->id || pa->id == on->id || nj->id == on->id)
+    throw runtime_error("Distinct admins should have distinct Ids");
+  if (pa->country_code != nj->country_code || pa->country_code == on->country_code)
+    throw runtime_error("Incorrect interned country codes");
+  if (pa->state_code == nj->state_code || pa->state_code == on->state_code)
+    throw runtime_error("Incorrect interned state codes");
+}
+
+void TestOverCommitted() {
+  AdminCache cache(2);
+  auto resolve = []() { return AdminInfo("Canada", "Ontario", "CA", "ON"); };
+  cache.Get(AdminCache::Key(1, 0), resolve);
+  cache.Get(AdminCache::Key(2, 0), resolve);
+  if (cache.OverCommitted())
+    throw runtime_error("Cache should not be over committed");
+  cache.Get(AdminCache::Key(3, 0), resolve);
+  if (!cache.OverCommitted())
+    throw runtime_error("Cache should be over committed");
+  cache.Clear();
+  if (cache.OverCommitted() || cache.size() != 0 || cache.admin_count() != 0)
+    throw runtime_error("Cache should be cleared");
+}
+
+}
+
+int main() {
+  test::suite suite("admin_cache");
+
+  // Test getting admin records
+  suite.test(TEST_CASE(TestGet));
+
+  // Test interned Ids
+  suite.test(TEST_CASE(TestCodes));
+
+  // Test the maximum size
+  suite.test(TEST_CASE(TestOverCommitted));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,152 @@
+#include "test.h"
+
+#include <cmath>
+
+#include "config.h"
+#include "thor/isochrone.h"
+
+using namespace std;
+using namespace valhalla::midgard;
+using namespace valhalla::thor;
+
+namespace {
+
+// Grid with 1 degree cells from 0,0 to 10,10 (times in minutes)
+GriddedData<PointLL> Grid() {
+  return GriddedData<PointLL>(AABB2<PointLL>(PointLL(0.0f, 0.0f),
+                              PointLL(10.0f, 10.0f)), 1.0f, 60.0f);
+}
+
+void TryTime(const GriddedData<PointLL>& grid, const int32_t col,
+             const int32_t row, const float minutes) {
+  float t = grid.data()[grid.TileId(col, row)];
+  if (std::abs(t - minutes) > 0.01f)
+    throw runtime_error("Cell " + std::to_string(col) + "," + std::to_string(row) +
+        " time " + std::to_string(t) + " expected " + std::to_string(minutes));
+}
+
+size_t MarkedCount(const GriddedData<PointLL>& grid) {
+  size_t count = 0;
+  for (auto t : grid.data()) {
+    if (t < 60.0f) count++;
+  }
+  return count;
+}
+
+void TestRasterize() {
+  // Shape 5 units long near the equator, 5 minutes along the edge. Each
+  // cell is marked with the time the shape enters it.
+  std::vector<PointLL> shape{ { 0.5f, 0.5f }, { 3.5f, 0.5f }, { 3.5f, 2.5f } };
+  auto grid = Grid();
+  RasterizeEdgeShape(grid, shape, true, 0.0f, 300.0f);
+  if (MarkedCount(grid) != 6)
+    throw runtime_error("Expected 6 cells along the shape");
+  TryTime(grid, 0, 0, 0.0f);
+  TryTime(grid, 1, 0, 0.5f);
+  TryTime(grid, 2, 0, 1.5f);
+  TryTime(grid, 3, 0, 2.5f);
+  TryTime(grid, 3, 1, 3.5f);
+  TryTime(grid, 3, 2, 4.5f);
+
+  // Reverse direction walks the shape from its end
+  auto reverse = Grid();
+  RasterizeEdgeShape(reverse, shape, false, 0.0f, 300.0f);
+  TryTime(reverse, 3, 2, 0.0f);
+  TryTime(reverse, 3, 1, 0.5f);
+  TryTime(reverse, 0, 0, 4.5f);
+
+  // Lower times already in the grid are kept
+  RasterizeEdgeShape(grid, shape, false, 0.0f, 300.0f);
+  TryTime(grid, 0, 0, 0.0f);
+  TryTime(grid, 3, 2, 0.0f);
+  TryTime(grid, 2, 0, 1.5f);
+}
+
+void TestRasterizeCorners() {
+  // A diagonal through cell corners marks both cells adjacent to each corner
+  std::vector<PointLL> shape{ { 4.5f, 4.5f }, { 6.5f, 6.5f } };
+  auto grid = Grid();
+  RasterizeEdgeShape(grid, shape, true, 60.0f, 120.0f);
+  if (MarkedCount(grid) != 7)
+    throw runtime_error("Expected 7 cells along the diagonal");
+  for (const auto& cell : std::vector<std::pair<int32_t, int32_t>>{
+         { 4, 4 }, { 5, 4 }, { 4, 5 }, { 5, 5 }, { 6, 5 }, { 5, 6 }, { 6, 6 } }) {
+    float t = grid.data()[grid.TileId(cell.first, cell.second)];
+    if (t < 1.0f || t > 2.0f)
+      throw runtime_error("Diagonal cell time out of range");
+  }
+
+  // Shape outside the grid is ignored
+  std::vector<PointLL> outside{ { -2.5f, 5.5f }, { 0.5f, 5.5f } };
+  auto clipped = Grid();
+  RasterizeEdgeShape(clipped, outside, true, 0.0f, 180.0f);
+  if (MarkedCount(clipped) != 1)
+    throw runtime_error("Only the cell inside the grid should be marked");
+  TryTime(clipped, 0, 5, 2.5f);
+}
+
+void TestCopyReachedCells() {
+  // Prior grid from 2,3 to 6,6. Cells at its unreached time (60) or beyond
+  // are not copied and cells keep the lower time.
+  GriddedData<PointLL> prior(AABB2<PointLL>(PointLL(2.0f, 3.0f),
+                             PointLL(6.0f, 6.0f)), 1.0f, 60.0f);
+  std::vector<PointLL> shape{ { 2.5f, 3.5f }, { 5.5f, 3.5f } };
+  RasterizeEdgeShape(prior, shape, true, 0.0f, 180.0f);
+  auto grid = Grid();
+  grid.Set(PointLL(4.5f, 3.5f), 0.5f);
+  CopyReachedCells(prior, 60.0f, grid);
+  TryTime(grid, 2, 3, 0.0f);
+  TryTime(grid, 3, 3, 0.5f);
+  TryTime(grid, 4, 3, 0.5f);
+  TryTime(grid, 5, 3, 2.5f);
+  if (MarkedCount(grid) != 4)
+    throw runtime_error("Only the reached cells should be copied");
+
+  // Cells at the unreached time are not copied even into a grid with a
+  // later unreached time
+  GriddedData<PointLL> later(AABB2<PointLL>(PointLL(0.0f, 0.0f),
+                             PointLL(10.0f, 10.0f)), 1.0f, 90.0f);
+  CopyReachedCells(prior, 60.0f, later);
+  TryTime(later, 2, 4, 90.0f);
+  TryTime(later, 3, 3, 0.5f);
+}
+
+void TestGroupOrigins() {
+  // Two origins about 1km apart, one about 55km away and one about 1km
+  // from the far origin
+  std::vector<valhalla::baldr::PathLocation> origins;
+  for (const auto& ll : std::vector<PointLL>{ { -76.30f, 40.00f }, { -76.30f, 40.50f },
+                                              { -76.30f, 40.01f }, { -76.31f, 40.50f } }) {
+    origins.emplace_back(ll);
+  }
+  auto groups = GroupOrigins(origins, 5000.0f);
+  if (groups.size() != 2 || groups[0].size() != 2 || groups[1].size() != 2)
+    throw runtime_error("Expected 2 groups of 2 origins");
+  if (!(groups[0][1].latlng_ == origins[2].latlng_) ||
+      !(groups[1][0].latlng_ == origins[1].latlng_))
+    throw runtime_error("Groups should be in the order of their first origin");
+
+  // Origins chained within the distance are all in one group
+  if (GroupOrigins(origins, 60000.0f).size() != 1)
+    throw runtime_error("Expected all origins in one group");
+  if (GroupOrigins(origins, 10.0f).size() != 4)
+    throw runtime_error("Expected each origin in its own group");
+}
+
+}
+
+int main() {
+  test::suite suite("isochrone");
+
+  // Test marking grid cells along edge shape
+  suite.test(TEST_CASE(TestRasterize));
+  suite.test(TEST_CASE(TestRasterizeCorners));
+
+  // Test copying the reached cells of a prior grid to grow it
+  suite.test(TEST_CASE(TestCopyReachedCells));
+
+  // Test grouping origins to search in parallel
+  suite.test(TEST_CASE(TestGroupOrigins));
+
+  return suite.tear_down();
+}
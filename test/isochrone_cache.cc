@@ -0,0 +1,68 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/isochrone_cache.h"
+
+using namespace std;
+using namespace valhalla::midgard;
+using namespace valhalla::thor;
+
+namespace {
+
+std::shared_ptr<const GriddedData<PointLL> > Isotile() {
+  AABB2<PointLL> bounds(PointLL(-76.5f, 40.0f), PointLL(-76.0f, 40.5f));
+  return std::make_shared<GriddedData<PointLL> >(bounds, 0.01f, 65.0f);
+}
+
+void TestFind() {
+  IsochroneCache cache(2);
+  auto isotile = Isotile();
+  cache.Insert("a", 60, isotile);
+
+  // Any time up to the cached time can use the isotile
+  if (cache.Find("a", 60) != isotile || cache.Find("a", 15) != isotile)
+    throw runtime_error("Cached isotile should be found for lesser times");
+  if (cache.Find("a", 61) != nullptr)
+    throw runtime_error("Cached isotile should not be found for greater times");
+  if (cache.Find("b", 15) != nullptr)
+    throw runtime_error("Isotile should not be found for another key");
+
+  // Inserting the same key replaces the entry
+  auto larger = Isotile();
+  cache.Insert("a", 90, larger);
+  if (cache.size() != 1 || cache.Find("a", 75) != larger)
+    throw runtime_error("Cached isotile should be replaced");
+}
+
+void TestEviction() {
+  IsochroneCache cache(2);
+  cache.Insert("a", 30, Isotile());
+  cache.Insert("b", 30, Isotile());
+
+  // Use "a" so "b" is the least recently used and is evicted
+  cache.Find("a", 30);
+  cache.Insert("c", 30, Isotile());
+  if (cache.size() != 2 || !cache.Find("a", 30) || cache.Find("b", 30) ||
+      !cache.Find("c", 30))
+    throw runtime_error("Least recently used isotile should be evicted");
+
+  cache.Clear();
+  if (cache.size() != 0)
+    throw runtime_error("Cache should be empty after Clear");
+
+  IsochroneCache disabled(0);
+  disabled.Insert("a", 30, Isotile());
+  if (disabled.size() != 0)
+    throw runtime_error("Cache of size 0 should not keep isotiles");
+}
+
+}
+
+int main() {
+  test::suite suite("isochrone_cache");
+
+  suite.test(TEST_CASE(TestFind));
+  suite.test(TEST_CASE(TestEviction));
+
+  return suite.tear_down();
+}
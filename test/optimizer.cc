@@ -2,8 +2,11 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <random>
+#include <cmath>
 #include "config.h"
 #include "thor/optimizer.h"
+#include "thor/local_search_optimizer.h"
 
 using namespace std;
 using namespace valhalla::thor;
@@ -11,9 +14,11 @@ using namespace valhalla::thor;
 namespace {
 
 void TryOptimizer(const uint32_t nlocs, const std::vector<float>& costs,
-                  const std::vector<uint32_t>& expected_order) {
+                  const std::vector<uint32_t>& expected_order,
+                  const uint32_t exact_max_count = kDefaultExactMaxCount) {
   Optimizer optimizer;
   optimizer.Seed(111111);
+  optimizer.set_exact_max_count(exact_max_count);
   auto order = optimizer.Solve(nlocs, costs);
   for (uint32_t n = 0; n < nlocs; n++) {
     if (order[n] != expected_order[n]) {
@@ -22,8 +27,9 @@ void TryOptimizer(const uint32_t nlocs, const std::vector<float>& costs,
   }
 }
 
-void TestOptimizer() {
-  std::vector<float> costs = {
+// Asymmetric costs among 11 locations
+std::vector<float> TestCosts() {
+  return {
       0, 3036, 707, 956, 318, 1934, 355, 1170, 1286, 3171, 2133,
       2978, 0, 2664, 3613, 3102, 2011, 3139, 3846, 1764, 2050, 1143,
       638, 2638, 0, 1295, 763, 1536, 800, 1528, 888, 2773, 1735,
@@ -35,8 +41,191 @@ void TestOptimizer() {
       1214, 1750, 900, 1849, 1338, 634, 1375, 2082, 0, 1907, 846,
       3128, 2036, 2814, 3763, 3252, 2549, 3290, 3228, 1914, 0, 2010,
       2068, 1133, 1754, 2704, 2193, 1102, 2230, 2937, 854, 2000, 0 };
+}
+
+float TourCost(const uint32_t nlocs, const std::vector<float>& costs,
+               const std::vector<uint32_t>& order) {
+  float c = 0.0f;
+  for (uint32_t n = 0; n < nlocs - 1; n++) {
+    c += costs[order[n] * nlocs + order[n+1]];
+  }
+  return c;
+}
+
+void TestOptimizer() {
+  std::vector<float> costs = TestCosts();
   std::vector<uint32_t> expected_order = { 0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10 };
   TryOptimizer(11, costs, expected_order);
+
+  // Simulated annealing finds the same order
+  TryOptimizer(11, costs, expected_order, 0);
+}
+
+// Random asymmetric costs among the specified number of locations
+std::vector<float> RandomCosts(const uint32_t nlocs, const uint32_t seed) {
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<uint32_t> distribution(1, 3600);
+  std::vector<float> costs(nlocs * nlocs, 0.0f);
+  for (uint32_t i = 0; i < nlocs; i++) {
+    for (uint32_t j = 0; j < nlocs; j++) {
+      if (i != j) {
+        costs[i * nlocs + j] = distribution(generator);
+      }
+    }
+  }
+  return costs;
+}
+
+void TestExactTour() {
+  // Compare the exact tour cost with the least cost of all orders of the
+  // locations between the fixed first and last locations.
+  for (uint32_t nlocs = 2; nlocs <= 10; nlocs++) {
+    for (uint32_t seed = 1; seed <= 3; seed++) {
+      auto costs = RandomCosts(nlocs, nlocs * 100 + seed);
+      std::vector<uint32_t> order(nlocs);
+      for (uint32_t n = 0; n < nlocs; n++) {
+        order[n] = n;
+      }
+      float best = TourCost(nlocs, costs, order);
+      while (nlocs > 3 && std::next_permutation(order.begin() + 1, order.end() - 1)) {
+        best = std::min(best, TourCost(nlocs, costs, order));
+      }
+
+      auto tour = ExactTour(nlocs, costs);
+      if (tour.size() != nlocs || tour.front() != 0 || tour.back() != nlocs - 1) {
+        throw runtime_error("TestExactTour: invalid tour");
+      }
+      auto sorted = tour;
+      std::sort(sorted.begin(), sorted.end());
+      for (uint32_t n = 0; n < nlocs; n++) {
+        if (sorted[n] != n) {
+          throw runtime_error("TestExactTour: tour is not a permutation");
+        }
+      }
+      if (TourCost(nlocs, costs, tour) != best) {
+        throw runtime_error("TestExactTour: cost " +
+            std::to_string(TourCost(nlocs, costs, tour)) + " expected " +
+            std::to_string(best) + " for " + std::to_string(nlocs) + " locations");
+      }
+    }
+  }
+}
+
+// Exposes the tour alteration methods so the incremental cost difference
+// can be checked against the full tour cost.
+class TestAlterations : public Optimizer {
+ public:
+  void Test(const uint32_t nlocs, const std::vector<float>& costs) {
+    count_ = nlocs;
+    CreateRandomTour();
+    forward_costs_.assign(count_, 0.0);
+    reverse_costs_.assign(count_, 0.0);
+    UpdatePrefixCosts(costs, 0);
+    for (uint32_t n = 0; n < 1000; n++) {
+      TourAlteration alteration = GetTourAlteration();
+      float diff = TemperatureDifference(costs, alteration) * count_;
+      float cost = TourCost(costs, tour_);
+      if (alteration.alt == KReverse) {
+        std::reverse(tour_.begin() + alteration.start,
+                     tour_.begin() + alteration.end + 1);
+      } else {
+        std::rotate(tour_.begin() + alteration.start,
+                    tour_.begin() + alteration.mid,
+                    tour_.begin() + alteration.end);
+      }
+      UpdatePrefixCosts(costs, alteration.start - 1);
+      float new_cost = TourCost(costs, tour_);
+      if (alteration.alt == KReverse &&
+          std::abs((new_cost - cost) - diff) > 0.5f) {
+        throw runtime_error("TestReverseCost: cost difference " +
+            std::to_string(diff) + " expected " + std::to_string(new_cost - cost));
+      }
+      if (std::abs(forward_costs_.back() - new_cost) > 0.5f) {
+        throw runtime_error("TestReverseCost: prefix cost does not match tour cost");
+      }
+    }
+  }
+};
+
+void TestReverseCost() {
+  // Asymmetric costs among 60 locations
+  const uint32_t nlocs = 60;
+  auto costs = RandomCosts(nlocs, 12345);
+  TestAlterations alterations;
+  alterations.Seed(111111);
+  alterations.Test(nlocs, costs);
+}
+
+void TestLocalSearchOptimizer() {
+  // The local search should find a tour at least as good as the expected
+  // annealing result. Check that the first and last locations are fixed.
+  std::vector<float> costs = TestCosts();
+  std::vector<uint32_t> expected_order = { 0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10 };
+  LocalSearchOptimizer optimizer(2, 10000);
+  optimizer.Seed(111111);
+  optimizer.set_max_iterations(100);
+  optimizer.set_exact_max_count(0);
+  auto order = optimizer.Solve(11, costs);
+  if (order.size() != 11 || order.front() != 0 || order.back() != 10) {
+    throw runtime_error("TestLocalSearchOptimizer: invalid tour");
+  }
+  auto sorted = order;
+  std::sort(sorted.begin(), sorted.end());
+  for (uint32_t n = 0; n < 11; n++) {
+    if (sorted[n] != n) {
+      throw runtime_error("TestLocalSearchOptimizer: tour is not a permutation");
+    }
+  }
+  if (TourCost(11, costs, order) > TourCost(11, costs, expected_order)) {
+    throw runtime_error("TestLocalSearchOptimizer: tour cost is too high");
+  }
+
+  // Same seed and iteration limit gives the same tour
+  LocalSearchOptimizer optimizer2(2, 10000);
+  optimizer2.Seed(111111);
+  optimizer2.set_max_iterations(100);
+  optimizer2.set_exact_max_count(0);
+  if (optimizer2.Solve(11, costs) != order) {
+    throw runtime_error("TestLocalSearchOptimizer: tour is not repeatable");
+  }
+
+  // A seeded search runs to the iteration limit even with no time
+  LocalSearchOptimizer optimizer3(2, 0);
+  optimizer3.Seed(111111);
+  optimizer3.set_max_iterations(100);
+  optimizer3.set_exact_max_count(0);
+  if (optimizer3.Solve(11, costs) != order) {
+    throw runtime_error("TestLocalSearchOptimizer: seeded tour depends on the time limit");
+  }
+}
+
+void TestLocalSearchDefaults() {
+  // The default optimizer runs a single chain with an iteration limit, so
+  // the tour is repeatable. Chains of a multi-threaded optimizer are seeded
+  // independently, so its tour is repeatable too and no worse than the
+  // first chain's.
+  const uint32_t nlocs = 40;
+  auto costs = RandomCosts(nlocs, 54321);
+  LocalSearchOptimizer optimizer;
+  optimizer.set_exact_max_count(0);
+  auto order = optimizer.Solve(nlocs, costs);
+  LocalSearchOptimizer optimizer2;
+  optimizer2.set_exact_max_count(0);
+  if (optimizer2.Solve(nlocs, costs) != order) {
+    throw runtime_error("TestLocalSearchDefaults: tour is not repeatable");
+  }
+
+  LocalSearchOptimizer threaded(3, 60000);
+  threaded.set_exact_max_count(0);
+  auto threaded_order = threaded.Solve(nlocs, costs);
+  if (TourCost(nlocs, costs, threaded_order) > TourCost(nlocs, costs, order)) {
+    throw runtime_error("TestLocalSearchDefaults: threads give a worse tour");
+  }
+  LocalSearchOptimizer threaded2(3, 60000);
+  threaded2.set_exact_max_count(0);
+  if (threaded2.Solve(nlocs, costs) != threaded_order) {
+    throw runtime_error("TestLocalSearchDefaults: threaded tour is not repeatable");
+  }
 }
 
 }
@@ -46,5 +235,13 @@ int main() {
 
   suite.test(TEST_CASE(TestOptimizer));
 
+  suite.test(TEST_CASE(TestExactTour));
+
+  suite.test(TEST_CASE(TestReverseCost));
+
+  suite.test(TEST_CASE(TestLocalSearchOptimizer));
+
+  suite.test(TEST_CASE(TestLocalSearchDefaults));
+
   return suite.tear_down();
 }
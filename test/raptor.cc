@@ -0,0 +1,233 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/raptor.h"
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/tilehierarchy.h>
+#include <valhalla/sif/pedestriancost.h>
+#include <valhalla/sif/transitcost.h>
+
+using namespace std;
+
+namespace bpt = boost::property_tree;
+
+namespace vm = valhalla::midgard;
+namespace vb = valhalla::baldr;
+namespace vs = valhalla::sif;
+namespace vt = valhalla::thor;
+
+namespace {
+
+// Uses the roads in the astar test tile (see test/astar.cc), which has no
+// transit, so RAPTOR walks:
+//
+//       0  2
+// a----->--<-----b
+// |              |
+// v 1          3 v
+// |              |
+// ^ 4          7 ^
+// |              |
+// c----->--<-----d
+//       5  6
+//
+// and the triangle e, f, g (not connected to the square)
+vb::TileHierarchy h("test/fake_tiles_astar");
+vb::GraphId tile_id = h.GetGraphId({.125, .125}, 2);
+
+const vm::PointLL a(0.01, 0.10);
+const vm::PointLL d(0.10, 0.01);
+const vm::PointLL e(0.01, 0.14);
+
+vb::GraphReader& Reader() {
+  static std::unique_ptr<vb::GraphReader> reader;
+  if (!reader) {
+    std::stringstream json;
+    json << "{ \"tile_dir\": \"test/fake_tiles_astar\" }";
+    bpt::ptree conf;
+    bpt::json_parser::read_json(json, conf);
+    reader.reset(new vb::GraphReader(conf));
+  }
+  if (reader->GetGraphTile(tile_id) == nullptr)
+    throw runtime_error("Unable to load test tile");
+  return *reader;
+}
+
+// Location at a node with its outbound (dist 0) and inbound (dist 1) edges
+vb::PathLocation Node(const vm::PointLL& ll, const std::vector<uint64_t>& out,
+                      const std::vector<uint64_t>& in) {
+  vb::PathLocation location(ll);
+  for (auto i : out)
+    location.edges.emplace_back(tile_id + i, 0.0f, ll, 0.0f);
+  for (auto i : in)
+    location.edges.emplace_back(tile_id + i, 1.0f, ll, 0.0f);
+  location.date_time_ = "2016-07-04T08:00";
+  return location;
+}
+
+// Sets up the state of a journey directly (the test tile has no transit)
+class TestRaptor : public vt::RaptorPathAlgorithm {
+ public:
+  using Journey = vt::RaptorPathAlgorithm::Journey;
+  using StopLabel = vt::RaptorPathAlgorithm::StopLabel;
+  using vt::RaptorPathAlgorithm::BoardingPenalty;
+  using vt::RaptorPathAlgorithm::FormPath;
+
+  // Label walking along an edge, ending at the time (seconds)
+  static vs::EdgeLabel Label(const uint64_t edge, const float secs) {
+    const auto* tile = Reader().GetGraphTile(tile_id);
+    const auto* directededge = tile->directededge(tile_id + edge);
+    vs::Cost cost(secs, secs);
+    return vs::EdgeLabel(vb::kInvalidLabel, tile_id + edge, directededge, cost,
+                         cost.cost, 0.0f, vs::TravelMode::kPedestrian, 0);
+  }
+
+  // Node at the end of an edge
+  static vb::GraphId EndNode(const uint64_t edge) {
+    return Reader().GetGraphTile(tile_id)->directededge(tile_id + edge)->endnode();
+  }
+
+  // Walk from a to stop b (edge 0), ride trip 1 from b to d (edge 3), walk
+  // from d to stop c (edge 6), ride trip 2 (of another operator) from c to
+  // a (edge 4) and walk from stop a to b (edge 0). Entering a stop and
+  // transferring each take 60 seconds.
+  Journey TransferJourney(const uint32_t start_time) {
+    auto a = EndNode(4), b = EndNode(0), c = EndNode(6), d = EndNode(3);
+    access_.edgelabels = { Label(0, 100) };
+    access_.stops = { { b.value, 0 } };
+    egress_.edgelabels = { Label(2, 100) };
+    egress_.stops = { { a.value, 0 } };
+    rides_ = { { tile_id + uint64_t(3), 1, start_time + 400, vb::kInvalidLabel },
+               { tile_id + uint64_t(4), 2, start_time + 800, vb::kInvalidLabel } };
+    footpaths_[d.value] = { { c, 120, { { tile_id + uint64_t(6), 120 } } } };
+    rounds_.resize(3);
+    rounds_[0].walks[b.value] = { start_time + 160, vb::GraphId(), 0, 0, 0.0f };
+    rounds_[1].rides[d.value] = { start_time + 400, b, 0, 1, 0.0f };
+    rounds_[1].walks[c.value] = { start_time + 580, d, 0, 1, 0.0f };
+    rounds_[2].rides[a.value] = { start_time + 800, c, 1, 2,
+                                  vt::kOperatorChangePenalty };
+    return { 2, a, true };
+  }
+};
+
+std::vector<vt::PathInfo> GetBestPath(vb::PathLocation origin, vb::PathLocation dest) {
+  vs::cost_ptr_t costs[int(vs::TravelMode::kMaxTravelMode)];
+  costs[int(vs::TravelMode::kPedestrian)] = vs::CreatePedestrianCost(bpt::ptree());
+  costs[int(vs::TravelMode::kPublicTransit)] = vs::CreateTransitCost(bpt::ptree());
+  vt::RaptorPathAlgorithm raptor;
+  return raptor.GetBestPath(origin, dest, Reader(), costs, vs::TravelMode::kPedestrian);
+}
+
+void TestWalkingPath() {
+  auto path = GetBestPath(Node(a, {0, 1}, {2, 4}), Node(d, {6, 7}, {3, 5}));
+
+  // Either way around the square is two edges
+  if (path.size() != 2)
+    throw runtime_error("Walking path should have two edges");
+  bool via_b = path[0].edgeid == tile_id + uint64_t(0) && path[1].edgeid == tile_id + uint64_t(3);
+  bool via_c = path[0].edgeid == tile_id + uint64_t(1) && path[1].edgeid == tile_id + uint64_t(5);
+  if (!via_b && !via_c)
+    throw runtime_error("Walking path should go around the square");
+  for (const auto& edge : path) {
+    if (edge.mode != vs::TravelMode::kPedestrian || edge.trip_id != 0)
+      throw runtime_error("Walking path should only walk");
+  }
+
+  // Elapsed time is the time along both edges (plus any transition cost)
+  auto pedestrian = vs::CreatePedestrianCost(bpt::ptree());
+  const auto* tile = Reader().GetGraphTile(tile_id);
+  float secs = pedestrian->EdgeCost(tile->directededge(path[0].edgeid)).secs +
+               pedestrian->EdgeCost(tile->directededge(path[1].edgeid)).secs;
+  if (path[0].elapsed_time >= path[1].elapsed_time ||
+      path[1].elapsed_time < static_cast<uint32_t>(secs) ||
+      path[1].elapsed_time > secs + 60)
+    throw runtime_error("Incorrect walking time");
+}
+
+void TestNoPath() {
+  // Without a date time there is no transit schedule
+  auto origin = Node(a, {0, 1}, {2, 4});
+  origin.date_time_ = boost::none;
+  if (!GetBestPath(origin, Node(d, {6, 7}, {3, 5})).empty())
+    throw runtime_error("Path requires a date time");
+
+  // The triangle cannot be reached from the square
+  if (!GetBestPath(Node(a, {0, 1}, {2, 4}), Node(e, {8, 9}, {10, 12})).empty())
+    throw runtime_error("Unreachable destination should have no path");
+}
+
+void TestTransferPath() {
+  // Board a trip, transfer once by walking and board another trip
+  const uint32_t start_time = 8 * 3600;
+  TestRaptor raptor;
+  auto journey = raptor.TransferJourney(start_time);
+  auto path = raptor.FormPath(Reader(), journey, start_time);
+  const std::vector<std::tuple<uint64_t, vs::TravelMode, uint32_t, uint32_t> > expected{
+    std::make_tuple(0, vs::TravelMode::kPedestrian, 0, 160),
+    std::make_tuple(3, vs::TravelMode::kPublicTransit, 1, 400),
+    std::make_tuple(6, vs::TravelMode::kPedestrian, 0, 580),
+    std::make_tuple(4, vs::TravelMode::kPublicTransit, 2, 800),
+    std::make_tuple(0, vs::TravelMode::kPedestrian, 0, 900) };
+  if (path.size() != expected.size())
+    throw runtime_error("Transfer path should have five edges");
+  for (size_t i = 0; i < path.size(); ++i) {
+    if (path[i].edgeid != tile_id + std::get<0>(expected[i]) ||
+        path[i].mode != std::get<1>(expected[i]) ||
+        path[i].trip_id != std::get<2>(expected[i]))
+      throw runtime_error("Incorrect edge " + std::to_string(i) + " of transfer path");
+
+    // Walks to a stop end at the time the stop is boarded from, including
+    // the time to enter the stop or transfer
+    if (path[i].elapsed_time != std::get<3>(expected[i]))
+      throw runtime_error("Incorrect elapsed time " + std::to_string(path[i].elapsed_time) +
+                          " at edge " + std::to_string(i) + " of transfer path");
+  }
+}
+
+void TestOperatorChangePenalty() {
+  // No penalty boarding the first trip or a trip of the same operator
+  TestRaptor::StopLabel walked{ 0, vb::GraphId(), 0, 0, 0.0f };
+  if (TestRaptor::BoardingPenalty(walked, 1) != 0.0f)
+    throw runtime_error("Boarding the first trip should have no penalty");
+  TestRaptor::StopLabel rode{ 0, vb::GraphId(), 0, 1, 0.0f };
+  if (TestRaptor::BoardingPenalty(rode, 1) != 0.0f)
+    throw runtime_error("Staying with the operator should have no penalty");
+
+  // Changing operators adds to the penalties of the journey so far
+  if (TestRaptor::BoardingPenalty(rode, 2) != vt::kOperatorChangePenalty)
+    throw runtime_error("Changing operators should have a penalty");
+  TestRaptor::StopLabel changed{ 0, vb::GraphId(), 0, 2, vt::kOperatorChangePenalty };
+  if (TestRaptor::BoardingPenalty(changed, 1) != 2 * vt::kOperatorChangePenalty)
+    throw runtime_error("Operator change penalties should add up");
+}
+
+}
+
+int main() {
+  test::suite suite("raptor");
+
+  // Test walking when there is no transit
+  suite.test(TEST_CASE(TestWalkingPath));
+
+  // Test locations without a path
+  suite.test(TEST_CASE(TestNoPath));
+
+  // Test the path of a journey with a transfer between trips
+  suite.test(TEST_CASE(TestTransferPath));
+
+  // Test the operator change penalty
+  suite.test(TEST_CASE(TestOperatorChangePenalty));
+
+  return suite.tear_down();
+}
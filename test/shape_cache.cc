@@ -0,0 +1,118 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/shape_cache.h"
+
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+using namespace valhalla::midgard;
+using namespace valhalla::thor;
+
+namespace {
+
+// Shape with the given number of points
+ShapeCache::Shape MakeShape(const size_t count) {
+  ShapeCache::Shape shape;
+  for (size_t i = 0; i < count; i++) {
+    shape.emplace_back(static_cast<float>(i), static_cast<float>(i));
+  }
+  shape.shrink_to_fit();
+  return shape;
+}
+
+void TestGet() {
+  ShapeCache cache;
+  uint32_t decoded = 0;
+  auto decode = [&decoded]() { decoded++; return MakeShape(5); };
+
+  auto shape = cache.Get(ShapeCache::Key(1, 10), decode);
+  if (shape->size() != 5 || decoded != 1)
+    throw runtime_error("Shape should be decoded");
+  if (cache.Get(ShapeCache::Key(1, 10), decode) != shape || decoded != 1)
+    throw runtime_error("Shape should be found in the cache");
+
+  // Same offset in another tile is a different shape
+  if (cache.Get(ShapeCache::Key(2, 10), decode) == shape || decoded != 2)
+    throw runtime_error("Shape of another tile should be decoded");
+  if (cache.size() != 2 || cache.hits() != 1 || cache.misses() != 2)
+    throw runtime_error("Incorrect cache counts");
+
+  // Clear keeps the hit and miss counts
+  cache.Clear();
+  if (cache.size() != 0 || cache.memory() != 0 || cache.hits() != 1)
+    throw runtime_error("Cache should be cleared");
+  cache.Get(ShapeCache::Key(1, 10), decode);
+  if (decoded != 3 || cache.misses() != 3)
+    throw runtime_error("Shape should be decoded after clearing the cache");
+}
+
+void TestEviction() {
+  // Room for a few shapes of 100 points
+  size_t max_size = 3 * (100 * sizeof(PointLL) + 128);
+  ShapeCache cache(max_size);
+  uint32_t decoded = 0;
+  auto decode = [&decoded]() { decoded++; return MakeShape(100); };
+
+  auto first = cache.Get(ShapeCache::Key(1, 0), decode);
+  cache.Get(ShapeCache::Key(1, 1), decode);
+  cache.Get(ShapeCache::Key(1, 2), decode);
+  if (cache.size() != 3 || cache.memory() > max_size)
+    throw runtime_error("Shapes should fit in the cache");
+
+  // Use the first so the second is the least recently used and evicted
+  cache.Get(ShapeCache::Key(1, 0), decode);
+  cache.Get(ShapeCache::Key(1, 3), decode);
+  if (cache.size() != 3 || cache.memory() > max_size)
+    throw runtime_error("Cache should not exceed the maximum size");
+  cache.Get(ShapeCache::Key(1, 0), decode);
+  if (decoded != 4)
+    throw runtime_error("Recently used shape should not be evicted");
+  cache.Get(ShapeCache::Key(1, 1), decode);
+  if (decoded != 5)
+    throw runtime_error("Least recently used shape should be evicted");
+
+  // A shape in use stays valid after being evicted
+  cache.Clear();
+  if (first->size() != 100)
+    throw runtime_error("Evicted shape should stay valid");
+
+  // A shape larger than the cache is returned but not kept
+  ShapeCache small(64);
+  auto shape = small.Get(ShapeCache::Key(1, 0), decode);
+  if (shape->size() != 100 || small.size() != 0 || small.memory() != 0)
+    throw runtime_error("Shape larger than the cache should not be kept");
+}
+
+void TestReport() {
+  ShapeCache cache;
+  auto decode = []() { return MakeShape(2); };
+  cache.Get(ShapeCache::Key(1, 0), decode);
+  cache.Get(ShapeCache::Key(1, 0), decode);
+  cache.Get(ShapeCache::Key(1, 0), decode);
+  cache.Get(ShapeCache::Key(1, 1), decode);
+  auto report = cache.Report();
+  if (report.find("shapes=2") == std::string::npos ||
+      report.find("hits=2") == std::string::npos ||
+      report.find("misses=2") == std::string::npos ||
+      report.find("hit_rate=0.500") == std::string::npos)
+    throw runtime_error("Incorrect report: " + report);
+}
+
+}
+
+int main() {
+  test::suite suite("shape_cache");
+
+  // Test getting shapes
+  suite.test(TEST_CASE(TestGet));
+
+  // Test evicting shapes
+  suite.test(TEST_CASE(TestEviction));
+
+  // Test reporting the cache use
+  suite.test(TEST_CASE(TestReport));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,161 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/speed_store.h"
+#include "thor/historical_speeds.h"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <stdexcept>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace valhalla::thor;
+
+namespace {
+
+// Write a speed file by renaming a new file over it
+void WriteSpeeds(const std::string& dir, const uint32_t tileid,
+                 const std::vector<uint8_t>& speeds,
+                 const std::string& extension = ".spd") {
+  std::string fname = dir + std::to_string(tileid) + extension;
+  std::ofstream file(fname + ".tmp", std::ios::binary);
+  file.write(reinterpret_cast<const char*>(speeds.data()), speeds.size());
+  file.close();
+  if (rename((fname + ".tmp").c_str(), fname.c_str()) != 0)
+    throw runtime_error("Could not write speed file");
+}
+
+std::string TrafficDir() {
+  char dir[] = "/tmp/speed_store_XXXXXX";
+  if (mkdtemp(dir) == nullptr)
+    throw runtime_error("Could not create traffic directory");
+  return std::string(dir) + "/";
+}
+
+void TestGet() {
+  auto dir = TrafficDir();
+  WriteSpeeds(dir, 1, {0, 40, 100});
+  SpeedStore store(dir);
+
+  auto speeds = store.Get(1);
+  if (!speeds || speeds->size() != 3 || speeds->speed(1) != 40 ||
+      speeds->speed(2) != 100)
+    throw runtime_error("Speeds should be read from the speed file");
+  if (speeds->speed(0) != 0 || speeds->speed(3) != 0)
+    throw runtime_error("Edges without speeds should have speed 0");
+  if (store.Get(2) != nullptr)
+    throw runtime_error("Tile without a speed file should have no speeds");
+}
+
+void TestReload() {
+  auto dir = TrafficDir();
+  WriteSpeeds(dir, 1, {10, 20});
+
+  // Updates are not checked until the reload interval has passed
+  SpeedStore cached(dir, 2, 3600);
+  auto speeds = cached.Get(1);
+  WriteSpeeds(dir, 1, {30, 40, 50});
+  if (cached.Get(1) != speeds)
+    throw runtime_error("Speeds should not be reloaded within the interval");
+
+  // The replaced speed file is reloaded while the old speeds remain valid
+  SpeedStore store(dir, 2, 0);
+  speeds = store.Get(1);
+  WriteSpeeds(dir, 1, {60, 70});
+  auto reloaded = store.Get(1);
+  if (!reloaded || reloaded->speed(0) != 60 || reloaded->speed(1) != 70)
+    throw runtime_error("Replaced speed file should be reloaded");
+  if (speeds->size() != 3 || speeds->speed(2) != 50)
+    throw runtime_error("Old speeds should remain valid after a reload");
+  if (store.Get(1) != reloaded)
+    throw runtime_error("Unchanged speed file should not be reloaded");
+
+  // A speed file added for a tile without speeds is found
+  if (store.Get(2) != nullptr)
+    throw runtime_error("Tile without a speed file should have no speeds");
+  WriteSpeeds(dir, 2, {80});
+  auto added = store.Get(2);
+  if (!added || added->speed(0) != 80)
+    throw runtime_error("Added speed file should be loaded");
+}
+
+void TestEviction() {
+  auto dir = TrafficDir();
+  WriteSpeeds(dir, 1, {10});
+  WriteSpeeds(dir, 2, {20});
+  WriteSpeeds(dir, 3, {30});
+  SpeedStore store(dir, 2, 3600);
+
+  // Use tile 1 so tile 2 is the least recently used and is evicted
+  auto speeds = store.Get(1);
+  auto evicted = store.Get(2);
+  store.Get(1);
+  store.Get(3);
+  if (store.size() != 2)
+    throw runtime_error("Store should keep at most the maximum tiles");
+  if (store.Get(1) != speeds)
+    throw runtime_error("Recently used tile should not be evicted");
+  if (evicted->speed(0) != 20)
+    throw runtime_error("Evicted speeds should remain valid while in use");
+  if (store.Get(2) == evicted)
+    throw runtime_error("Least recently used tile should be evicted");
+
+  store.Clear();
+  if (store.size() != 0)
+    throw runtime_error("Store should be empty after Clear");
+}
+
+
+void TestHistoricalSpeeds() {
+  // Edges 0 and 2 have the same profile after rounding, edge 1 has none
+  std::vector<uint8_t> rush(kHoursPerWeek, 100);
+  for (uint32_t day = 1; day < 6; day++) {
+    rush[day * 24 + 8] = 41;
+  }
+  auto similar = rush;
+  similar[0] = 99;
+  std::vector<uint8_t> slow(kHoursPerWeek, 30);
+  auto data = HistoricalSpeeds::Encode({rush, {}, similar, slow}, 2);
+
+  auto dir = TrafficDir();
+  WriteSpeeds(dir, 1, data, ".hsp");
+  SpeedStore store(dir, 2, 3600, ".hsp");
+  HistoricalSpeeds speeds(store.Get(1));
+  if (speeds.profile_count() != 2)
+    throw runtime_error("Similar speed profiles should be shared");
+  if (speeds.speed(0, 0) != 100 || speeds.speed(2, 0) != 100 ||
+      speeds.speed(3, 0) != 30)
+    throw runtime_error("Historical speeds should be read from the file");
+  if (speeds.speed(0, 32) != 42 || speeds.speed(0, 33) != 100)
+    throw runtime_error("Historical speed should depend on the hour");
+  if (speeds.speed(1, 0) != 0 || speeds.speed(4, 0) != 0)
+    throw runtime_error("Edges without historical speeds should have speed 0");
+
+  // Monday 08:30 and the same time a week later
+  if (HistoricalSpeeds::HourOfWeek(32 * 3600 + 1800) != 32 ||
+      HistoricalSpeeds::HourOfWeek((32 + kHoursPerWeek) * 3600) != 32)
+    throw runtime_error("Hour of the week should wrap to the next week");
+
+  // A truncated file has no speeds
+  data.resize(data.size() - 1);
+  WriteSpeeds(dir, 2, data, ".hsp");
+  HistoricalSpeeds truncated(store.Get(2));
+  if (truncated.profile_count() != 0 || truncated.speed(0, 0) != 0)
+    throw runtime_error("Truncated historical speed file should have no speeds");
+}
+
+}
+
+int main() {
+  test::suite suite("speed_store");
+
+  suite.test(TEST_CASE(TestGet));
+  suite.test(TEST_CASE(TestReload));
+  suite.test(TEST_CASE(TestEviction));
+  suite.test(TEST_CASE(TestHistoricalSpeeds));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,240 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/timedistancematrix.h"
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/tilehierarchy.h>
+#include <valhalla/sif/pedestriancost.h>
+
+using namespace std;
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace bpt = boost::property_tree;
+
+namespace {
+
+// Square a(0.01,0.10) b(0.10,0.10) c(0.01,0.01) d(0.10,0.01) of the astar
+// test tile, with edges a->b 0, a->c 1, b->a 2, b->d 3, c->a 4, c->d 5,
+// d->c 6, d->b 7 (about 10 km each). Triangle e f g (edges 8-13) is not
+// connected to the square.
+TileHierarchy h("test/fake_tiles_astar");
+GraphId tile_id = h.GetGraphId({.125, .125}, 2);
+
+// Search well beyond the default cost threshold so pedestrian paths across
+// the square are found
+constexpr float kTestCostThreshold = 100000.0f;
+
+GraphReader& Reader() {
+  static std::unique_ptr<GraphReader> reader;
+  if (!reader) {
+    std::stringstream json;
+    json << "{ \"tile_dir\": \"test/fake_tiles_astar\" }";
+    bpt::ptree conf;
+    bpt::json_parser::read_json(json, conf);
+    reader.reset(new GraphReader(conf));
+  }
+  return *reader;
+}
+
+// Location at a node given its edges and the distance along each
+PathLocation Location(const PointLL& ll,
+                      const std::vector<std::pair<uint32_t, float> >& edges) {
+  PathLocation location(ll);
+  for (const auto& edge : edges) {
+    location.edges.emplace_back(tile_id + uint64_t(edge.first), edge.second,
+                                ll, 0.0f);
+  }
+  return location;
+}
+
+PathLocation A() {
+  return Location({0.01, 0.10}, {{0, 0.0f}, {1, 0.0f}, {2, 1.0f}, {4, 1.0f}});
+}
+PathLocation B() {
+  return Location({0.10, 0.10}, {{2, 0.0f}, {3, 0.0f}, {0, 1.0f}, {7, 1.0f}});
+}
+PathLocation C() {
+  return Location({0.01, 0.01}, {{4, 0.0f}, {5, 0.0f}, {1, 1.0f}, {6, 1.0f}});
+}
+PathLocation D() {
+  return Location({0.10, 0.01}, {{6, 0.0f}, {7, 0.0f}, {3, 1.0f}, {5, 1.0f}});
+}
+PathLocation E() {
+  return Location({0.01, 0.14}, {{8, 0.0f}, {9, 0.0f}, {10, 1.0f}, {12, 1.0f}});
+}
+
+struct Costing {
+  std::shared_ptr<DynamicCost> costs[static_cast<int>(TravelMode::kMaxTravelMode)];
+  Costing() {
+    costs[static_cast<int>(TravelMode::kPedestrian)] =
+        CreatePedestrianCost(bpt::ptree());
+  }
+};
+
+bool Found(const TimeDistance& td) {
+  return td.time != kMaxCost && td.dist != kMaxCost;
+}
+
+// Matrix that reports whether its search ran out of labels to expand
+class TestMatrix : public TimeDistanceMatrix {
+ public:
+  TestMatrix()
+      : TimeDistanceMatrix(kTestCostThreshold) {
+  }
+  bool exhausted() {
+    return adjacencylist_->pop() == kInvalidLabel;
+  }
+};
+
+std::vector<TimeDistance> OneToMany(const std::vector<PathLocation>& locations,
+                                    const float max_time = kMaxCost,
+                                    const float max_distance = kMaxCost,
+                                    const uint32_t k_nearest = 0) {
+  Costing costing;
+  TimeDistanceMatrix matrix(kTestCostThreshold);
+  return matrix.OneToMany(A(), locations, Reader(), costing.costs,
+                          TravelMode::kPedestrian, max_time, max_distance,
+                          k_nearest);
+}
+
+void TestUnlimited() {
+  // All of the square is reached, the triangle is not
+  auto td = OneToMany({ B(), C(), D(), E() });
+  if (td.size() != 4)
+    throw runtime_error("There should be a result for each location");
+  if (!Found(td[0]) || !Found(td[1]) || !Found(td[2]))
+    throw runtime_error("Locations on the square should be reached");
+  if (td[2].dist <= td[0].dist || td[2].time <= td[0].time)
+    throw runtime_error("The opposite corner should be further than b");
+  if (Found(td[3]))
+    throw runtime_error("The disconnected location should not be reached");
+}
+
+void TestMaxDistance() {
+  // Only the corners next to the origin are within the distance limit
+  auto unlimited = OneToMany({ B(), C(), D() });
+  float max_distance = (unlimited[0].dist + unlimited[2].dist) * 0.5f;
+  auto td = OneToMany({ B(), C(), D() }, kMaxCost, max_distance);
+  if (td[0].time != unlimited[0].time || td[0].dist != unlimited[0].dist ||
+      td[1].time != unlimited[1].time || td[1].dist != unlimited[1].dist)
+    throw runtime_error("Locations within the distance limit should not change");
+  if (td[2].time != kMaxCost || td[2].dist != kMaxCost)
+    throw runtime_error("Location beyond the distance limit should be kMaxCost");
+
+  // Many to one with the same limit
+  Costing costing;
+  TimeDistanceMatrix matrix(kTestCostThreshold);
+  td = matrix.ManyToOne(A(), { B(), C(), D() }, Reader(), costing.costs,
+                        TravelMode::kPedestrian, kMaxCost, max_distance);
+  if (!Found(td[0]) || !Found(td[1]) || Found(td[2]))
+    throw runtime_error("Many to one should apply the distance limit");
+}
+
+void TestMaxTime() {
+  // Only the corners next to the origin are within the time limit
+  auto unlimited = OneToMany({ B(), C(), D() });
+  float max_time = (unlimited[0].time + unlimited[2].time) * 0.5f;
+  auto td = OneToMany({ B(), C(), D() }, max_time);
+  if (td[0].time != unlimited[0].time || td[1].time != unlimited[1].time)
+    throw runtime_error("Locations within the time limit should not change");
+  if (td[2].time != kMaxCost || td[2].dist != kMaxCost)
+    throw runtime_error("Location beyond the time limit should be kMaxCost");
+
+  // A limit below the nearest location leaves nothing
+  td = OneToMany({ B(), C(), D() }, unlimited[0].time * 0.5f);
+  if (Found(td[0]) || Found(td[1]) || Found(td[2]))
+    throw runtime_error("No location should be within half the time to b");
+}
+
+
+void TestKNearest() {
+  // The two corners next to the origin are nearest
+  auto unlimited = OneToMany({ D(), B(), C() });
+  auto td = OneToMany({ D(), B(), C() }, kMaxCost, kMaxCost, 2);
+  if (Found(td[0]))
+    throw runtime_error("The opposite corner should not be among the 2 nearest");
+  if (td[1].time != unlimited[1].time || td[1].dist != unlimited[1].dist ||
+      td[2].time != unlimited[2].time || td[2].dist != unlimited[2].dist)
+    throw runtime_error("The 2 nearest should keep their results");
+
+  // With k at least the number of locations all are found
+  for (uint32_t k : { 3, 5 }) {
+    td = OneToMany({ D(), B(), C() }, kMaxCost, kMaxCost, k);
+    for (uint32_t i = 0; i < td.size(); i++) {
+      if (td[i].time != unlimited[i].time || td[i].dist != unlimited[i].dist)
+        throw runtime_error("All locations should be found with k = " +
+                            std::to_string(k));
+    }
+  }
+}
+
+void TestKNearestTies() {
+  // Locations with the same cost go to the lower index
+  auto td = OneToMany({ B(), B(), D() }, kMaxCost, kMaxCost, 1);
+  if (!Found(td[0]) || Found(td[1]) || Found(td[2]))
+    throw runtime_error("The first of the tied locations should be kept");
+  td = OneToMany({ D(), B(), B() }, kMaxCost, kMaxCost, 1);
+  if (Found(td[0]) || !Found(td[1]) || Found(td[2]))
+    throw runtime_error("The lower index of the tied locations should be kept");
+  td = OneToMany({ D(), B(), B(), C() }, kMaxCost, kMaxCost, 2);
+  if (Found(td[0]) || !Found(td[1]) || Found(td[2]) == Found(td[3]))
+    throw runtime_error("Only one of the last two locations should be kept");
+}
+
+void TestKNearestEarlyStop() {
+  // The unreachable location keeps the search going until every label is
+  // expanded, unless only the nearest location is needed
+  Costing costing;
+  TestMatrix matrix;
+  auto td = matrix.OneToMany(A(), { B(), E() }, Reader(), costing.costs,
+                             TravelMode::kPedestrian);
+  if (!Found(td[0]) || Found(td[1]) || !matrix.exhausted())
+    throw runtime_error("The search should expand every label");
+
+  TestMatrix nearest;
+  auto k_td = nearest.OneToMany(A(), { B(), E() }, Reader(), costing.costs,
+                                TravelMode::kPedestrian, kMaxCost, kMaxCost, 1);
+  if (k_td[0].time != td[0].time || k_td[0].dist != td[0].dist || Found(k_td[1]))
+    throw runtime_error("The nearest location should keep its result");
+  if (nearest.exhausted())
+    throw runtime_error("The search should stop once the nearest is settled");
+}
+
+}
+
+int main() {
+  test::suite suite("timedistancematrix");
+
+  // Test without limits
+  suite.test(TEST_CASE(TestUnlimited));
+
+  // Test the distance limit
+  suite.test(TEST_CASE(TestMaxDistance));
+
+  // Test the time limit
+  suite.test(TEST_CASE(TestMaxTime));
+
+  // Test the k nearest locations
+  suite.test(TEST_CASE(TestKNearest));
+
+  // Test ties among the k nearest locations
+  suite.test(TEST_CASE(TestKNearestTies));
+
+  // Test stopping the search once the k nearest are found
+  suite.test(TEST_CASE(TestKNearestEarlyStop));
+
+  return suite.tear_down();
+}
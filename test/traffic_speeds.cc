@@ -0,0 +1,358 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/traffic_speeds.h"
+#include "thor/bidirectional_astar.h"
+#include "thor/costmatrix.h"
+#include "thor/timedistancematrix.h"
+#include "thor/trafficalgorithm.h"
+#include "thor/historical_speeds.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <stdexcept>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/tilehierarchy.h>
+#include <valhalla/sif/autocost.h>
+#include <valhalla/sif/pedestriancost.h>
+
+using namespace std;
+
+namespace bpt = boost::property_tree;
+
+namespace vm = valhalla::midgard;
+namespace vb = valhalla::baldr;
+namespace vs = valhalla::sif;
+namespace vt = valhalla::thor;
+
+namespace {
+
+// Uses the square of roads in the astar test tile (see test/astar.cc):
+//
+//       0  2
+// a----->--<-----b
+// |              |
+// v 1          3 v
+// |              |
+// ^ 4          7 ^
+// |              |
+// c----->--<-----d
+//       5  6
+//
+vb::TileHierarchy h("test/fake_tiles_astar");
+vb::GraphId tile_id = h.GetGraphId({.125, .125}, 2);
+
+const vm::PointLL a(0.01, 0.10);
+const vm::PointLL c(0.01, 0.01);
+
+// Number of directed edges in the test tile
+constexpr uint32_t kEdgeCount = 14;
+
+vb::GraphReader& Reader() {
+  static std::unique_ptr<vb::GraphReader> reader;
+  if (!reader) {
+    std::stringstream json;
+    json << "{ \"tile_dir\": \"test/fake_tiles_astar\" }";
+    bpt::ptree conf;
+    bpt::json_parser::read_json(json, conf);
+    reader.reset(new vb::GraphReader(conf));
+  }
+  if (reader->GetGraphTile(tile_id) == nullptr)
+    throw runtime_error("Unable to load test tile");
+  return *reader;
+}
+
+// Speed store with a different speed on each directed edge so opposing
+// edges have different speeds
+std::shared_ptr<vt::SpeedStore> Speeds() {
+  char dir[] = "/tmp/traffic_speeds_XXXXXX";
+  if (mkdtemp(dir) == nullptr)
+    throw runtime_error("Could not create traffic directory");
+  std::string traffic_dir = std::string(dir) + "/";
+  std::vector<uint8_t> speeds;
+  for (uint32_t i = 0; i < kEdgeCount; i++) {
+    speeds.push_back(10 + 5 * i);
+  }
+  std::ofstream file(traffic_dir + std::to_string(tile_id.tileid()) + ".spd",
+                     std::ios::binary);
+  file.write(reinterpret_cast<const char*>(speeds.data()), speeds.size());
+  file.close();
+  return std::make_shared<vt::SpeedStore>(traffic_dir);
+}
+
+// Historical speeds of 10 kph on Monday from 08:00 to 09:00 (hour 32 of the
+// week) and 60 kph at other times on every directed edge
+std::shared_ptr<vt::SpeedStore> HistoricalStore(const std::string& traffic_dir) {
+  std::vector<uint8_t> profile(vt::kHoursPerWeek, 60);
+  profile[32] = 10;
+  std::vector<std::vector<uint8_t> > edge_speeds(kEdgeCount, profile);
+  auto data = vt::HistoricalSpeeds::Encode(edge_speeds);
+  std::ofstream file(traffic_dir + std::to_string(tile_id.tileid()) + ".hsp",
+                     std::ios::binary);
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  file.close();
+  return std::make_shared<vt::SpeedStore>(traffic_dir, vt::kDefaultMaxSpeedTiles,
+                                          vt::kDefaultSpeedReloadInterval, ".hsp");
+}
+
+// Location part way along edge 0 (a to b), correlated to both directions
+vb::PathLocation Origin() {
+  vm::PointLL ll = a.MidPoint({0.10, 0.10});
+  vb::PathLocation origin(ll);
+  origin.edges.emplace_back(tile_id + uint64_t(0), 0.25f, ll, 0.0f);
+  origin.edges.emplace_back(tile_id + uint64_t(2), 0.75f, ll, 0.0f);
+  return origin;
+}
+
+// Location part way along edge 5 (c to d), correlated to both directions
+vb::PathLocation Destination() {
+  vm::PointLL ll = c.MidPoint({0.10, 0.01});
+  vb::PathLocation dest(ll);
+  dest.edges.emplace_back(tile_id + uint64_t(5), 0.4f, ll, 0.0f);
+  dest.edges.emplace_back(tile_id + uint64_t(6), 0.6f, ll, 0.0f);
+  return dest;
+}
+
+struct Times {
+  uint32_t one_to_many;
+  uint32_t many_to_one;
+  uint32_t cost_matrix;
+  uint32_t bidirectional;
+};
+
+// Get the time from the origin to the destination with each algorithm
+Times GetTimes(const vs::cost_ptr_t& costing, const vs::TravelMode mode,
+               const std::shared_ptr<vt::SpeedStore>& speed_store) {
+  vs::cost_ptr_t costs[int(vs::TravelMode::kMaxTravelMode)];
+  costs[int(mode)] = costing;
+  auto origin = Origin();
+  auto dest = Destination();
+  std::vector<vb::PathLocation> origins = { origin };
+  std::vector<vb::PathLocation> dests = { dest };
+
+  Times times;
+  vt::TimeDistanceMatrix tdm;
+  tdm.set_speed_store(speed_store, tile_id.level());
+  times.one_to_many = tdm.OneToMany(origin, dests, Reader(), costs, mode).front().time;
+  times.many_to_one = tdm.ManyToOne(dest, origins, Reader(), costs, mode).front().time;
+
+  vt::CostMatrix matrix;
+  matrix.set_speed_store(speed_store, tile_id.level());
+  times.cost_matrix = matrix.SourceToTarget(origins, dests, Reader(), costs, mode).front().time;
+
+  vt::BidirectionalAStar astar;
+  astar.set_speed_store(speed_store, tile_id.level());
+  auto path = astar.GetBestPath(origin, dest, Reader(), costs, mode);
+  if (path.empty())
+    throw runtime_error("Bidirectional A* should find a path");
+  times.bidirectional = path.back().elapsed_time;
+  return times;
+}
+
+bool Near(const uint32_t t1, const uint32_t t2) {
+  return std::abs(static_cast<int>(t1) - static_cast<int>(t2)) <= 1;
+}
+
+void TestSpeeds() {
+  vt::TrafficSpeeds traffic;
+  auto pedestrian = vs::CreatePedestrianCost(bpt::ptree());
+  auto automobile = vs::CreateAutoCost(bpt::ptree());
+  if (traffic.enabled() || traffic.speed(tile_id + uint64_t(1)) != 0)
+    throw runtime_error("Traffic should be disabled without a speed store");
+
+  traffic.set_speed_store(Speeds(), tile_id.level());
+  if (!traffic.enabled() || traffic.speed(tile_id + uint64_t(1)) != 15)
+    throw runtime_error("Speed should be read from the speed store");
+  if (!traffic.enabled(automobile) || traffic.enabled(pedestrian))
+    throw runtime_error("Traffic speeds should only be used for driving");
+
+  // Edges are costed at their real-time speed only when driving
+  auto edgeid = tile_id + uint64_t(1);
+  const auto* edge = Reader().GetGraphTile(tile_id)->directededge(edgeid);
+  float sec = edge->length() * 3.6f / 15.0f;
+  if (std::abs(traffic.EdgeCost(automobile, edge, edgeid).secs - sec) > 0.01f)
+    throw runtime_error("Driving edge cost should use the real-time speed");
+  if (traffic.EdgeCost(pedestrian, edge, edgeid).secs !=
+      pedestrian->EdgeCost(edge).secs)
+    throw runtime_error("Walking edge cost should not use the real-time speed");
+}
+
+void TestPedestrianUnchanged() {
+  auto pedestrian = vs::CreatePedestrianCost(bpt::ptree());
+  auto mode = vs::TravelMode::kPedestrian;
+  Times with = GetTimes(pedestrian, mode, Speeds());
+  Times without = GetTimes(pedestrian, mode, nullptr);
+  if (with.one_to_many != without.one_to_many ||
+      with.many_to_one != without.many_to_one ||
+      with.cost_matrix != without.cost_matrix ||
+      with.bidirectional != without.bidirectional)
+    throw runtime_error("Pedestrian times should not change with traffic");
+}
+
+void TestDrivingTraffic() {
+  auto automobile = vs::CreateAutoCost(bpt::ptree());
+  auto mode = vs::TravelMode::kDrive;
+  Times with = GetTimes(automobile, mode, Speeds());
+  Times without = GetTimes(automobile, mode, nullptr);
+  if (with.one_to_many == without.one_to_many)
+    throw runtime_error("Driving times should change with traffic");
+
+  // Each algorithm costs the partial origin and destination edges in the
+  // direction of travel, so all agree
+  std::stringstream times;
+  times << with.one_to_many << " " << with.many_to_one << " "
+        << with.cost_matrix << " " << with.bidirectional;
+  if (!Near(with.one_to_many, with.many_to_one))
+    throw runtime_error("Many to one time should match one to many: " + times.str());
+  if (!Near(with.one_to_many, with.cost_matrix))
+    throw runtime_error("Cost matrix time should match one to many: " + times.str());
+  if (!Near(with.one_to_many, with.bidirectional))
+    throw runtime_error("Bidirectional A* time should match one to many: " + times.str());
+}
+
+void TestTimeDependent() {
+  char dir[] = "/tmp/traffic_historical_XXXXXX";
+  if (mkdtemp(dir) == nullptr)
+    throw runtime_error("Could not create traffic directory");
+  std::string traffic_dir = std::string(dir) + "/";
+
+  // No real-time speeds so the historical speeds are used
+  vt::TrafficAlgorithm traffic;
+  auto speed_store = std::make_shared<vt::SpeedStore>(traffic_dir);
+  traffic.set_speed_store(speed_store, tile_id.level());
+  traffic.set_historical_store(HistoricalStore(traffic_dir));
+  traffic.set_time_dependent(true);
+
+  auto mode = vs::TravelMode::kDrive;
+  vs::cost_ptr_t costs[int(vs::TravelMode::kMaxTravelMode)];
+  costs[int(mode)] = vs::CreateAutoCost(bpt::ptree());
+  auto path = [&traffic, &costs, mode](const std::string& date_time)
+      -> std::vector<vt::PathInfo> {
+    auto origin = Origin();
+    auto dest = Destination();
+    if (!date_time.empty())
+      origin.date_time_ = date_time;
+    traffic.Clear();
+    auto edges = traffic.GetBestPath(origin, dest, Reader(), costs, mode);
+    if (edges.empty())
+      throw runtime_error("Traffic algorithm should find a path");
+    return edges;
+  };
+
+  // The path goes back along edge 2 from the origin then along edges 1
+  // and 5 (a to c to d). Departing Monday 08:00 the origin edge is costed
+  // at 10 kph.
+  auto rush = path("2017-05-01T08:00");
+  auto noon = path("2017-05-01T12:00");
+  auto untimed = path("");
+  const auto* edge = Reader().GetGraphTile(tile_id)->directededge(tile_id + uint64_t(2));
+  float origin_secs = 0.25f * edge->length() * 3.6f / 10.0f;
+  if (rush.front().edgeid != tile_id + uint64_t(2) ||
+      std::abs(static_cast<float>(rush.front().elapsed_time) - origin_secs) > 1.0f)
+    throw runtime_error("Origin edge should be costed with the historical speed");
+
+  // Slower at the Monday morning hour than at noon, and edges reached after
+  // the hour ends are costed at the faster speed
+  if (rush.back().elapsed_time <= noon.back().elapsed_time)
+    throw runtime_error("Hour of the week should change the path time");
+  uint32_t slow_secs = static_cast<uint32_t>(1.65f * edge->length() * 3.6f / 10.0f);
+  if (rush.back().elapsed_time >= slow_secs)
+    throw runtime_error("Edges reached after the hour should use the next hour's speed");
+
+  // Without a departure time the path is not time dependent
+  if (untimed.back().elapsed_time == noon.back().elapsed_time)
+    throw runtime_error("Path without a date_time should use the costing speeds");
+
+  // Speeds for another hierarchy level do not apply to the test tile even
+  // though the tile numbers match
+  traffic.set_speed_store(speed_store, tile_id.level() - 1);
+  if (path("2017-05-01T08:00").back().elapsed_time != untimed.back().elapsed_time)
+    throw runtime_error("Speeds should only apply to tiles on their level");
+}
+
+
+void TestDepartureHour() {
+  char dir[] = "/tmp/traffic_departure_XXXXXX";
+  if (mkdtemp(dir) == nullptr)
+    throw runtime_error("Could not create traffic directory");
+  std::string traffic_dir = std::string(dir) + "/";
+  auto historical_store = HistoricalStore(traffic_dir);
+
+  // Historical speeds are used at the departure hour, and not without a
+  // departure time
+  vt::TrafficSpeeds traffic;
+  traffic.set_speed_store(nullptr, tile_id.level());
+  traffic.set_historical_store(historical_store);
+  auto origin = Origin();
+  auto edgeid = tile_id + uint64_t(1);
+  traffic.SetDeparture(Reader(), origin);
+  if (traffic.speed(edgeid) != 0)
+    throw runtime_error("Historical speeds need a departure time");
+  origin.date_time_ = "2017-05-01T08:30";
+  traffic.SetDeparture(Reader(), origin);
+  if (traffic.speed(edgeid) != 10)
+    throw runtime_error("Historical speed at the departure hour should be used");
+  origin.date_time_ = "2017-05-01T12:00";
+  traffic.SetDeparture(Reader(), origin);
+  if (traffic.speed(edgeid) != 60)
+    throw runtime_error("Historical speed should follow the departure hour");
+
+  // Bidirectional A* paths depart at the hour of the origin date_time
+  auto mode = vs::TravelMode::kDrive;
+  vs::cost_ptr_t costs[int(vs::TravelMode::kMaxTravelMode)];
+  costs[int(mode)] = vs::CreateAutoCost(bpt::ptree());
+  vt::BidirectionalAStar astar;
+  astar.set_speed_store(nullptr, tile_id.level());
+  astar.set_historical_store(historical_store);
+  auto time = [&astar, &costs, mode](const std::string& date_time)
+      -> uint32_t {
+    auto origin = Origin();
+    auto dest = Destination();
+    if (!date_time.empty())
+      origin.date_time_ = date_time;
+    astar.Clear();
+    auto path = astar.GetBestPath(origin, dest, Reader(), costs, mode);
+    if (path.empty())
+      throw runtime_error("Bidirectional A* should find a path");
+    return path.back().elapsed_time;
+  };
+  if (time("2017-05-01T08:00") <= time("2017-05-01T12:00"))
+    throw runtime_error("Bidirectional A* should use the departure hour speeds");
+  if (time("") == time("2017-05-01T12:00"))
+    throw runtime_error("Bidirectional A* without a date_time should use the costing speeds");
+}
+
+}
+
+int main() {
+  test::suite suite("traffic_speeds");
+
+  // Test real-time speed lookups
+  suite.test(TEST_CASE(TestSpeeds));
+
+  // Test that walking is not affected by traffic
+  suite.test(TEST_CASE(TestPedestrianUnchanged));
+
+  // Test driving with traffic in each algorithm
+  suite.test(TEST_CASE(TestDrivingTraffic));
+
+  // Test time dependent routing with historical speeds
+  suite.test(TEST_CASE(TestTimeDependent));
+
+  // Test historical speeds at the departure hour
+  suite.test(TEST_CASE(TestDepartureHour));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,91 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/transit_operators.h"
+
+#include <string>
+#include <stdexcept>
+
+using namespace std;
+using namespace valhalla::thor;
+
+namespace {
+
+void TestGetOperatorId() {
+  TransitOperators operators;
+  uint32_t resolved = 0;
+  auto operator_a = [&resolved]() { resolved++; return string("o-a"); };
+  auto operator_b = [&resolved]() { resolved++; return string("o-b"); };
+
+  uint32_t a = operators.GetOperatorId(1, 3, operator_a);
+  if (a == 0)
+    throw runtime_error("Operator Ids should start at 1");
+  if (operators.GetOperatorId(1, 3, operator_b) != a || resolved != 1)
+    throw runtime_error("Route operator should be resolved once");
+
+  // Routes with the same operator share the Id
+  if (operators.GetOperatorId(1, 0, operator_a) != a || resolved != 2)
+    throw runtime_error("Routes of the same operator should share the Id");
+  uint32_t b = operators.GetOperatorId(1, 1, operator_b);
+  if (b == 0 || b == a)
+    throw runtime_error("Distinct operators should have distinct Ids");
+
+  // Routes without an operator are kept with operator 0
+  auto none = [&resolved]() { resolved++; return string(); };
+  if (operators.GetOperatorId(1, 2, none) != 0 ||
+      operators.GetOperatorId(1, 2, none) != 0 || resolved != 4)
+    throw runtime_error("Route without an operator should have Id 0");
+  if (operators.size() != 2)
+    throw runtime_error("Incorrect operator count");
+}
+
+void TestTiles() {
+  // The same route index in other tiles is resolved separately, also when
+  // lookups alternate between tiles
+  TransitOperators operators;
+  uint32_t resolved = 0;
+  auto operator_a = [&resolved]() { resolved++; return string("o-a"); };
+  auto operator_b = [&resolved]() { resolved++; return string("o-b"); };
+  uint32_t a = operators.GetOperatorId(1, 0, operator_a);
+  uint32_t b = operators.GetOperatorId(2, 0, operator_b);
+  for (uint32_t tileid = 3; tileid < 64; tileid++)
+    operators.GetOperatorId(tileid, 0, operator_b);
+  if (a == b || resolved != 63)
+    throw runtime_error("Routes should be resolved per tile");
+  if (operators.GetOperatorId(1, 0, operator_b) != a ||
+      operators.GetOperatorId(2, 0, operator_a) != b ||
+      operators.GetOperatorId(1, 0, operator_b) != a || resolved != 63)
+    throw runtime_error("Routes of earlier tiles should be found");
+}
+
+void TestClear() {
+  TransitOperators operators;
+  uint32_t resolved = 0;
+  auto operator_a = [&resolved]() { resolved++; return string("o-a"); };
+  auto operator_b = [&resolved]() { resolved++; return string("o-b"); };
+  operators.GetOperatorId(1, 0, operator_a);
+  operators.Clear();
+  if (operators.size() != 0)
+    throw runtime_error("Operators should be cleared");
+
+  // Routes are resolved again after clearing, with Ids starting over
+  if (operators.GetOperatorId(1, 0, operator_b) != 1 || resolved != 2)
+    throw runtime_error("Route should be resolved again after clearing");
+}
+
+}
+
+int main() {
+  test::suite suite("transit_operators");
+
+  // Test getting operator Ids
+  suite.test(TEST_CASE(TestGetOperatorId));
+
+  // Test routes within several tiles
+  suite.test(TEST_CASE(TestTiles));
+
+  // Test clearing the operator Ids
+  suite.test(TEST_CASE(TestClear));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,105 @@
+#include "test.h"
+
+#include "config.h"
+#include "thor/transit_stop_index.h"
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/tilehierarchy.h>
+
+using namespace std;
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::thor;
+
+namespace bpt = boost::property_tree;
+
+namespace {
+
+// The astar test tiles have no transit tiles, so stops are added to the
+// index directly
+class TestStopIndex : public TransitStopIndex {
+ public:
+  void AddStop(GraphReader& reader, const PointLL& ll) {
+    const auto& local = reader.GetTileHierarchy().levels().rbegin()->second;
+    GraphId tileid(local.tiles.TileId(ll), local.level + 1, 0);
+    stops_[tileid.value].push_back(ll);
+  }
+  size_t tile_count() const {
+    return stops_.size();
+  }
+};
+
+GraphReader& Reader() {
+  static std::unique_ptr<GraphReader> reader;
+  if (!reader) {
+    std::stringstream json;
+    json << "{ \"tile_dir\": \"test/fake_tiles_astar\" }";
+    bpt::ptree conf;
+    bpt::json_parser::read_json(json, conf);
+    reader.reset(new GraphReader(conf));
+  }
+  return *reader;
+}
+
+void TestNoStops() {
+  // Tiles without transit are indexed with no stops
+  TestStopIndex index;
+  if (index.HasStopWithin(Reader(), PointLL(0.05f, 0.05f), 2000.0f))
+    throw runtime_error("There should be no stops without transit tiles");
+  if (index.tile_count() == 0)
+    throw runtime_error("Tiles without transit should be indexed");
+}
+
+void TestDistance() {
+  TestStopIndex index;
+  index.AddStop(Reader(), PointLL(0.05f, 0.05f));
+
+  // About 1112 meters north of the stop
+  PointLL ll(0.05f, 0.06f);
+  if (index.HasStopWithin(Reader(), ll, 1000.0f))
+    throw runtime_error("Stop should not be within 1000 meters");
+  if (!index.HasStopWithin(Reader(), ll, 1200.0f))
+    throw runtime_error("Stop should be within 1200 meters");
+}
+
+void TestNeighborTile() {
+  // Stop just across the boundary of the 0.25 degree local tiles is found
+  // from a location in the other tile
+  TestStopIndex index;
+  index.AddStop(Reader(), PointLL(0.255f, 0.125f));
+  PointLL ll(0.245f, 0.125f);
+  if (!index.HasStopWithin(Reader(), ll, 1500.0f))
+    throw runtime_error("Stop in the neighboring tile should be found");
+  if (index.HasStopWithin(Reader(), ll, 1000.0f))
+    throw runtime_error("Stop in the neighboring tile is beyond 1000 meters");
+
+  // Clearing removes the stops
+  index.Clear();
+  if (index.HasStopWithin(Reader(), ll, 1500.0f))
+    throw runtime_error("Stops should be cleared");
+}
+
+}
+
+int main() {
+  test::suite suite("transit_stop_index");
+
+  // Test tiles without transit stops
+  suite.test(TEST_CASE(TestNoStops));
+
+  // Test the distance to a stop
+  suite.test(TEST_CASE(TestDistance));
+
+  // Test stops in neighboring tiles
+  suite.test(TEST_CASE(TestNeighborTile));
+
+  return suite.tear_down();
+}
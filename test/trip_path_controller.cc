@@ -10,7 +10,7 @@ namespace {
 
 void TryCtor() {
   TripPathController controller;
-  if (controller.attributes != TripPathController::kRouteAttributes)
+  if (controller.attributes() != TripPathController::kRouteAttributes)
     throw runtime_error("Incorrect Constructor using default route attributes");
 }
 
@@ -21,9 +21,9 @@ void TestCtor() {
 void TryArgCtor(const std::unordered_map<std::string, bool>& new_attributes,
                 size_t expected_size) {
   TripPathController controller(new_attributes);
-  if (controller.attributes != new_attributes)
+  if (controller.attributes() != new_attributes)
     throw runtime_error("Incorrect Constructor using argument attributes");
-  if (controller.attributes.size() != expected_size)
+  if (controller.attributes().size() != expected_size)
     throw runtime_error("Incorrect Constructor using argument attributes size");
 }
 
@@ -41,7 +41,7 @@ void TestArgCtor() {
 void TryEnableAll() {
   TripPathController controller;
   controller.enable_all();
-  for (auto& pair : controller.attributes) {
+  for (auto& pair : controller.attributes()) {
     // If any pair value is false then throw error
     if (!pair.second)
       throw runtime_error("Incorrect enable_all value for " + pair.first);
@@ -55,7 +55,7 @@ void TestEnableAll() {
 void TryDisableAll() {
   TripPathController controller;
   controller.disable_all();
-  for (auto& pair : controller.attributes) {
+  for (auto& pair : controller.attributes()) {
     // If any pair value is true then throw error
     if (pair.second)
       throw runtime_error("Incorrect disable_all value for " + pair.first);
@@ -92,15 +92,15 @@ void TestNodeAttributeEnabled() {
   TryCategoryAttributeEnabled(controller, kNodeCategory, false);
 
   // Test one node enabled
-  controller.attributes.at(kNodeType) = true;
+  controller.set_attribute(kNodeType, true);
   TryCategoryAttributeEnabled(controller, kNodeCategory, true);
 
   // Test some node enabled
-  controller.attributes.at(kNodeType) = false;
-  controller.attributes.at(kNodeIntersectingEdgeBeginHeading) = true;
-  controller.attributes.at(kNodeTransitStopInfoType) = true;
-  controller.attributes.at(kNodeElapsedTime) = true;
-  controller.attributes.at(kNodeFork) = true;
+  controller.set_attribute(kNodeType, false);
+  controller.set_attribute(kNodeIntersectingEdgeBeginHeading, true);
+  controller.set_attribute(kNodeTransitStopInfoType, true);
+  controller.set_attribute(kNodeElapsedTime, true);
+  controller.set_attribute(kNodeFork, true);
   TryCategoryAttributeEnabled(controller, kNodeCategory, true);
 }
 
@@ -119,17 +119,49 @@ void TestAdminAttributeEnabled() {
   TryCategoryAttributeEnabled(controller, kAdminCategory, false);
 
   // Test one admin enabled
-  controller.attributes.at(kAdminCountryCode) = true;
+  controller.set_attribute(kAdminCountryCode, true);
   TryCategoryAttributeEnabled(controller, kAdminCategory, true);
 
   // Test some admin enabled
-  controller.attributes.at(kAdminCountryCode) = false;
-  controller.attributes.at(kAdminCountryText) = true;
-  controller.attributes.at(kAdminStateCode) = false;
-  controller.attributes.at(kAdminStateText) = true;
+  controller.set_attribute(kAdminCountryCode, false);
+  controller.set_attribute(kAdminCountryText, true);
+  controller.set_attribute(kAdminStateCode, false);
+  controller.set_attribute(kAdminStateText, true);
   TryCategoryAttributeEnabled(controller, kAdminCategory, true);
 }
 
+void TestCompile() {
+  // Default route attributes are compiled on construction
+  TripPathController controller;
+  if (!controller.enabled(TripPathAttribute::kEdgeNames) ||
+      !controller.enabled(TripPathAttribute::kNodeaAdminIndex) ||
+      !controller.enabled(TripPathAttribute::kOsmChangeset))
+    throw runtime_error("Incorrect compiled default attributes");
+  if (!controller.category_enabled(TripPathCategory::kNode) ||
+      !controller.category_enabled(TripPathCategory::kAdmin))
+    throw runtime_error("Incorrect compiled default categories");
+
+  // Attributes missing from the map are disabled
+  TripPathController partial({{kEdgeLength, true}, {kAdminCountryCode, false}});
+  if (!partial.enabled(TripPathAttribute::kEdgeLength) ||
+      partial.enabled(TripPathAttribute::kEdgeNames) ||
+      partial.enabled(TripPathAttribute::kAdminCountryCode))
+    throw runtime_error("Incorrect compiled argument attributes");
+  if (partial.category_enabled(TripPathCategory::kNode) ||
+      partial.category_enabled(TripPathCategory::kAdmin))
+    throw runtime_error("Incorrect compiled argument categories");
+
+  // Changes to the attributes are compiled as they are set
+  controller.disable_all();
+  controller.set_attribute(kNodeElapsedTime, true);
+  if (!controller.enabled(TripPathAttribute::kNodeElapsedTime) ||
+      controller.enabled(TripPathAttribute::kEdgeNames))
+    throw runtime_error("Incorrect compiled attributes");
+  if (!controller.category_enabled(TripPathCategory::kNode) ||
+      controller.category_enabled(TripPathCategory::kAdmin))
+    throw runtime_error("Incorrect compiled categories");
+}
+
 }
 
 int main() {
@@ -153,5 +185,8 @@ int main() {
   // Test admin category_attribute_enabled
   suite.test(TEST_CASE(TestAdminAttributeEnabled));
 
+  // Test compile, enabled and category_enabled
+  suite.test(TEST_CASE(TestCompile));
+
   return suite.tear_down();
 }
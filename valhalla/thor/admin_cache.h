@@ -0,0 +1,134 @@
+#ifndef VALHALLA_THOR_ADMIN_CACHE_H_
+#define VALHALLA_THOR_ADMIN_CACHE_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+#include <valhalla/baldr/admininfo.h>
+#include <valhalla/baldr/graphtile.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default maximum number of tile admins kept before the cache is cleared
+constexpr size_t kDefaultAdminCacheSize = 65536;
+
+/**
+ * Admin record: the resolved strings of an admin with an Id of the distinct
+ * admin (admins with the same strings in different tiles share a record)
+ * and interned Ids of its country and state codes (equal codes have equal
+ * Ids).
+ */
+struct AdminRecord {
+  uint32_t id;
+  uint32_t country_code;
+  uint32_t state_code;
+  std::string country_text;
+  std::string state_text;
+  std::string country_iso;
+  std::string state_iso;
+};
+
+/**
+ * Cache of admin records keyed by tile and admin index, so admins are
+ * resolved and compared once rather than each time a trip path is built.
+ * Records stay valid until the cache is cleared. The cache is not thread
+ * safe: each worker has its own.
+ */
+class AdminCache {
+ public:
+  /**
+   * Constructor.
+   * @param  max_size  Maximum number of tile admins kept before the cache
+   *                   is over committed.
+   */
+  AdminCache(const size_t max_size = kDefaultAdminCacheSize);
+
+  /**
+   * Get the admin record of an admin index within a tile, resolving it if
+   * not in the cache.
+   * @param  tile         Graph tile.
+   * @param  admin_index  Admin index within the tile.
+   * @return Returns the admin record.
+   */
+  const AdminRecord* Get(const baldr::GraphTile* tile,
+                         const uint32_t admin_index);
+
+  /**
+   * Get an admin record, resolving the admin if not in the cache.
+   * @param  key      Cache key (see Key).
+   * @param  resolve  Resolves the admin info if not in the cache.
+   * @return Returns the admin record.
+   */
+  const AdminRecord* Get(const uint64_t key,
+                         const std::function<baldr::AdminInfo ()>& resolve);
+
+  /**
+   * Get the cache key of an admin within a tile.
+   * @param  tileid       Tile Id (value of the tile's base graph Id).
+   * @param  admin_index  Admin index within the tile.
+   * @return Returns the key.
+   */
+  static uint64_t Key(const uint64_t tileid, const uint32_t admin_index) {
+    return (tileid << 32) | admin_index;
+  }
+
+  /**
+   * Check if the cache holds more tile admins than its maximum size, in
+   * which case it should be cleared (when no records are in use).
+   * @return Returns true if over committed.
+   */
+  bool OverCommitted() const {
+    return index_.size() > max_size_;
+  }
+
+  /**
+   * Remove all records. Records previously returned are no longer valid.
+   */
+  void Clear();
+
+  /**
+   * Get the number of tile admins in the cache.
+   * @return Returns the number of tile admins.
+   */
+  size_t size() const {
+    return index_.size();
+  }
+
+  /**
+   * Get the number of distinct admins in the cache.
+   * @return Returns the number of admin records.
+   */
+  size_t admin_count() const {
+    return records_.size();
+  }
+
+ protected:
+  size_t max_size_;
+
+  // Records of the tile admins. Records are never moved so pointers to
+  // them stay valid.
+  std::unordered_map<uint64_t, const AdminRecord*> index_;
+  std::deque<AdminRecord> records_;
+  std::unordered_map<baldr::AdminInfo, uint32_t,
+                     baldr::AdminInfo::AdminInfoHasher> admins_;
+
+  // Interned country and state codes
+  std::unordered_map<std::string, uint32_t> codes_;
+
+  /**
+   * Get the interned Id of a country or state code.
+   * @param  code  Code.
+   * @return Returns the Id of the code.
+   */
+  uint32_t CodeId(const std::string& code);
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_ADMIN_CACHE_H_
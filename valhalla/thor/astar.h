@@ -97,6 +97,23 @@ class AStarPathAlgorithm : public PathAlgorithm {
   virtual void Init(const PointLL& origll, const PointLL& destll,
             const std::shared_ptr<sif::DynamicCost>& costing);
 
+  /**
+   * Get the cost of a directed edge at the origin or destination (the cost
+   * of the whole edge, which is scaled by the part of the edge traversed).
+   * Algorithms that cost edges differently (e.g. with traffic) override
+   * this so partial edges are costed like the edges they expand.
+   * @param  graphreader  Graph tile reader.
+   * @param  costing      Dynamic costing method.
+   * @param  edge         Directed edge.
+   * @param  edgeid       Directed edge Id.
+   * @param  origin       True for an origin edge, false for a destination edge.
+   * @return Returns the cost of the edge.
+   */
+  virtual sif::Cost LocationEdgeCost(baldr::GraphReader& graphreader,
+            const std::shared_ptr<sif::DynamicCost>& costing,
+            const baldr::DirectedEdge* edge, const baldr::GraphId& edgeid,
+            const bool origin);
+
   /**
    * Convenience method to add an edge to the adjacency list and temporarily
    * label it. This must be called before adding the edge label (so it uses
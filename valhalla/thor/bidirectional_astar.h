@@ -13,6 +13,7 @@
 #include <valhalla/thor/pathalgorithm.h>
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/traffic_speeds.h>
 
 namespace valhalla {
 namespace thor {
@@ -63,10 +64,35 @@ class BidirectionalAStar : public PathAlgorithm {
    */
   void Clear();
 
+  /**
+   * Set the real-time speed store. Edges with real-time speeds are costed
+   * at those speeds in both directions of the search.
+   * @param  speed_store  Speed store (nullptr disables traffic).
+   * @param  level        Hierarchy level of the speed tiles.
+   */
+  void set_speed_store(const std::shared_ptr<SpeedStore>& speed_store,
+                       const uint32_t level) {
+    traffic_.set_speed_store(speed_store, level);
+  }
+
+  /**
+   * Set the historical speed store. Paths whose origin has a date_time
+   * cost edges without a real-time speed at their historical speed for
+   * the departure hour (the time each edge is reached is not known).
+   * @param  historical_store  Historical speed store (nullptr disables
+   *                           historical speeds).
+   */
+  void set_historical_store(const std::shared_ptr<SpeedStore>& historical_store) {
+    traffic_.set_historical_store(historical_store);
+  }
+
  protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
 
+  // Real-time speeds
+  TrafficSpeeds traffic_;
+
   // Current travel mode
   sif::TravelMode mode_;
 
@@ -16,6 +16,8 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/traffic_speeds.h>
 
 namespace valhalla {
 namespace thor {
@@ -66,6 +68,8 @@ struct BestCandidate {
   sif::Cost cost;
   uint32_t distance;
   uint32_t threshold;
+  uint32_t source_label;    // Index of the source edge label at the connection
+  uint32_t target_label;    // Index of the target edge label at the connection
 
   BestCandidate(const baldr::GraphId& e1, baldr::GraphId& e2,
                       const sif::Cost& c, const uint32_t d)
@@ -74,15 +78,20 @@ struct BestCandidate {
         opp_edgeid(e2),
         cost(c),
         distance(d),
-        threshold(0) {
+        threshold(0),
+        source_label(0),
+        target_label(0) {
   }
 
   void Update(const baldr::GraphId& e1, baldr::GraphId& e2,
-              const sif::Cost& c, const uint32_t d) {
+              const sif::Cost& c, const uint32_t d,
+              const uint32_t source_idx, const uint32_t target_idx) {
     edgeid = e1;
     opp_edgeid = e2;
     cost = c;
     distance = d;
+    source_label = source_idx;
+    target_label = target_idx;
   }
 };
 
@@ -109,6 +118,10 @@ class CostMatrix {
    * @param  graphreader           Graph reader for accessing routing graph.
    * @param  costing               Costing methods.
    * @param  mode                  Travel mode to use.
+   * @param  max_matrix_time       Maximum time (seconds) of a result. Searches
+   *                               are pruned beyond this and pairs that are
+   *                               further apart are returned as not found.
+   * @param  max_matrix_distance   Maximum distance (meters) of a result.
    * @return time/distance from origin index to all other locations
    */
   std::vector<TimeDistance> SourceToTarget(
@@ -116,7 +129,22 @@ class CostMatrix {
           const std::vector<baldr::PathLocation>& target_location_list,
           baldr::GraphReader& graphreader,
           const std::shared_ptr<sif::DynamicCost>* mode_costing,
-          const sif::TravelMode mode);
+          const sif::TravelMode mode,
+          const float max_matrix_time = kMaxCost,
+          const float max_matrix_distance = kMaxCost);
+
+  /**
+   * Form the path from a source to a target using the forward and reverse
+   * search trees of the last SourceToTarget computation. The trees are kept
+   * until the next computation or until Clear is called, so a path between
+   * any pair with a connection can be formed without another search.
+   * @param  source  Source location index.
+   * @param  target  Target location index.
+   * @return Returns the path edges. This is empty if no connection was found
+   *         or if the source and target are the same location.
+   */
+  std::vector<PathInfo> FormPath(const uint32_t source,
+                                 const uint32_t target) const;
 
   /**
    * Clear the temporary information generated during time+distance
@@ -124,10 +152,24 @@ class CostMatrix {
    */
   void Clear();
 
+  /**
+   * Set the real-time speed store. Edges with real-time speeds are costed
+   * at those speeds by both the source and target searches.
+   * @param  speed_store  Speed store (nullptr disables traffic).
+   * @param  level        Hierarchy level of the speed tiles.
+   */
+  void set_speed_store(const std::shared_ptr<SpeedStore>& speed_store,
+                       const uint32_t level) {
+    traffic_.set_speed_store(speed_store, level);
+  }
+
  protected:
   // Access mode used by the costing method
   uint32_t access_mode_;
 
+  // Real-time speeds
+  TrafficSpeeds traffic_;
+
   // Current travel mode
   sif::TravelMode mode_;
 
@@ -143,6 +185,11 @@ class CostMatrix {
   // Cost threshold - stop searches when this is reached.
   float cost_threshold_;
 
+  // Time (seconds) and distance (meters) limits for this request. Labels
+  // beyond either limit are not expanded.
+  float max_time_;
+  float max_distance_;
+
   // Status
   std::vector<LocationStatus> source_status_;
   std::vector<LocationStatus> target_status_;
@@ -215,12 +262,14 @@ class CostMatrix {
   /**
    * Check if the edge on the forward search connects to a reached edge
    * on the reverse search tree.
-   * @param  source  Source index.
-   * @param  pred    Edge label of the predecessor.
-   * @param  n            Iteration counter.
+   * @param  source    Source index.
+   * @param  pred      Edge label of the predecessor.
+   * @param  pred_idx  Index of the predecessor in the source edge labels.
+   * @param  n         Iteration counter.
    */
   void CheckForwardConnections(const uint32_t source,
-                               const sif::EdgeLabel& pred, const uint32_t n);
+                               const sif::EdgeLabel& pred,
+                               const uint32_t pred_idx, const uint32_t n);
 
   /**
    * Update status when a connection is found.
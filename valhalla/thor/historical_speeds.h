@@ -0,0 +1,105 @@
+#ifndef VALHALLA_THOR_HISTORICAL_SPEEDS_H_
+#define VALHALLA_THOR_HISTORICAL_SPEEDS_H_
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <valhalla/thor/speed_store.h>
+
+namespace valhalla {
+namespace thor {
+
+// Number of historical speeds per edge (one for each hour of the week)
+constexpr uint32_t kHoursPerWeek = 168;
+
+// Profile index of an edge without historical speeds
+constexpr uint16_t kNoSpeedProfile = 0xffff;
+
+// Default step (kph) speeds are rounded to when encoding speed profiles
+constexpr uint32_t kDefaultSpeedQuantization = 2;
+
+/**
+ * Historical speeds (kph) of the directed edges of a tile for each hour of
+ * the week, read from a mapped historical speed file (<tileid>.hsp). Many
+ * edges have the same speed profile (e.g. free flowing roads or roads with
+ * the same commute pattern) so the file keeps a dictionary of distinct
+ * profiles and a 2 byte profile index per edge rather than 168 speeds per
+ * edge. The file is in native byte order:
+ *   uint32_t  profile count
+ *   uint32_t  edge count
+ *   uint8_t   profile count * 168 speeds (hour 0 is Sunday 00:00-01:00)
+ *   uint16_t  edge count profile indexes (kNoSpeedProfile if no speeds)
+ */
+class HistoricalSpeeds {
+ public:
+  /**
+   * Constructor for a tile without historical speeds.
+   */
+  HistoricalSpeeds();
+
+  /**
+   * Constructor.
+   * @param  tile  Mapped historical speed file. A file that is too short
+   *               for its counts has no speeds.
+   */
+  explicit HistoricalSpeeds(const std::shared_ptr<const SpeedTile>& tile);
+
+  /**
+   * Get the historical speed of a directed edge.
+   * @param  idx   Index of the directed edge within the tile.
+   * @param  hour  Hour of the week (see HourOfWeek).
+   * @return Returns the speed (kph) or 0 if there is no historical speed.
+   */
+  uint8_t speed(const uint32_t idx, const uint32_t hour) const {
+    if (idx >= edge_count_) {
+      return 0;
+    }
+    uint32_t profile = edge_profiles_[idx];
+    return (profile < profile_count_) ?
+        profiles_[profile * kHoursPerWeek + hour] : 0;
+  }
+
+  /**
+   * Get the number of distinct speed profiles.
+   * @return Returns the number of speed profiles.
+   */
+  uint32_t profile_count() const {
+    return profile_count_;
+  }
+
+  /**
+   * Get the hour of the week.
+   * @param  seconds  Seconds since the start of the week (Sunday 00:00).
+   *                  Times past the end of the week wrap to the next week.
+   * @return Returns the hour of the week (0 - 167).
+   */
+  static uint32_t HourOfWeek(const uint32_t seconds) {
+    return (seconds / 3600) % kHoursPerWeek;
+  }
+
+  /**
+   * Encode the historical speeds of a tile. Speeds are rounded to the
+   * quantization step so that similar profiles are shared.
+   * @param  edge_speeds   Speeds for each directed edge in the tile: 168
+   *                       speeds (kph) or none if the edge has no
+   *                       historical speeds.
+   * @param  quantization  Step (kph) speeds are rounded to.
+   * @return Returns the contents of the historical speed file.
+   */
+  static std::vector<uint8_t> Encode(
+          const std::vector<std::vector<uint8_t> >& edge_speeds,
+          const uint32_t quantization = kDefaultSpeedQuantization);
+
+ protected:
+  std::shared_ptr<const SpeedTile> tile_;
+  uint32_t profile_count_;
+  uint32_t edge_count_;
+  const uint8_t* profiles_;
+  const uint16_t* edge_profiles_;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_HISTORICAL_SPEEDS_H_
@@ -6,7 +6,9 @@
 #include <unordered_map>
 #include <utility>
 #include <memory>
+#include <string>
 
+#include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/gridded_data.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
@@ -15,10 +17,99 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/shape_cache.h>
+#include <valhalla/thor/transit_operators.h>
 
 namespace valhalla {
 namespace thor {
 
+// Default number of threads used to generate the contours of an isochrone
+constexpr uint32_t kDefaultContourThreads = 4;
+
+// Default maximum number of departures in the departure window of a
+// multi-modal isochrone profile
+constexpr uint32_t kDefaultMaxProfileDepartures = 60;
+
+// Default distance (meters) within which origins of an isochrone are searched
+// together when searching groups of origins in parallel
+constexpr float kDefaultOriginGroupDistance = 10000.0f;
+
+// Maximum number of edge labels of a search kept to resume it
+constexpr size_t kMaxResumeLabels = 2000000;
+
+/**
+ * Mark the time to reach each grid cell along an edge shape, where less than
+ * the time already in the cell. Times are interpolated along the shape from
+ * the time at the start to the time at the end of the edge, and each cell is
+ * marked with the time the shape enters it. Cells are found by walking the
+ * grid along each shape segment (a supercover DDA), so every cell a segment
+ * passes through is marked - including both cells where it crosses a corner.
+ * No memory is allocated other than to list the lowered cells.
+ * @param  isotile  Gridded data to mark (times in minutes).
+ * @param  shape    Edge shape.
+ * @param  forward  True if the edge direction is along the shape, false if the
+ *                  shape must be walked in reverse.
+ * @param  secs0    Time (seconds) at the start of the edge.
+ * @param  secs1    Time (seconds) at the end of the edge.
+ * @param  lowered  If not nullptr, the cells whose time is lowered are
+ *                  appended (a cell may be listed more than once).
+ */
+void RasterizeEdgeShape(GriddedData<midgard::PointLL>& isotile,
+                        const std::vector<midgard::PointLL>& shape,
+                        const bool forward, const float secs0,
+                        const float secs1,
+                        std::vector<uint32_t>* lowered = nullptr);
+
+/**
+ * Copy the reached cells of an isotile into another isotile with the same
+ * cell size whose grid is aligned with it and covers it, where less than the
+ * time already in the cell. Cells at or above the unreached time are not
+ * copied.
+ * @param  from       Isotile to copy (times in minutes).
+ * @param  unreached  Time (minutes) of the unreached cells of from.
+ * @param  to         Isotile to copy into.
+ */
+void CopyReachedCells(const GriddedData<midgard::PointLL>& from,
+                      const float unreached,
+                      GriddedData<midgard::PointLL>& to);
+
+/**
+ * Group origin locations for separate searches. Origins within the given
+ * distance of each other (directly or through other origins) are in the same
+ * group since their searches would mostly overlap.
+ * @param  origin_locations  List of origin locations.
+ * @param  distance          Distance (meters) within which origins are grouped.
+ * @return Returns the groups of origins, in the order of their first origin.
+ */
+std::vector<std::vector<baldr::PathLocation> > GroupOrigins(
+        const std::vector<baldr::PathLocation>& origin_locations,
+        const float distance);
+
+/**
+ * An edge reached by an isochrone search, in the direction of travel. The
+ * reached portion of the edge is from start_fraction to end_fraction along
+ * the edge. Times are in seconds at the start and end of the traversal of
+ * the edge (from the origins, or to the destinations for reverse searches)
+ * and may be beyond the maximum time when the edge is partially reached.
+ */
+struct ReachedEdge {
+  baldr::GraphId edgeid;
+  float start_secs;
+  float end_secs;
+  float start_fraction;
+  float end_fraction;
+};
+
+/**
+ * Isochrone grids over a window of departure times: the minimum, median and
+ * maximum time (minutes) to reach each grid point across the departures.
+ */
+struct IsochroneProfile {
+  std::shared_ptr<const GriddedData<midgard::PointLL> > minimum;
+  std::shared_ptr<const GriddedData<midgard::PointLL> > median;
+  std::shared_ptr<const GriddedData<midgard::PointLL> > maximum;
+};
+
 /**
  * Algorithm to generate an isochrone as a lat,lon grid with time taken to
  * each each grid point. This gridded data can then be contoured to create
@@ -51,13 +142,47 @@ class Isochrone {
    * @param  graphreader  Graphreader
    * @param  mode_costing List of costing objects
    * @param  mode         Travel mode
+   * @param  resume_key   Key identifying the origins and costing. If not
+   *                      empty the search state is kept after computing (until
+   *                      Clear is called) and a later computation with the
+   *                      same key and a greater or equal max_minutes resumes
+   *                      the search where it stopped, growing the isotile.
+   *                      The state is not kept once the search has more than
+   *                      kMaxResumeLabels edge labels.
    */
   std::shared_ptr<const GriddedData<midgard::PointLL> > Compute(
           std::vector<baldr::PathLocation>& origin_locs,
           const unsigned int max_minutes,
           baldr::GraphReader& graphreader,
           const std::shared_ptr<sif::DynamicCost>* mode_costing,
-          const sif::TravelMode mode);
+          const sif::TravelMode mode,
+          const std::string& resume_key = "");
+
+  /**
+   * Compute an isochrone grid from widely separated origins in parallel. The
+   * origins are grouped (see GroupOrigins) and each group is searched on its
+   * own thread. Each thread marks the edges it reached into its own isotile
+   * and the isotiles are merged, so the grid is the same as from Compute with
+   * all origins: each cell has the minimum time from any origin.
+   * @param  origin_locs     List of origin locations.
+   * @param  max_minutes     Maximum time (minutes) for largest contour
+   * @param  graphreaders    Graph reader for each thread (graph readers are
+   *                         not thread safe).
+   * @param  costings        Costing for the travel mode for each thread
+   *                         (costing is not shared between threads). The
+   *                         number of readers and costings is the maximum
+   *                         number of threads.
+   * @param  mode            Travel mode
+   * @param  group_distance  Distance (meters) within which origins are
+   *                         searched together.
+   */
+  std::shared_ptr<const GriddedData<midgard::PointLL> > ComputeParallel(
+          std::vector<baldr::PathLocation>& origin_locs,
+          const unsigned int max_minutes,
+          const std::vector<baldr::GraphReader*>& graphreaders,
+          const std::vector<std::shared_ptr<sif::DynamicCost> >& costings,
+          const sif::TravelMode mode,
+          const float group_distance = kDefaultOriginGroupDistance);
 
   // Compute iso-tile that we can use to generate isochrones. This is used for
   // the reverse direction - construct times for gridded data indicating how
@@ -69,6 +194,49 @@ class Isochrone {
                const std::shared_ptr<sif::DynamicCost>* mode_costing,
                const sif::TravelMode mode);
 
+  /**
+   * Get the edges reached by the last computation (Compute, ComputeReverse
+   * or ComputeMultiModal). Only settled edges are included, so the times
+   * are final: the computation should extend beyond max_minutes for edges
+   * reached near the maximum time to be settled. Transition edges and
+   * transit lines are excluded.
+   * @param  max_minutes  Maximum time (minutes) of the edges.
+   * @param  graphreader  Graphreader
+   * @return Returns the reached edges with their times and the portion
+   *         reached.
+   */
+  std::vector<ReachedEdge> ReachedEdges(const unsigned int max_minutes,
+                                        baldr::GraphReader& graphreader) const;
+
+  /**
+   * Set whether the isotile is formed when a computation ends. When only
+   * the reached edges are needed this skips forming the grid, in which case
+   * the computations return nullptr.
+   * @param  form  True to form the isotile (the default).
+   */
+  void set_form_isotile(const bool form) {
+    form_isotile_ = form;
+  }
+
+  /**
+   * Set the transit operator Ids to use (e.g. to share them with other
+   * algorithms).
+   * @param  transit_operators  Transit operator Ids.
+   */
+  void set_transit_operators(const std::shared_ptr<TransitOperators>& transit_operators) {
+    transit_operators_ = transit_operators;
+  }
+
+  /**
+   * Set the cache of decoded edge shapes to use when forming isotiles
+   * (e.g. to share it with the trip path builder). Without one, shapes are
+   * decoded each time they are needed.
+   * @param  shape_cache  Shape cache.
+   */
+  void set_shape_cache(const std::shared_ptr<ShapeCache>& shape_cache) {
+    shape_cache_ = shape_cache;
+  }
+
   /**
    * Compute an isochrone grid for multi-modal routes. This creates and
    * populates a lat,lon grid with time taken to reach each grid point.
@@ -88,8 +256,33 @@ class Isochrone {
                const std::shared_ptr<sif::DynamicCost>* mode_costing,
                const sif::TravelMode mode);
 
+  /**
+   * Compute isochrone grids for multi-modal routes over a window of departure
+   * times starting at the origin date time. Departures are searched from the
+   * latest to the earliest and each search only expands edges it reaches
+   * earlier (or with less walking, or in another mode or trip) than a later
+   * departure did, so work is reused between departure times. The minimum,
+   * median and maximum time to reach each grid point across the departures
+   * is returned. Forming the grids only compares the cells each departure
+   * changes rather than every cell for every departure.
+   * @param  origin_locations  List of origin locations.
+   * @param  max_minutes     Maximum time (minutes) for largest contour
+   * @param  window_minutes  Length (minutes) of the departure window.
+   * @param  step_minutes    Time (minutes) between departures in the window.
+   * @param  graphreader     Graphreader
+   * @param  mode_costing    List of costing objects
+   * @param  mode            Travel mode
+   */
+  IsochroneProfile ComputeMultiModalProfile(
+               std::vector<baldr::PathLocation>& origin_locations,
+               const unsigned int max_minutes,
+               const unsigned int window_minutes,
+               const unsigned int step_minutes,
+               baldr::GraphReader& graphreader,
+               const std::shared_ptr<sif::DynamicCost>* mode_costing,
+               const sif::TravelMode mode);
+
  protected:
-  float shape_interval_;        // Interval along shape to mark time
   sif::TravelMode mode_;        // Current travel mode
   uint32_t access_mode_;        // Access mode used by the costing method
   uint32_t tile_creation_date_; // Tile creation date
@@ -106,6 +299,75 @@ class Isochrone {
   // Isochrone gridded time data
   std::shared_ptr<GriddedData<midgard::PointLL> > isotile_;
 
+  // Edges marked during the search with the time at the start and end of
+  // each, and the origin (or destination) lat,lngs
+  struct MarkedEdge {
+    baldr::GraphId edgeid;
+    float secs0;
+    float secs1;
+  };
+  std::vector<MarkedEdge> marked_edges_;
+  std::vector<midgard::PointLL> origins_;
+
+  // Arrival at an edge from a departure in a departure window (seconds after
+  // the origin date time) with the state of the label that reached it: the
+  // travel mode, the transit trip (0 if not on a trip) and the walking
+  // distance so far. An arrival dominates another at the same edge with the
+  // same mode and trip if it is no later and has walked no further.
+  struct EdgeArrival {
+    float secs;
+    uint32_t walking_distance;
+    uint32_t tripid;
+    sif::TravelMode mode;
+  };
+  using EdgeArrivals = std::unordered_map<uint64_t, std::vector<EdgeArrival> >;
+
+  // Shapes of the marked edges (nullptr if the tile is not found), decoded
+  // once when the isotile is created and kept until the edges are marked
+  struct MarkedShape {
+    std::shared_ptr<const std::vector<midgard::PointLL> > shape;
+    bool forward;
+  };
+  std::vector<MarkedShape> marked_shapes_;
+
+  // State to resume the last search: key of the origins and costing, the
+  // maximum time (minutes) and the settled edge label that ended the search.
+  // To grow the isotile rather than mark all edges again: the bounds of the
+  // origins and the shapes of the edges in the isotile, the number of marked
+  // edges in it and those whose end time exceeds its initial time (so their
+  // cells beyond it are marked again).
+  std::string resume_key_;
+  unsigned int resume_minutes_;
+  uint32_t resume_label_;
+  midgard::AABB2<midgard::PointLL> resume_bounds_;
+  size_t resume_marked_;
+  std::vector<uint32_t> resume_capped_;
+
+  // Form the isotile when a computation ends
+  bool form_isotile_;
+
+  // The last computation searched in reverse (to destinations)
+  bool reverse_;
+
+  // Fraction along the edge of the location on each origin (or destination)
+  // edge label, by label index
+  std::unordered_map<uint32_t, float> location_fractions_;
+
+  // Transit operator Ids (kept across computations)
+  std::shared_ptr<TransitOperators> transit_operators_;
+
+  // Cache of decoded edge shapes (may be nullptr)
+  std::shared_ptr<ShapeCache> shape_cache_;
+
+  /**
+   * Get the decoded shape of a directed edge, from the shape cache if set.
+   * @param  tile  Graph tile of the directed edge.
+   * @param  edge  Directed edge.
+   * @return Returns the shape (in the direction of the edge info).
+   */
+  std::shared_ptr<const std::vector<midgard::PointLL> > EdgeShape(
+             const baldr::GraphTile* tile, const baldr::DirectedEdge* edge) const;
+
   /**
    * Initialize prior to computing the isocrhones. Creates adjacency list,
    * edgestatus support, and reserves edgelabels.
@@ -114,18 +376,75 @@ class Isochrone {
   void Initialize(const uint32_t bucketsize);
 
   /**
-   * Constructs the isotile - 2-D gridded data containing the time
-   * to get to each lat,lng tile.
-   * @param  mulitmodal  True if the route type is multimodal.
-   * @param  max_minutes Maximum time (minutes) for computing isochrones.
+   * Creates the isotile covering the origins and the edges marked during the
+   * search and decodes the shapes of the marked edges. Its cell size adapts
+   * to the reached area up to a maximum for the travel mode, and beyond it
+   * if the reached area would need too many cells at the maximum size.
+   * When growing the prior isotile of a resumed search, only the shapes of
+   * the edges marked since it was formed are decoded (marked_shapes_[i] is
+   * the shape of marked_edges_[resume_marked_ + i]). The prior cell size is
+   * kept unless the grid would then need too many cells, and the grid is
+   * aligned with the prior grid so its cells can be copied.
+   * @param  mulitmodal       True if the route type is multimodal.
+   * @param  initial_minutes  Initial time (minutes) of each grid cell.
+   * @param  graphreader      Graph reader
+   * @param  prior            Prior isotile to grow (may be nullptr).
+   */
+  void NewIsoTile(const bool multimodal, const float initial_minutes,
+                  baldr::GraphReader& graphreader,
+                  const GriddedData<midgard::PointLL>* prior = nullptr);
+
+  /**
+   * Forms the isotile - 2-D gridded data containing the time to get to each
+   * lat,lng tile - from the edges marked during the search. The grid covers
+   * the reached edges and its cell size adapts to the reached area.
+   * @param  mulitmodal   True if the route type is multimodal.
+   * @param  max_minutes  Maximum time (minutes) for computing isochrones.
+   * @param  graphreader  Graph reader
+   * @return Returns the isotile.
+   */
+  std::shared_ptr<const GriddedData<midgard::PointLL> > FormIsoTile(
+          const bool multimodal, const unsigned int max_minutes,
+          baldr::GraphReader& graphreader);
+
+  /**
+   * Grows the isotile of a resumed search. The reached cells of the prior
+   * isotile are copied into a grid covering all marked edges, so only the
+   * edges marked since (and those capped at the prior initial time) are
+   * marked. Forms the isotile from all marked edges if the cell size changes.
+   * @param  prior_minutes  Maximum time (minutes) of the prior isotile.
+   * @param  max_minutes    Maximum time (minutes) for computing isochrones.
+   * @param  graphreader    Graph reader
+   * @return Returns the isotile.
+   */
+  std::shared_ptr<const GriddedData<midgard::PointLL> > GrowIsoTile(
+          const unsigned int prior_minutes, const unsigned int max_minutes,
+          baldr::GraphReader& graphreader);
+
+  /**
+   * Expands the multi-modal search from the origin locations, marking the
+   * settled edges.
    * @param  origin_locations  List of origin locations.
+   * @param  max_minutes   Maximum time (minutes) for largest contour
+   * @param  graphreader   Graphreader
+   * @param  mode_costing  List of costing objects
+   * @param  mode          Travel mode
+   * @param  departure     Departure (seconds) after the origin date time.
+   * @param  arrivals      Arrivals at each edge from later departures. Edges
+   *                       reached by a dominating arrival are not expanded.
+   *                       Updated with the arrivals that are not dominated.
+   *                       May be nullptr.
    */
-  void ConstructIsoTile(const bool multimodal, const unsigned int max_minutes,
-                        std::vector<baldr::PathLocation>& origin_locations);
+  void ExpandMultiModal(std::vector<baldr::PathLocation>& origin_locations,
+                        const unsigned int max_minutes,
+                        baldr::GraphReader& graphreader,
+                        const std::shared_ptr<sif::DynamicCost>* mode_costing,
+                        const sif::TravelMode mode, const uint32_t departure,
+                        EdgeArrivals* arrivals);
 
   /**
-   * Updates the isotile using the edge information from the predecessor edge
-   * label. This is the edge being settled (lowest cost found to the edge).
+   * Marks the edge from the predecessor edge label to be added to the isotile.
+   * This is the edge being settled (lowest cost found to the edge).
    * @param  pred         Predecessor edge label (edge being settled).
    * @param  graphreader  Graph reader
    * @param  ll           Lat,lon at the end of the edge.
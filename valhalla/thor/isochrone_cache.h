@@ -0,0 +1,82 @@
+#ifndef VALHALLA_THOR_ISOCHRONE_CACHE_H_
+#define VALHALLA_THOR_ISOCHRONE_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <valhalla/midgard/gridded_data.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default number of isotiles kept in the cache
+constexpr uint32_t kDefaultIsochroneCacheSize = 16;
+
+/**
+ * Cache of computed isotiles (gridded times from a set of origins). An
+ * isotile computed to some maximum time can be contoured at any lesser time,
+ * so repeated requests from the same origins and costing with different
+ * contour times or colors only need to generate contours. Entries are
+ * evicted least recently used first.
+ */
+class IsochroneCache {
+ public:
+  /**
+   * Constructor.
+   * @param  max_size  Maximum number of isotiles to keep. 0 disables the
+   *                   cache.
+   */
+  IsochroneCache(const uint32_t max_size = kDefaultIsochroneCacheSize);
+
+  /**
+   * Find a cached isotile for the key that covers the specified time.
+   * @param  key          Key identifying the origins and costing.
+   * @param  max_minutes  Maximum time (minutes) the isotile must cover.
+   * @return Returns the isotile or nullptr if there is none that covers the
+   *         time.
+   */
+  std::shared_ptr<const GriddedData<midgard::PointLL> > Find(
+          const std::string& key, const unsigned int max_minutes);
+
+  /**
+   * Add an isotile to the cache. This replaces any isotile with the same key.
+   * @param  key          Key identifying the origins and costing.
+   * @param  max_minutes  Maximum time (minutes) covered by the isotile.
+   * @param  isotile      Isotile.
+   */
+  void Insert(const std::string& key, const unsigned int max_minutes,
+              const std::shared_ptr<const GriddedData<midgard::PointLL> >& isotile);
+
+  /**
+   * Remove all isotiles from the cache.
+   */
+  void Clear();
+
+  /**
+   * Get the number of isotiles in the cache.
+   * @return Returns the number of cached isotiles.
+   */
+  size_t size() const {
+    return entries_.size();
+  }
+
+ protected:
+  struct Entry {
+    std::string key;
+    unsigned int max_minutes;
+    std::shared_ptr<const GriddedData<midgard::PointLL> > isotile;
+  };
+
+  uint32_t max_size_;
+
+  // Cached isotiles, most recently used first
+  std::list<Entry> entries_;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_ISOCHRONE_CACHE_H_
@@ -0,0 +1,105 @@
+#ifndef VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
+#define VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <valhalla/thor/optimizer.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default number of threads (each runs its own search chain), wall-clock
+// time limit (milliseconds), iteration limit per chain and seed for the
+// local search optimizer. The search runs on the calling thread unless more
+// threads are configured.
+constexpr uint32_t kDefaultOptimizerThreads = 1;
+constexpr uint32_t kDefaultOptimizerTimeLimit = 500;
+constexpr uint32_t kDefaultOptimizerMaxIterations = 1000;
+constexpr uint64_t kDefaultOptimizerSeed = 111111;
+
+/**
+ * Optimization method using multi-start local search. Optimizes the order of
+ * locations - keeping the first location (origin) and last location
+ * (destination) fixed. Small tours are solved exactly (see ExactTour).
+ * Otherwise each thread runs an independent search chain with its own
+ * seeded random number generator: a random initial tour is improved with
+ * 2-opt (segment reversal) and Or-opt (moving up to 3 consecutive locations)
+ * moves until no improving move remains, then the best tour of the chain is
+ * perturbed and improved again. Chains restart from a new random tour when
+ * they stop improving. The best tour found by any chain (the lowest chain
+ * on ties) is returned when each chain reaches the iteration limit or the
+ * time limit.
+ *
+ * Seeded searches are deterministic for any number of threads: each chain
+ * runs to the iteration limit and the time limit is ignored (unless there is
+ * no iteration limit). Unseeded searches use kDefaultOptimizerSeed and also
+ * stop at the time limit, so their results are only repeatable when the
+ * iteration limit is reached first.
+ */
+class LocalSearchOptimizer {
+ public:
+  /**
+   * Constructor.
+   * @param  thread_count  Number of threads (search chains) to run.
+   * @param  time_limit    Wall-clock time limit in milliseconds.
+   */
+  LocalSearchOptimizer(const uint32_t thread_count = kDefaultOptimizerThreads,
+                       const uint32_t time_limit = kDefaultOptimizerTimeLimit);
+
+  /**
+   * Optimize the tour through a set of locations given the cost matrix
+   * among all locations. The first location (origin) and last location
+   * (destination) remain fixed in the tour.
+   * @param  count  Number of locations.
+   * @param  costs  2-D cost matrix.
+   * @return Returns the tour as an updated order of locations visited to
+   *         complete the tour.
+   */
+  std::vector<uint32_t> Solve(const uint32_t count,
+                              const std::vector<float>& costs);
+
+  /**
+   * Seed the random number generators. Chain i is seeded with seed + i.
+   * Defaults to kDefaultOptimizerSeed. Once seeded the search runs to the
+   * iteration limit, ignoring the time limit, so results are deterministic.
+   * @param  seed  Seed to use for the random number generators.
+   */
+  void Seed(const uint64_t seed) {
+    seed_ = seed;
+    seeded_ = true;
+  }
+
+  /**
+   * Set the maximum number of perturbation iterations for each chain
+   * (defaults to kDefaultOptimizerMaxIterations). Zero runs until the time
+   * limit is reached, even if seeded.
+   * @param  max_iterations  Maximum iterations per chain.
+   */
+  void set_max_iterations(const uint32_t max_iterations) {
+    max_iterations_ = max_iterations;
+  }
+
+  /**
+   * Set the maximum number of locations solved exactly rather than with
+   * local search. This is limited to kMaxExactCount.
+   * @param  count  Maximum number of locations to solve exactly.
+   */
+  void set_exact_max_count(const uint32_t count) {
+    exact_max_count_ = std::min(count, kMaxExactCount);
+  }
+
+ protected:
+  uint32_t thread_count_;    // Number of threads (search chains)
+  uint32_t time_limit_;      // Time limit in milliseconds
+  uint32_t max_iterations_;  // Maximum iterations per chain (0 = no limit)
+  uint64_t seed_;            // Seed for the first chain
+  bool seeded_;              // True if seeded (time limit is ignored)
+  uint32_t exact_max_count_; // Max number of locations solved exactly
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_LOCAL_SEARCH_OPTIMIZER_H_
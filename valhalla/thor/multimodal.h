@@ -18,6 +18,8 @@
 #include <valhalla/thor/edgestatus.h>
 #include <valhalla/thor/pathinfo.h>
 #include <valhalla/thor/astar.h>
+#include <valhalla/thor/transit_operators.h>
+#include <valhalla/thor/transit_stop_index.h>
 
 namespace valhalla {
 namespace thor {
@@ -54,10 +56,48 @@ class MultiModalPathAlgorithm : public AStarPathAlgorithm {
            const std::shared_ptr<sif::DynamicCost>* mode_costing,
            const sif::TravelMode mode);
 
+  /**
+   * Set the transit operator Ids to use (e.g. to share them with other
+   * algorithms).
+   * @param  transit_operators  Transit operator Ids.
+   */
+  void set_transit_operators(const std::shared_ptr<TransitOperators>& transit_operators) {
+    transit_operators_ = transit_operators;
+  }
+
+  /**
+   * Set the maximum walking distance at the start or end of a route: the
+   * pedestrian costing's transit_start_end_max_distance, or a bound on it.
+   * The costing limits the walk itself: this bounds the stops checked before
+   * walking. If 0 (the default) no stops are checked before walking.
+   * @param  distance  Maximum walking distance (meters).
+   */
+  void set_max_walking_distance(const uint32_t distance) {
+    max_walking_distance_ = distance;
+  }
+
+  /**
+   * Clear the transit stop index (e.g. when the graph reader's tiles are
+   * cleared).
+   */
+  void ClearTransitStops() {
+    stop_index_.Clear();
+  }
+
  protected:
   // Current walking distance.
   uint32_t walking_distance_;
 
+  // Maximum walking distance (meters) at the start or end of a route (0 if
+  // not known)
+  uint32_t max_walking_distance_;
+
+  // Transit operator Ids (kept across paths)
+  std::shared_ptr<TransitOperators> transit_operators_;
+
+  // Transit stops by tile (kept across paths)
+  TransitStopIndex stop_index_;
+
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
    * @param  origll  Lat,lng of the origin.
@@ -71,7 +111,8 @@ class MultiModalPathAlgorithm : public AStarPathAlgorithm {
    * Check if destination can be reached if walking is the last mode. Checks
    * if there are any transit stops within maximum walking distance from
    * the destination. This is used to reject impossible routes given the
-   * modes allowed.
+   * modes allowed. The transit stop index is checked first so there is no
+   * walk if no stop is near or a stop is very close.
    * TODO - once auto/bicycle are allowed modes we need to check if parking
    * or bikeshare locations are within walking distance.
    */
@@ -4,6 +4,7 @@
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <cstdint>
 
 namespace valhalla {
 namespace thor {
@@ -22,6 +23,12 @@ constexpr float kCoolingRate = 0.93f;
 //            a start and end location.
 enum AlterationType { kRotate, KReverse };
 
+// Tours with up to this many locations are solved exactly (Held-Karp)
+// rather than with simulated annealing. The exact solver's memory grows
+// as 2^count, so the configurable count is limited to kMaxExactCount.
+constexpr uint32_t kDefaultExactMaxCount = 12;
+constexpr uint32_t kMaxExactCount = 16;
+
 // Simple structure with 3 values describing a possible tour alteration
 struct TourAlteration {
   uint32_t start;     // Index of 1st location
@@ -30,6 +37,20 @@ struct TourAlteration {
   AlterationType alt; // Type of alteration
 };
 
+/**
+ * Exact tour optimization using the Held-Karp dynamic programming method.
+ * Finds the least cost order of locations (costs may be asymmetric) keeping
+ * the first location (origin) and last location (destination) fixed. Time
+ * is O(2^n * n^2) and memory O(2^n * n) with n = count - 2, so this should
+ * only be used for small counts (see kMaxExactCount).
+ * @param  count  Number of locations.
+ * @param  costs  2-D cost matrix.
+ * @return Returns the tour as an updated order of locations visited to
+ *         complete the tour.
+ */
+std::vector<uint32_t> ExactTour(const uint32_t count,
+                                const std::vector<float>& costs);
+
 /**
  * Optimization method using simulated annealing. Optimizes the order of
  * locations - keeping the first location (origin) and last location
@@ -41,7 +62,8 @@ public:
   /**
    * Optimize the tour through a set of locations given the cost matrix
    * among all locations. The first location (origin) and last location
-   * (destination) remain fixed in the tour.
+   * (destination) remain fixed in the tour. Tours with up to the exact
+   * max count locations are solved exactly.
    * @param  count  Number of locations.
    * @param  costs  2-D cost matrix.
    * @return Returns the tour as an updated order of locations visited to
@@ -59,11 +81,21 @@ public:
     random_generator_.seed(seed);
   }
 
+  /**
+   * Set the maximum number of locations solved exactly rather than with
+   * simulated annealing. This is limited to kMaxExactCount.
+   * @param  count  Maximum number of locations to solve exactly.
+   */
+  void set_exact_max_count(const uint32_t count) {
+    exact_max_count_ = std::min(count, kMaxExactCount);
+  }
+
 protected:
   // Random number generation: 0 <= r < 1
   std::mt19937_64 random_generator_;
   std::uniform_real_distribution<float> uniform_distribution_ { 0.0, 1.0 };
 
+  uint32_t exact_max_count_ = kDefaultExactMaxCount; // Max exact count
   uint32_t ntry_;                    // # of attempts (for debugging)
   uint32_t count_;                   // # of locations
   uint32_t attempts_;                // # of attempts per annealing cycle
@@ -72,6 +104,14 @@ protected:
   std::vector<uint32_t> tour_;       // Current tour (order of locations)
   std::vector<uint32_t> best_tour_;  // Best tour so far
 
+  // Prefix sums of the cost along the current tour. forward_costs_[i] is
+  // the cost from tour_[0] to tour_[i] and reverse_costs_[i] is the cost of
+  // traversing the same locations in reverse order. These allow the cost
+  // change of a reversal to be computed in constant time (costs may be
+  // asymmetric).
+  std::vector<double> forward_costs_;
+  std::vector<double> reverse_costs_;
+
   /*
    * Perform the annealing process.
    * @param  costs        2-D cost matrix.
@@ -96,6 +136,16 @@ protected:
   float TemperatureDifference(const std::vector<float>& costs,
                               const TourAlteration& alteration);
 
+  /**
+   * Update the forward and reverse prefix costs of the current tour from
+   * the specified tour index to the end of the tour. Prefix costs prior to
+   * this index are unchanged by an alteration that starts at the index.
+   * @param  costs  2-D cost matrix.
+   * @param  index  Tour index of the first altered location.
+   */
+  void UpdatePrefixCosts(const std::vector<float>& costs,
+                         const uint32_t index);
+
   /**
    * Create a random initial tour. The first and last locations must remain
    * fixed as the tour begin and end locations do not change.
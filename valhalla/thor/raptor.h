@@ -0,0 +1,294 @@
+#ifndef VALHALLA_THOR_RAPTOR_H_
+#define VALHALLA_THOR_RAPTOR_H_
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <memory>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/pathlocation.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/transit_operators.h>
+
+namespace valhalla {
+namespace thor {
+
+// Maximum number of rounds (transit trips taken) of a RAPTOR search
+constexpr uint32_t kMaxTransitRounds = 6;
+
+// Time (seconds) to transfer between trips at the same stop
+constexpr uint32_t kInStationTransferTime = 30;
+
+/**
+ * Round-based public transit routing (RAPTOR). Walking from the origin and
+ * to the destination (access and egress) is found with pedestrian searches
+ * to the transit stops. Each round then takes one more transit trip: from
+ * each stop reached earlier in the last round, board the next departure of
+ * each transit line and ride the trip along the following stops. Stops
+ * reached earlier are then extended by walking transfers to nearby stops.
+ * The transit part of the trip does not use an adjacency list or edge
+ * labels, so there is no limit on iterations and the number of transfers
+ * is bounded by the number of rounds.
+ *
+ * Each journey is compared by its arrival time plus a penalty for each
+ * transfer and for each change of transit operator between trips. Stops
+ * keep the earliest arrival in each round (as in RAPTOR), with the operator
+ * change penalties of the journey that reached them.
+ *
+ * The stop sequence and times of each trip (its timetable) are read from
+ * the transit tiles the first time the trip is boarded and kept until
+ * Clear, so rides do not look up departures. As in RAPTOR, trips along a
+ * transit line edge are assumed not to overtake each other: a departure
+ * along an edge after a trip already ridden along it in the round cannot
+ * reach any stop earlier, so it is not looked up.
+ */
+class RaptorPathAlgorithm : public PathAlgorithm {
+ public:
+  /**
+   * Constructor.
+   */
+  RaptorPathAlgorithm();
+
+  /**
+   * Destructor
+   */
+  virtual ~RaptorPathAlgorithm();
+
+  /**
+   * Form multi-modal (walking and transit) path between an origin and
+   * destination location. Selects the trip with the earliest arrival, with
+   * a penalty for each transfer.
+   * @param  origin  Origin location
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin (pedestrian).
+   * @return  Returns the path edges (and elapsed time/modes at end of
+   *          each edge).
+   */
+  std::vector<PathInfo> GetBestPath(baldr::PathLocation& origin,
+           baldr::PathLocation& dest, baldr::GraphReader& graphreader,
+           const std::shared_ptr<sif::DynamicCost>* mode_costing,
+           const sif::TravelMode mode);
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear();
+
+  /**
+   * Set the transit operator Ids to use (e.g. to share them with other
+   * algorithms).
+   * @param  transit_operators  Transit operator Ids.
+   */
+  void set_transit_operators(const std::shared_ptr<TransitOperators>& transit_operators) {
+    transit_operators_ = transit_operators;
+  }
+
+ protected:
+  // Pedestrian search tree. Keeps the edge label that reached each transit
+  // stop (stops are not walked through) and the label that reached the
+  // destination (kInvalidLabel if not reached).
+  struct WalkTree {
+    std::vector<sif::EdgeLabel> edgelabels;
+    std::unordered_map<uint64_t, uint32_t> stops;
+    uint32_t destination;
+    float destination_secs;
+  };
+
+  // Walking transfer from a stop to another stop, with the edges walked and
+  // the time (seconds) to the end of each.
+  struct Footpath {
+    baldr::GraphId stop;
+    uint32_t secs;
+    std::vector<std::pair<baldr::GraphId, uint32_t> > edges;
+  };
+
+  // Transit line edge along a trip with the departure along it and the
+  // arrival at the stop at its end (seconds from midnight).
+  struct TripEdge {
+    baldr::GraphId edgeid;
+    baldr::GraphId stop;
+    uint32_t departure;
+    uint32_t arrival;
+  };
+
+  // Transit line edge ridden along a trip with the arrival time (seconds from
+  // midnight) at its end and the index of the prior edge ridden on the trip
+  // (kInvalidLabel at the boarding stop).
+  struct RideEdge {
+    baldr::GraphId edgeid;
+    uint32_t tripid;
+    uint32_t arrival;
+    uint32_t prior;
+  };
+
+  // Arrival (seconds from midnight) at a stop in a round. From the stop where
+  // the trip was boarded (the last ride edge is the index into rides_) or
+  // the stop walked from (the index is into its footpaths). Stops reached
+  // from the origin have an invalid from stop and the index of the access
+  // edge label. Also the operator Id of the last trip ridden (0 if none)
+  // and the operator change penalties of the journey to the stop.
+  struct StopLabel {
+    uint32_t arrival;
+    baldr::GraphId from_stop;
+    uint32_t index;
+    uint32_t operator_id;
+    float penalty;
+  };
+
+  // Stops reached in a round by riding and by walking
+  struct Round {
+    std::unordered_map<uint64_t, StopLabel> rides;
+    std::unordered_map<uint64_t, StopLabel> walks;
+  };
+
+  // Best journey found: the round and stop to walk from to the destination
+  // and whether the stop was reached by riding.
+  struct Journey {
+    uint32_t round;
+    baldr::GraphId stop;
+    bool by_ride;
+  };
+
+  WalkTree access_;                // Walking from the origin
+  WalkTree egress_;                // Walking (in reverse) from the destination
+  std::vector<Round> rounds_;      // Stops reached in each round
+  std::vector<RideEdge> rides_;    // Transit line edges ridden
+  std::unordered_map<uint64_t, uint32_t> best_;   // Earliest arrival at each stop
+  std::unordered_map<uint64_t, std::vector<Footpath> > footpaths_;
+  std::unordered_map<uint32_t, std::vector<TripEdge> > trips_;  // Timetables by trip Id
+
+  // Transit operator Ids (kept across paths)
+  std::shared_ptr<TransitOperators> transit_operators_;
+
+  // Schedule lookup: day since the transit tile creation, day of week mask,
+  // and whether the date is before the tile creation date
+  bool date_set_;
+  uint32_t day_;
+  uint32_t dow_;
+  bool date_before_tile_;
+
+  /**
+   * Walk from the seed edge labels in the walk tree until no edge can be
+   * expanded, recording the transit stops reached.
+   * @param  graphreader   Graph reader
+   * @param  costing       Pedestrian costing
+   * @param  max_distance  Maximum walking distance (meters).
+   * @param  walk          Walk tree with the seed edge labels.
+   * @param  destinations  Destination edges with the cost of the remainder
+   *                       of each edge past the destination. May be nullptr.
+   */
+  void Walk(baldr::GraphReader& graphreader,
+            const std::shared_ptr<sif::DynamicCost>& costing,
+            const uint32_t max_distance, WalkTree& walk,
+            const std::unordered_map<uint64_t, sif::Cost>* destinations);
+
+  /**
+   * Get the walking transfers from a stop to nearby stops. These are found
+   * the first time they are needed for a stop and kept until Clear.
+   * @param  graphreader   Graph reader
+   * @param  stop          Stop to walk from.
+   * @param  costing       Pedestrian costing
+   * @param  max_distance  Maximum transfer walking distance (meters).
+   * @return Returns the walking transfers from the stop.
+   */
+  const std::vector<Footpath>& Footpaths(baldr::GraphReader& graphreader,
+            const baldr::GraphId& stop,
+            const std::shared_ptr<sif::DynamicCost>& costing,
+            const uint32_t max_distance);
+
+  /**
+   * Get the timetable of the trip of a departure from the transit line edge
+   * onwards. The timetable is read from the transit tiles, following the
+   * trip along the subsequent stops, if the trip has not been boarded at
+   * the edge before.
+   * @param  graphreader  Graph reader
+   * @param  edgeid       Transit line edge the trip departs along.
+   * @param  departure    Departure along the transit line edge.
+   * @param  wheelchair   Departures must be wheelchair accessible.
+   * @param  bicycle      Departures must allow bicycles.
+   * @return Returns the timetable of the trip and the index of the edge in it.
+   */
+  std::pair<const std::vector<TripEdge>*, uint32_t> Timetable(
+            baldr::GraphReader& graphreader, const baldr::GraphId& edgeid,
+            const baldr::TransitDeparture* departure, const bool wheelchair,
+            const bool bicycle);
+
+  /**
+   * Ride a trip from the departure along a transit line edge at the boarding
+   * stop, following the trip along the subsequent stops. Updates the stops
+   * reached earlier in the round.
+   * @param  graphreader  Graph reader
+   * @param  board_stop   Stop where the trip is boarded.
+   * @param  edgeid       Transit line edge the trip departs along.
+   * @param  departure    Departure along the transit line edge.
+   * @param  latest       Rides are not followed beyond this time.
+   * @param  wheelchair   Departure must be wheelchair accessible.
+   * @param  bicycle      Departure must allow bicycles.
+   * @param  operator_id  Operator Id of the trip.
+   * @param  penalty      Operator change penalties of the journey boarding
+   *                      the trip.
+   * @param  round        Round to update.
+   * @param  departed     Earliest departure ridden along each transit line
+   *                      edge in the round. A trip is not ridden on along an
+   *                      edge where an earlier (or the same) trip departed.
+   * @param  improved     Stops reached earlier in the round.
+   */
+  void Ride(baldr::GraphReader& graphreader, const baldr::GraphId& board_stop,
+            const baldr::GraphId& edgeid, const baldr::TransitDeparture* departure,
+            const uint32_t latest, const bool wheelchair, const bool bicycle,
+            const uint32_t operator_id, const float penalty,
+            Round& round, std::unordered_map<uint64_t, uint32_t>& departed,
+            std::vector<baldr::GraphId>& improved);
+
+  /**
+   * Check if a stop in a round is boarded after riding to it (with an in
+   * station transfer) rather than after walking to it.
+   * @param  round  Round in which the stop was reached.
+   * @param  stop   Stop.
+   * @return Returns true if boarding after riding to the stop.
+   */
+  bool BoardAfterRide(const Round& round, const uint64_t stop) const;
+
+  /**
+   * Get the operator change penalties of a journey boarding a trip from a
+   * stop: those of the journey to the stop plus the operator change penalty
+   * if the last trip ridden was of a different operator.
+   * @param  from         Label of the stop the trip is boarded from.
+   * @param  operator_id  Operator Id of the trip.
+   * @return Returns the operator change penalties.
+   */
+  static float BoardingPenalty(const StopLabel& from, const uint32_t operator_id);
+
+  /**
+   * Form the path of the journey. The last edge of each walk to a stop ends
+   * at the arrival the stop is boarded from, which includes the time to
+   * enter the stop or transfer.
+   * @param  graphreader  Graph reader
+   * @param  journey      Best journey.
+   * @param  start_time   Start time (seconds from midnight).
+   * @return Returns the path edges.
+   */
+  std::vector<PathInfo> FormPath(baldr::GraphReader& graphreader,
+                                 const Journey& journey,
+                                 const uint32_t start_time);
+
+  /**
+   * Form the path walking from the origin to the destination.
+   * @param  graphreader  Graph reader
+   * @return Returns the path edges.
+   */
+  std::vector<PathInfo> FormWalkingPath(baldr::GraphReader& graphreader) const;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_RAPTOR_H_
@@ -5,6 +5,7 @@
 
 #include <prime_server/prime_server.hpp>
 #include <prime_server/http_protocol.hpp>
+#include <google/protobuf/arena.h>
 
 #include <valhalla/baldr/pathlocation.h>
 #include <valhalla/baldr/graphreader.h>
@@ -18,9 +19,14 @@
 #include <valhalla/thor/bidirectional_astar.h>
 #include <valhalla/thor/astar.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/raptor.h>
+#include <valhalla/thor/trafficalgorithm.h>
+#include <valhalla/thor/shape_cache.h>
+#include <valhalla/thor/admin_cache.h>
 #include <valhalla/thor/trippathbuilder.h>
 #include <valhalla/thor/trip_path_controller.h>
 #include <valhalla/thor/isochrone.h>
+#include <valhalla/thor/isochrone_cache.h>
 #include <valhalla/meili/map_matcher_factory.h>
 
 
@@ -29,6 +35,11 @@ namespace thor {
 
 void run_service(const boost::property_tree::ptree& config);
 
+// Default size of the worker owned first block of the trip path arena and
+// the default maximum size of the blocks the arena allocates beyond it
+constexpr size_t kDefaultArenaInitialBlockSize = 1 << 20;
+constexpr size_t kDefaultArenaMaxBlockSize = 1 << 18;
+
 class thor_worker_t {
  public:
   enum ACTION_TYPE {
@@ -54,6 +65,14 @@ class thor_worker_t {
     COST_MATRIX = 1,
     TIME_DISTANCE_MATRIX = 2
   };
+  enum OPTIMIZER_ALGORITHM {
+    LOCAL_SEARCH = 0,
+    SIMULATED_ANNEALING = 1
+  };
+  enum TRANSIT_ALGORITHM {
+    MULTIMODAL_ASTAR = 0,
+    RAPTOR = 1
+  };
   static const std::unordered_map<std::string, SHAPE_MATCH> STRING_TO_MATCH;
   thor_worker_t(const boost::property_tree::ptree& config);
   virtual ~thor_worker_t();
@@ -70,22 +89,24 @@ class thor_worker_t {
   void get_path(PathAlgorithm* path_algorithm, baldr::PathLocation& origin,
                 baldr::PathLocation& destination,
                 std::vector<thor::PathInfo>& path_edges);
-  void log_admin(odin::TripPath&);
+  void log_admin(const std::vector<const AdminRecord*>& admins);
   valhalla::sif::cost_ptr_t get_costing(
       const boost::property_tree::ptree& request, const std::string& costing);
   thor::PathAlgorithm* get_path_algorithm(
       const std::string& routetype, const baldr::PathLocation& origin,
       const baldr::PathLocation& destination);
-  valhalla::odin::TripPath route_match(const TripPathController& controller);
-  valhalla::odin::TripPath map_match(const TripPathController& controller);
+  valhalla::odin::TripPath* new_trip_path();
+  valhalla::odin::TripPath* route_match(const TripPathController& controller);
+  valhalla::odin::TripPath* map_match(const TripPathController& controller);
 
-  std::list<valhalla::odin::TripPath> path_arrive_by(
+  std::list<valhalla::odin::TripPath*> path_arrive_by(
       std::vector<baldr::PathLocation>& correlated, const std::string &costing,
       const std::string &request_str);
-  std::list<valhalla::odin::TripPath> path_depart_at(
+  std::list<valhalla::odin::TripPath*> path_depart_at(
       std::vector<baldr::PathLocation>& correlated, const std::string &costing,
       const boost::optional<int> &date_time_type,
-      const std::string &request_str);
+      const std::string &request_str,
+      const std::vector<std::vector<thor::PathInfo>>& leg_paths = {});
 
   void parse_locations(const boost::property_tree::ptree& request);
   void parse_shape(const boost::property_tree::ptree& request);
@@ -128,9 +149,41 @@ class thor_worker_t {
   AStarPathAlgorithm astar;
   BidirectionalAStar bidir_astar;
   MultiModalPathAlgorithm multi_modal_astar;
+  RaptorPathAlgorithm raptor;
+  TrafficAlgorithm traffic_astar;
+  std::shared_ptr<TransitOperators> transit_operators;
+  std::shared_ptr<SpeedStore> speed_store;
+  uint32_t speed_level;
+  std::shared_ptr<ShapeCache> shape_cache;
+  uint32_t shape_cache_report_interval;
+  uint64_t shape_cache_requests;
+  // Trip paths (and, with protobuf 3.14 or later, all their sub-messages)
+  // are allocated on the arena, which is reset after each request. The first
+  // block is owned by the worker so it is reused rather than freed when the
+  // arena is reset.
+  std::vector<char> arena_block;
+  google::protobuf::Arena arena;
+  // Admin records across requests and the admins of the last trip path built
+  AdminCache admin_cache;
+  std::vector<const AdminRecord*> trip_admins;
   Isochrone isochrone_gen;
+  IsochroneCache isochrone_cache;
+  bool isochrone_resume;
+  uint32_t isochrone_contour_threads;
+  uint32_t isochrone_max_profile_departures;
+  float isochrone_origin_group_distance;
+  std::vector<std::shared_ptr<baldr::GraphReader> > isochrone_readers;
   float long_request;
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
+  OPTIMIZER_ALGORITHM optimizer_algorithm;
+  TRANSIT_ALGORITHM transit_algorithm;
+  uint32_t transit_max_walking_distance;
+  uint32_t optimizer_threads;
+  uint32_t optimizer_time_limit;
+  uint32_t optimizer_max_iterations;
+  boost::optional<uint64_t> optimizer_seed;
+  uint32_t optimizer_exact_max_count;
+  std::string optimizer_record_dir;
   boost::optional<int> date_time_type;
   valhalla::meili::MapMatcherFactory matcher_factory;
   std::unordered_set<std::string> trace_customizable;
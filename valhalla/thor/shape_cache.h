@@ -0,0 +1,128 @@
+#ifndef VALHALLA_THOR_SHAPE_CACHE_H_
+#define VALHALLA_THOR_SHAPE_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+#include <valhalla/baldr/graphtile.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default maximum memory (bytes) used by decoded shapes in the shape cache
+constexpr size_t kDefaultShapeCacheSize = 64 * 1024 * 1024;
+
+// Default number of requests between reports of the shape cache use
+constexpr uint32_t kDefaultShapeCacheReportInterval = 1000;
+
+/**
+ * Cache of decoded edge shapes, keyed by tile and edge info offset (both
+ * directions of an edge share the same shape). Shapes are shared and
+ * immutable: a shape stays valid while it is in use even if it is evicted.
+ * Shapes are kept until the memory they use exceeds the maximum size,
+ * evicting the least recently used first. The cache is safe to share across
+ * threads.
+ */
+class ShapeCache {
+ public:
+  using Shape = std::vector<midgard::PointLL>;
+
+  /**
+   * Constructor.
+   * @param  max_size  Maximum memory (bytes) used by the decoded shapes.
+   */
+  ShapeCache(const size_t max_size = kDefaultShapeCacheSize);
+
+  /**
+   * Get the decoded shape of an edge, decoding it if not in the cache.
+   * @param  tile             Graph tile of the edge.
+   * @param  edgeinfo_offset  Edge info offset of the directed edge.
+   * @return Returns the shape (in the direction of the edge info).
+   */
+  std::shared_ptr<const Shape> Get(const baldr::GraphTile* tile,
+                                   const uint32_t edgeinfo_offset);
+
+  /**
+   * Get a decoded shape, decoding it if not in the cache.
+   * @param  key     Cache key (see Key).
+   * @param  decode  Decodes the shape if not in the cache.
+   * @return Returns the shape.
+   */
+  std::shared_ptr<const Shape> Get(const uint64_t key,
+                                   const std::function<Shape ()>& decode);
+
+  /**
+   * Get the cache key of an edge shape.
+   * @param  tileid           Tile Id (value of the tile's base graph Id).
+   * @param  edgeinfo_offset  Edge info offset.
+   * @return Returns the key.
+   */
+  static uint64_t Key(const uint64_t tileid, const uint32_t edgeinfo_offset) {
+    return (tileid << 32) | edgeinfo_offset;
+  }
+
+  /**
+   * Remove all shapes from the cache. Hit and miss counts are kept.
+   */
+  void Clear();
+
+  /**
+   * Get the number of shapes in the cache.
+   * @return Returns the number of shapes.
+   */
+  size_t size() const;
+
+  /**
+   * Get the memory (bytes) used by the shapes in the cache.
+   * @return Returns the memory used.
+   */
+  size_t memory() const;
+
+  /**
+   * Get the number of shapes found in the cache.
+   * @return Returns the number of hits.
+   */
+  uint64_t hits() const;
+
+  /**
+   * Get the number of shapes decoded (not found in the cache).
+   * @return Returns the number of misses.
+   */
+  uint64_t misses() const;
+
+  /**
+   * Describe the cache use: number of shapes, memory, hits, misses and hit
+   * rate.
+   * @return Returns the report.
+   */
+  std::string Report() const;
+
+ protected:
+  struct Entry {
+    uint64_t key;
+    size_t memory;
+    std::shared_ptr<const Shape> shape;
+  };
+
+  size_t max_size_;
+  size_t memory_;
+  uint64_t hits_;
+  uint64_t misses_;
+
+  // Shapes, most recently used first, and the shapes by key
+  mutable std::mutex mutex_;
+  std::list<Entry> entries_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_SHAPE_CACHE_H_
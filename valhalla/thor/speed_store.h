@@ -0,0 +1,178 @@
+#ifndef VALHALLA_THOR_SPEED_STORE_H_
+#define VALHALLA_THOR_SPEED_STORE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+#include <ctime>
+#include <sys/types.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default number of speed tiles kept mapped
+constexpr uint32_t kDefaultMaxSpeedTiles = 1024;
+
+// Default interval (seconds) between checks of a speed file for updates
+constexpr uint32_t kDefaultSpeedReloadInterval = 60;
+
+/**
+ * Real-time speeds (kph, 0 if no speed) of the directed edges of a tile,
+ * memory mapped read-only from a speed file. Mapped pages are shared with
+ * every process mapping the same file. The file is unmapped when the speed
+ * tile is destroyed, so a speed tile stays valid while it is in use even if
+ * the file is replaced or the tile is evicted from the store.
+ */
+class SpeedTile {
+ public:
+  /**
+   * Constructor. Maps the speed file.
+   * @param  fd    Open file descriptor of the speed file.
+   * @param  size  Size of the file (bytes). Must be greater than 0.
+   */
+  SpeedTile(const int fd, const size_t size);
+
+  /**
+   * Destructor. Unmaps the speed file.
+   */
+  ~SpeedTile();
+
+  SpeedTile(const SpeedTile&) = delete;
+  SpeedTile& operator=(const SpeedTile&) = delete;
+
+  /**
+   * Get the real-time speed of a directed edge.
+   * @param  idx  Index of the directed edge within the tile.
+   * @return Returns the speed (kph) or 0 if there is no real-time speed.
+   */
+  uint8_t speed(const uint32_t idx) const {
+    return (idx < size_) ? speeds_[idx] : 0;
+  }
+
+  /**
+   * Get the number of speeds in the tile.
+   * @return Returns the number of speeds.
+   */
+  size_t size() const {
+    return size_;
+  }
+
+  /**
+   * Get the mapped speed file contents.
+   * @return Returns the start of the speed file.
+   */
+  const uint8_t* data() const {
+    return speeds_;
+  }
+
+ protected:
+  const uint8_t* speeds_;
+  size_t size_;
+};
+
+/**
+ * Store of memory mapped real-time speed tiles (<tileid>.spd files in the
+ * traffic directory, or another file extension such as historical speeds).
+ * Speed files are checked for updates (with stat) at most once per reload
+ * interval and are mapped again when the file has been modified or
+ * replaced. Speed files should be updated by writing a new file and renaming
+ * it over the old one so a speed file is never read partially written.
+ * At most the maximum number of tiles are kept mapped, evicting the least
+ * recently used first. The store is safe to share across threads.
+ */
+class SpeedStore {
+ public:
+  /**
+   * Constructor.
+   * @param  traffic_dir      Directory with the speed files.
+   * @param  max_tiles        Maximum number of speed tiles kept mapped.
+   * @param  reload_interval  Interval (seconds) between checks of a speed
+   *                          file for updates. 0 checks on every Get.
+   * @param  extension        File extension of the speed files.
+   */
+  SpeedStore(const std::string& traffic_dir,
+             const uint32_t max_tiles = kDefaultMaxSpeedTiles,
+             const uint32_t reload_interval = kDefaultSpeedReloadInterval,
+             const std::string& extension = ".spd");
+
+  /**
+   * Get the real-time speeds of a tile, mapping the speed file if not yet
+   * mapped or if it has been updated.
+   * @param  tileid  Tile Id.
+   * @return Returns the speed tile or nullptr if the tile has no speeds.
+   */
+  std::shared_ptr<const SpeedTile> Get(const uint32_t tileid);
+
+  /**
+   * Remove all speed tiles from the store.
+   */
+  void Clear();
+
+  /**
+   * Get the number of tiles in the store (including tiles without speeds).
+   * @return Returns the number of tiles.
+   */
+  size_t size() const;
+
+ protected:
+  // Speed file identity. A file renamed over the speed file has a different
+  // inode, an updated file has a different modification time or size.
+  struct FileId {
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    off_t size;
+    bool operator==(const FileId& other) const {
+      return dev == other.dev && ino == other.ino &&
+             mtime == other.mtime && size == other.size;
+    }
+  };
+
+  struct Entry {
+    uint32_t tileid;
+    FileId file;
+    std::chrono::steady_clock::time_point checked;
+    std::shared_ptr<const SpeedTile> speeds;
+  };
+
+  std::string traffic_dir_;
+  std::string extension_;
+  uint32_t max_tiles_;
+  std::chrono::seconds reload_interval_;
+
+  // Tiles, most recently used first, and the tiles by Id
+  mutable std::mutex mutex_;
+  std::list<Entry> entries_;
+  std::unordered_map<uint32_t, std::list<Entry>::iterator> index_;
+
+  /**
+   * Get the name of the speed file of a tile.
+   * @param  tileid  Tile Id.
+   * @return Returns the file name.
+   */
+  std::string FileName(const uint32_t tileid) const;
+
+  /**
+   * Get the identity of the speed file of a tile without opening it.
+   * @param  tileid  Tile Id.
+   * @return Returns the identity (all 0 if there is no speed file).
+   */
+  FileId Stat(const uint32_t tileid) const;
+
+  /**
+   * Map the speed file of a tile.
+   * @param  tileid  Tile Id.
+   * @param  file    Returns the identity of the file mapped.
+   * @return Returns the speed tile or nullptr if there is no speed file.
+   */
+  std::shared_ptr<const SpeedTile> Map(const uint32_t tileid, FileId& file) const;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_SPEED_STORE_H_
@@ -17,6 +17,7 @@
 #include <valhalla/thor/pathalgorithm.h>
 #include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/astar.h>
+#include <valhalla/thor/traffic_speeds.h>
 
 namespace valhalla {
 namespace thor {
@@ -64,13 +65,21 @@ class TimeDistanceMatrix {
    * @param  graphreader   Graph reader for accessing routing graph.
    * @param  costing       Costing methods.
    * @param  mode          Travel mode to use.
+   * @param  max_matrix_time      Maximum time (seconds) of a result.
+   * @param  max_matrix_distance  Maximum distance (meters) of a result.
+   * @param  k_nearest     If non-zero, only the k nearest locations are
+   *                       found. The search stops once they are settled and
+   *                       all other locations are returned as not found.
    * @return time/distance from origin index to all other locations
    */
   std::vector<TimeDistance> OneToMany(const baldr::PathLocation& origin,
           const std::vector<baldr::PathLocation>& locations,
           baldr::GraphReader& graphreader,
           const std::shared_ptr<sif::DynamicCost>* mode_costing,
-          const sif::TravelMode mode);
+          const sif::TravelMode mode,
+          const float max_matrix_time = kMaxCost,
+          const float max_matrix_distance = kMaxCost,
+          const uint32_t k_nearest = 0);
 
   /**
    * Many to one time and distance cost matrix. Computes time and distance
@@ -80,13 +89,21 @@ class TimeDistanceMatrix {
    * @param  graphreader   Graph reader for accessing routing graph.
    * @param  costing       Costing methods.
    * @param  mode          Travel mode to use.
+   * @param  max_matrix_time      Maximum time (seconds) of a result.
+   * @param  max_matrix_distance  Maximum distance (meters) of a result.
+   * @param  k_nearest     If non-zero, only the k nearest locations are
+   *                       found. The search stops once they are settled and
+   *                       all other locations are returned as not found.
    * @return time/distance to the destination index from all other locations
    */
   std::vector<TimeDistance> ManyToOne(const baldr::PathLocation& dest,
           const std::vector<baldr::PathLocation>& locations,
           baldr::GraphReader& graphreader,
           const std::shared_ptr<sif::DynamicCost>* mode_costing,
-          const sif::TravelMode mode);
+          const sif::TravelMode mode,
+          const float max_matrix_time = kMaxCost,
+          const float max_matrix_distance = kMaxCost,
+          const uint32_t k_nearest = 0);
 
   /**
    * Many to many time and distance cost matrix. Computes time and distance
@@ -95,13 +112,17 @@ class TimeDistanceMatrix {
    * @param  graphreader   Graph reader for accessing routing graph.
    * @param  costing       Costing methods.
    * @param  mode          Travel mode to use.
+   * @param  max_matrix_time      Maximum time (seconds) of a result.
+   * @param  max_matrix_distance  Maximum distance (meters) of a result.
    * @return time/distance between all pairs of locations
    */
   std::vector<TimeDistance> ManyToMany(
           const std::vector<baldr::PathLocation>& locations,
           baldr::GraphReader& graphreader,
           const std::shared_ptr<sif::DynamicCost>* mode_costing,
-          const sif::TravelMode mode);
+          const sif::TravelMode mode,
+          const float max_matrix_time = kMaxCost,
+          const float max_matrix_distance = kMaxCost);
 
   /**
    * Forms a time distance matrix from the set of source locations
@@ -111,6 +132,8 @@ class TimeDistanceMatrix {
    * @param  graphreader           Graph reader for accessing routing graph.
    * @param  costing               Costing methods.
    * @param  mode                  Travel mode to use.
+   * @param  max_matrix_time       Maximum time (seconds) of a result.
+   * @param  max_matrix_distance   Maximum distance (meters) of a result.
    * @return time/distance from origin index to all other locations
    */
   std::vector<TimeDistance> SourceToTarget(
@@ -118,7 +141,9 @@ class TimeDistanceMatrix {
           const std::vector<baldr::PathLocation>& target_location_list,
           baldr::GraphReader& graphreader,
           const std::shared_ptr<sif::DynamicCost>* mode_costing,
-          const sif::TravelMode mode);
+          const sif::TravelMode mode,
+          const float max_matrix_time = kMaxCost,
+          const float max_matrix_distance = kMaxCost);
 
   /**
    * Clear the temporary information generated during time+distance
@@ -126,7 +151,21 @@ class TimeDistanceMatrix {
    */
   void Clear();
 
+  /**
+   * Set the real-time speed store. Edges with real-time speeds are costed
+   * at those speeds.
+   * @param  speed_store  Speed store (nullptr disables traffic).
+   * @param  level        Hierarchy level of the speed tiles.
+   */
+  void set_speed_store(const std::shared_ptr<SpeedStore>& speed_store,
+                       const uint32_t level) {
+    traffic_.set_speed_store(speed_store, level);
+  }
+
  protected:
+  // Real-time speeds
+  TrafficSpeeds traffic_;
+
   // Number of destinations that have been found and settled (least cost path
   // computed).
   uint32_t settled_count_;
@@ -137,6 +176,15 @@ class TimeDistanceMatrix {
   // Cost threshold for termination
   float cost_threshold_;
 
+  // Time (seconds) and distance (meters) limits for the current request.
+  // Labels beyond either limit are not expanded and destinations beyond
+  // them are reported as not found.
+  float max_time_;
+  float max_distance_;
+
+  // Number of nearest destinations to find (0 finds all destinations)
+  uint32_t k_nearest_;
+
   // List of destinations
   std::vector<Destination> destinations_;
 
@@ -202,16 +250,21 @@ class TimeDistanceMatrix {
    * @param   origin        Location of the origin.
    * @param   locations     List of locations.
    * @param   destinations  Vector of destination indexes along this edge.
-   * @param   edge          Directed edge
+   * @param   edge          Directed edge in the direction of travel (the
+   *                        opposing edge of the label in many to one).
+   * @param   edgeid        Directed edge Id in the direction of travel.
    * @param   pred          Predecessor information in shortest path.
    * @param   predindex     Predecessor index in EdgeLabels vector.
    * @param   costing       Costing method.
-   * @return  Returns true if all destinations have been settled.
+   * @return  Returns true if all destinations have been settled (or, in
+   *          k-nearest mode, if no other destination can be closer than the
+   *          k nearest ones found so far).
    */
   bool UpdateDestinations(const baldr::PathLocation& origin,
                           const std::vector<baldr::PathLocation>& locations,
                           std::vector<uint32_t>& destinations,
                           const baldr::DirectedEdge* edge,
+                          const baldr::GraphId& edgeid,
                           const sif::EdgeLabel& pred,
                           const uint32_t predindex,
                           const std::shared_ptr<sif::DynamicCost>& costing);
@@ -0,0 +1,166 @@
+#ifndef VALHALLA_THOR_TRAFFIC_SPEEDS_H_
+#define VALHALLA_THOR_TRAFFIC_SPEEDS_H_
+
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/pathlocation.h>
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/speed_store.h>
+#include <valhalla/thor/historical_speeds.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Real-time speed lookaside for path algorithms. Edges with a real-time
+ * speed are costed by the time along the edge at that speed, other edges
+ * use the costing method. Speeds are measured from vehicle traffic so they
+ * only apply to driving costings (TravelMode::kDrive); all other modes use
+ * the costing method. Speed tiles only exist for the local hierarchy
+ * level. The speed tiles used by a search are kept until Clear so each is
+ * looked up in the (shared) speed store once per search. Without a speed
+ * store all edges use the costing method.
+ *
+ * With a historical speed store and a departure time (see SetDeparture),
+ * edges without a real-time speed use their historical speed for the hour
+ * of the departure. Searches that do not know the time each edge is
+ * reached (e.g. bidirectional A*) use this as an approximation.
+ */
+class TrafficSpeeds {
+ public:
+  /**
+   * Constructor. Traffic is disabled until a speed store is set.
+   */
+  TrafficSpeeds();
+
+  /**
+   * Set the real-time speed store.
+   * @param  speed_store  Speed store (nullptr disables traffic).
+   * @param  level        Hierarchy level of the speed tiles.
+   */
+  void set_speed_store(const std::shared_ptr<SpeedStore>& speed_store,
+                       const uint32_t level);
+
+  /**
+   * Set the historical speed store (<tileid>.hsp files on the same level
+   * as the real-time speeds).
+   * @param  historical_store  Historical speed store (nullptr disables
+   *                           historical speeds).
+   */
+  void set_historical_store(const std::shared_ptr<SpeedStore>& historical_store);
+
+  /**
+   * Set the departure time at which historical speeds are used from the
+   * origin date_time. A "current" date_time is resolved to the local time
+   * at the origin. Historical speeds are not used if the origin has no
+   * date_time.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  origin       Origin location.
+   */
+  void SetDeparture(baldr::GraphReader& graphreader, baldr::PathLocation& origin);
+
+  /**
+   * Get the seconds from the start of the week (Sunday 00:00) at the origin
+   * date_time. A "current" date_time is resolved to the local time at the
+   * end of the first origin edge and updated on the origin.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  origin       Origin location.
+   * @param  seconds      Seconds from the start of the week.
+   * @return Returns false if the origin has no date_time or the time
+   *         cannot be resolved.
+   */
+  static bool WeekSeconds(baldr::GraphReader& graphreader,
+                          baldr::PathLocation& origin, uint32_t& seconds);
+
+  /**
+   * Check if real-time or historical speeds are used.
+   * @return Returns true if there is a speed store or a historical speed
+   *         store.
+   */
+  bool enabled() const {
+    return speed_store_ != nullptr || historical_store_ != nullptr;
+  }
+
+  /**
+   * Check if real-time or historical speeds are used for a costing method.
+   * @param  costing  Costing method.
+   * @return Returns true if there is a speed store and the costing is for
+   *         a driving mode.
+   */
+  bool enabled(const std::shared_ptr<sif::DynamicCost>& costing) const {
+    return enabled() && costing->travel_mode() == sif::TravelMode::kDrive;
+  }
+
+  /**
+   * Get the real-time speed of a directed edge or else its historical speed
+   * at the departure hour.
+   * @param  edgeid  Directed edge Id.
+   * @return Returns the speed (kph) or 0 if there is no speed.
+   */
+  uint8_t speed(const baldr::GraphId& edgeid);
+
+  /**
+   * Get the cost of traversing a directed edge. In reverse searches this is
+   * the opposing edge (the edge in the direction of travel).
+   * @param  costing  Costing method.
+   * @param  edge     Directed edge.
+   * @param  edgeid   Directed edge Id.
+   * @return Returns the edge cost.
+   */
+  sif::Cost EdgeCost(const std::shared_ptr<sif::DynamicCost>& costing,
+                     const baldr::DirectedEdge* edge,
+                     const baldr::GraphId& edgeid);
+
+  /**
+   * Get the cost of traversing a directed edge and adjust the cost of the
+   * transition onto it. The transition cost is halved on edges with a
+   * real-time speed since traffic accounts for some of the time spent at
+   * intersections.
+   * @param  costing          Costing method.
+   * @param  edge             Directed edge.
+   * @param  edgeid           Directed edge Id.
+   * @param  transition_cost  Transition cost, updated if the edge has a
+   *                          real-time speed.
+   * @return Returns the edge cost.
+   */
+  sif::Cost EdgeCost(const std::shared_ptr<sif::DynamicCost>& costing,
+                     const baldr::DirectedEdge* edge,
+                     const baldr::GraphId& edgeid, sif::Cost& transition_cost);
+
+  /**
+   * Clear the speed tiles used by the search.
+   */
+  void Clear();
+
+ protected:
+  std::shared_ptr<SpeedStore> speed_store_;
+  std::shared_ptr<SpeedStore> historical_store_;
+  uint32_t level_;
+
+  // Whether historical speeds are used and the hour of the week they are
+  // used for
+  bool use_historical_;
+  uint32_t hour_;
+
+  // Real-time and historical speeds of a tile
+  struct TileSpeeds {
+    std::shared_ptr<const SpeedTile> realtime;
+    HistoricalSpeeds historical;
+  };
+
+  // Speed tiles used by the search, and the tile last used
+  std::unordered_map<uint32_t, TileSpeeds> tiles_;
+  const TileSpeeds* tile_;
+  uint32_t tileid_;
+  bool tile_set_;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_TRAFFIC_SPEEDS_H_
@@ -8,10 +8,18 @@
 #include <memory>
 
 #include <valhalla/thor/astar.h>
+#include <valhalla/thor/speed_store.h>
+#include <valhalla/thor/historical_speeds.h>
+#include <valhalla/thor/traffic_speeds.h>
 
 namespace valhalla {
 namespace thor {
 
+// Maximum distance (meters) between the origin and destination of paths
+// routed with the traffic algorithm. It does not take upward hierarchy
+// transitions so longer paths use bidirectional A*.
+constexpr float kMaxTrafficPathDistance = 50000.0f;
+
 /**
  * Traffic pathfinding algorithm. Note that this is just a quick proof of
  * concept for how tiled speeds could be used to influence route paths and
@@ -34,7 +42,10 @@ public:
 
   /**
    * Form path between and origin and destination location using
-   * the supplied costing method and real-time speed tiles.
+   * the supplied costing method and real-time speed tiles. In time-dependent
+   * mode (with a date_time on the origin), edges without a real-time speed
+   * use the historical speed for the hour of the week at which the edge is
+   * reached.
    * @param  origin  Origin location
    * @param  dest    Destination location
    * @param  graphreader  Graph reader for accessing routing graph.
@@ -48,18 +59,109 @@ public:
            const std::shared_ptr<sif::DynamicCost>* mode_costing,
            const sif::TravelMode mode);
 
+  /**
+   * Set the real-time speed store. This allows one store to be shared by
+   * several algorithm instances. If not set, a store of the traffic
+   * directory within the tile directory is created on first use, with
+   * speeds for the local hierarchy level.
+   * @param  speed_store  Speed store.
+   * @param  level        Hierarchy level of the speed (and historical
+   *                      speed) tiles.
+   */
+  void set_speed_store(const std::shared_ptr<SpeedStore>& speed_store,
+                       const uint32_t level) {
+    speed_store_ = speed_store;
+    speed_level_ = level;
+    speed_level_set_ = true;
+  }
+
+  /**
+   * Set the historical speed store (<tileid>.hsp files). If not set, a
+   * store of the traffic directory within the tile directory is created on
+   * first use.
+   * @param  historical_store  Historical speed store.
+   */
+  void set_historical_store(const std::shared_ptr<SpeedStore>& historical_store) {
+    historical_store_ = historical_store;
+  }
+
+  /**
+   * Set whether historical speeds are used at the time each edge is
+   * reached. Requires a date_time on the origin.
+   * @param  time_dependent  Use historical speeds.
+   */
+  void set_time_dependent(const bool time_dependent) {
+    time_dependent_ = time_dependent;
+  }
+
+  /**
+   * Check whether historical speeds are used at the time each edge is
+   * reached.
+   * @return Returns true if paths with an origin date_time are time
+   *         dependent.
+   */
+  bool time_dependent() const {
+    return time_dependent_;
+  }
 
 protected:
-  // Map of real-time speeds
-  std::unordered_map<uint32_t, std::vector<uint8_t>> real_time_speeds_;
-  std::vector<uint8_t> empty_speeds_;
+  // Use historical speeds at the time each edge is reached
+  bool time_dependent_;
+
+  // Whether the current path uses historical speeds and the seconds from
+  // the start of the week (Sunday 00:00) at the origin
+  bool use_historical_;
+  uint32_t week_start_;
+
+  // Real-time and historical speed tiles (kept across paths) and the
+  // hierarchy level they are for
+  std::shared_ptr<SpeedStore> speed_store_;
+  std::shared_ptr<SpeedStore> historical_store_;
+  uint32_t speed_level_;
+  bool speed_level_set_;
 
   /**
-   * Get address of the real-time speed table for the specified tile.
-   * Loads the speeds if they are not yet loaded.
+   * Get the real-time speed tile for the specified tile.
+   * @return Returns the speed tile or nullptr if the tile has no speeds.
    */
-  std::vector<uint8_t>& GetRealTimeSpeeds(const uint32_t tileid,
+  std::shared_ptr<const SpeedTile> GetRealTimeSpeeds(const uint32_t tileid,
                                           baldr::GraphReader& graphreader);
+
+  /**
+   * Get the historical speeds for the specified tile.
+   * @return Returns the historical speeds (with no speeds if the tile has
+   *         no historical speed file).
+   */
+  HistoricalSpeeds GetHistoricalSpeeds(const uint32_t tileid,
+                                       baldr::GraphReader& graphreader);
+
+  /**
+   * Set whether the path uses historical speeds and the time of the week at
+   * the origin. A "current" origin date_time is resolved to the local time
+   * at the origin.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  origin       Origin location.
+   */
+  void SetWeekStart(baldr::GraphReader& graphreader,
+                    baldr::PathLocation& origin);
+
+  /**
+   * Get the cost of a directed edge at the origin or destination with its
+   * real-time speed or else its historical speed at the origin time. The
+   * destination cost is only used when the path stays on an origin edge:
+   * other destination edges have their remainder costed at the time they
+   * are reached.
+   * @param  graphreader  Graph tile reader.
+   * @param  costing      Dynamic costing method.
+   * @param  edge         Directed edge.
+   * @param  edgeid       Directed edge Id.
+   * @param  origin       True for an origin edge, false for a destination edge.
+   * @return Returns the cost of the edge.
+   */
+  sif::Cost LocationEdgeCost(baldr::GraphReader& graphreader,
+            const std::shared_ptr<sif::DynamicCost>& costing,
+            const baldr::DirectedEdge* edge, const baldr::GraphId& edgeid,
+            const bool origin) override;
 };
 
 }
@@ -0,0 +1,100 @@
+#ifndef VALHALLA_THOR_TRANSIT_OPERATORS_H_
+#define VALHALLA_THOR_TRANSIT_OPERATORS_H_
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+#include <valhalla/baldr/graphtile.h>
+
+namespace valhalla {
+namespace thor {
+
+// Cost penalty for boarding a trip of a different transit operator than the
+// last trip ridden. TODO - make the operator change penalty configurable
+constexpr float kOperatorChangePenalty = 300.0f;
+
+/**
+ * Transit operator Ids. Each transit operator (by its onestop Id) is given a
+ * unique Id (starting at 1) so paths can compare operators as integers. The
+ * operator Id of each transit route is kept per tile the first time the
+ * route is looked up, so later lookups do not read or compare the operator
+ * name. The routes of the last tile looked up are kept at hand since
+ * consecutive lookups are usually within the same tile. Ids persist across
+ * requests until Clear is called.
+ */
+class TransitOperators {
+ public:
+  /**
+   * Constructor.
+   */
+  TransitOperators();
+
+  /**
+   * Get the operator Id of a transit route.
+   * @param  tile     Transit tile.
+   * @param  routeid  Index of the transit route within the tile.
+   * @return Returns the operator Id or 0 if the route has no operator.
+   */
+  uint32_t GetOperatorId(const baldr::GraphTile* tile, const uint32_t routeid);
+
+  /**
+   * Get the operator Id of a transit route, resolving its operator if the
+   * route has not been looked up.
+   * @param  tileid   Tile Id (value of the tile's base graph Id).
+   * @param  routeid  Index of the transit route within the tile.
+   * @param  resolve  Resolves the operator onestop Id of the route (empty
+   *                  if the route has no operator).
+   * @return Returns the operator Id or 0 if the route has no operator.
+   */
+  uint32_t GetOperatorId(const uint64_t tileid, const uint32_t routeid,
+                         const std::function<std::string ()>& resolve);
+
+  /**
+   * Clear the operator Ids (e.g. when the tiles are updated).
+   */
+  void Clear();
+
+  /**
+   * Get the number of operators with an Id.
+   * @return Returns the number of operators.
+   */
+  size_t size() const {
+    return operators_.size();
+  }
+
+ protected:
+  // Operator Id of each operator onestop Id
+  std::unordered_map<std::string, uint32_t> operators_;
+
+  // Operator Id of each transit route (by route index) within each tile
+  std::unordered_map<uint64_t, std::vector<uint32_t> > route_operators_;
+
+  // Tile Id and routes of the last tile looked up (nullptr if none)
+  uint64_t last_tileid_;
+  std::vector<uint32_t>* last_routes_;
+
+  /**
+   * Get the operator Ids of the routes within a tile.
+   * @param  tileid  Tile Id.
+   * @return Returns the operator Ids by route index.
+   */
+  std::vector<uint32_t>& Routes(const uint64_t tileid);
+
+  /**
+   * Set the operator Id of a route that has not been looked up.
+   * @param  routes         Operator Ids of the routes within the tile.
+   * @param  routeid        Index of the transit route within the tile.
+   * @param  operator_name  Operator onestop Id (empty if none).
+   * @return Returns the operator Id or 0 if the route has no operator.
+   */
+  uint32_t AddRoute(std::vector<uint32_t>& routes, const uint32_t routeid,
+                    const std::string& operator_name);
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_TRANSIT_OPERATORS_H_
@@ -0,0 +1,56 @@
+#ifndef VALHALLA_THOR_TRANSIT_STOP_INDEX_H_
+#define VALHALLA_THOR_TRANSIT_STOP_INDEX_H_
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Spatial index of transit stops (kMultiUseTransitStop nodes). The stops of
+ * each transit tile are found the first time the tile is queried and kept
+ * across requests, so finding the stops near a location only reads the
+ * tiles within the query radius once.
+ */
+class TransitStopIndex {
+ public:
+  /**
+   * Check if there is a transit stop within a straight line distance of a
+   * location.
+   * @param  graphreader  Graph reader
+   * @param  ll           Lat,lng of the location.
+   * @param  distance     Distance (meters).
+   * @return Returns true if a transit stop is within the distance.
+   */
+  bool HasStopWithin(baldr::GraphReader& graphreader,
+                     const midgard::PointLL& ll, const float distance);
+
+  /**
+   * Clear the index (e.g. when the tiles are updated).
+   */
+  void Clear();
+
+ protected:
+  // Lat,lng of the transit stops in each transit tile
+  std::unordered_map<uint64_t, std::vector<midgard::PointLL> > stops_;
+
+  /**
+   * Get the transit stops in a tile, finding them if not yet indexed.
+   * @param  graphreader  Graph reader
+   * @param  tileid       Transit tile Id.
+   * @return Returns the lat,lng of the stops in the tile.
+   */
+  const std::vector<midgard::PointLL>& Stops(baldr::GraphReader& graphreader,
+                                             const baldr::GraphId& tileid);
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_TRANSIT_STOP_INDEX_H_
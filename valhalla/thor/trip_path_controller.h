@@ -2,6 +2,8 @@
 #define VALHALLA_THOR_TRIP_PATH_CONTROLLER_H_
 
 #include <string>
+#include <bitset>
+#include <cstdint>
 #include <unordered_map>
 
 namespace valhalla {
@@ -95,6 +97,99 @@ const std::string kNodeCategory = "node.";
 const std::string kAdminCategory = "admin.";
 
 
+/**
+ * Attribute indexes into the compiled attributes of a trip path controller.
+ * Each corresponds to the attribute key of the same name.
+ */
+enum class TripPathAttribute : uint8_t {
+  kEdgeNames = 0,
+  kEdgeLength,
+  kEdgeSpeed,
+  kEdgeRoadClass,
+  kEdgeBeginHeading,
+  kEdgeEndHeading,
+  kEdgeBeginShapeIndex,
+  kEdgeEndShapeIndex,
+  kEdgeTraversability,
+  kEdgeUse,
+  kEdgeToll,
+  kEdgeUnpaved,
+  kEdgeTunnel,
+  kEdgeBridge,
+  kEdgeRoundabout,
+  kEdgeInternalIntersection,
+  kEdgeDriveOnRight,
+  kEdgeSurface,
+  kEdgeSignExitNumber,
+  kEdgeSignExitBranch,
+  kEdgeSignExitToward,
+  kEdgeSignExitName,
+  kEdgeTravelMode,
+  kEdgeVehicleType,
+  kEdgePedestrianType,
+  kEdgeBicycleType,
+  kEdgeTransitType,
+  kEdgeTransitRouteInfoOnestopId,
+  kEdgeTransitRouteInfoBlockId,
+  kEdgeTransitRouteInfoTripId,
+  kEdgeTransitRouteInfoShortName,
+  kEdgeTransitRouteInfoLongName,
+  kEdgeTransitRouteInfoHeadsign,
+  kEdgeTransitRouteInfoColor,
+  kEdgeTransitRouteInfoTextColor,
+  kEdgeTransitRouteInfoDescription,
+  kEdgeTransitRouteInfoOperatorOnestopId,
+  kEdgeTransitRouteInfoOperatorName,
+  kEdgeTransitRouteInfoOperatorUrl,
+  kEdgeId,
+  kEdgeWayId,
+  kEdgeWeightedGrade,
+  kEdgeMaxUpwardGrade,
+  kEdgeMaxDownwardGrade,
+  kEdgeLaneCount,
+  kEdgeCycleLane,
+  kEdgeBicycleNetwork,
+  kEdgeSidewalk,
+  kEdgeDensity,
+  kEdgeSpeedLimit,
+  kEdgeTruckSpeed,
+  kEdgeTruckRoute,
+  kNodeIntersectingEdgeBeginHeading,
+  kNodeIntersectingEdgeFromEdgeNameConsistency,
+  kNodeIntersectingEdgeToEdgeNameConsistency,
+  kNodeIntersectingEdgeDriveability,
+  kNodeIntersectingEdgeCyclability,
+  kNodeIntersectingEdgeWalkability,
+  kNodeElapsedTime,
+  kNodeaAdminIndex,
+  kNodeType,
+  kNodeFork,
+  kNodeTransitStopInfoType,
+  kNodeTransitStopInfoOnestopId,
+  kNodetransitStopInfoName,
+  kNodeTransitStopInfoArrivalDateTime,
+  kNodeTransitStopInfoDepartureDateTime,
+  kNodeTransitStopInfoIsParentStop,
+  kNodeTransitStopInfoAssumedSchedule,
+  kNodeTransitStopInfoLatLon,
+  kNodeTimeZone,
+  kOsmChangeset,
+  kAdminCountryCode,
+  kAdminCountryText,
+  kAdminStateCode,
+  kAdminStateText,
+  kShape,
+  kCount
+};
+constexpr size_t kTripPathAttributeCount =
+    static_cast<size_t>(TripPathAttribute::kCount);
+
+// Attribute categories
+enum class TripPathCategory : uint8_t {
+  kNode = 0,
+  kAdmin = 1
+};
+
 /**
  * Trip path controller for attributes
  */
@@ -106,28 +201,76 @@ struct TripPathController {
   static const std::unordered_map<std::string, bool> kRouteAttributes;
 
   /*
-   * Constructor that will use the route attributes by default.
+   * Constructor that will use the route attributes by default. Compiles the
+   * attributes.
    */
   TripPathController(
       const std::unordered_map<std::string, bool>& new_attributes =
           TripPathController::kRouteAttributes);
 
   /**
-   * Enable all of the attributes.
+   * Enable all of the attributes (and compile them).
    */
   void enable_all();
 
   /**
-   * Disable all of the attributes.
+   * Disable all of the attributes (and compile them).
    */
   void disable_all();
 
+  /**
+   * Enable or disable an attribute (and compile the attributes).
+   * Throws std::out_of_range if the key is not one of the attributes.
+   * @param  key      Attribute key.
+   * @param  enabled  True to enable the attribute, false to disable it.
+   */
+  void set_attribute(const std::string& key, const bool enabled);
+
+  /**
+   * Get the attributes by key.
+   * @return Returns the attributes.
+   */
+  const std::unordered_map<std::string, bool>& attributes() const {
+    return attributes_;
+  }
+
   /**
    * Returns true if any category attribute is enabled, false otherwise.
+   * This checks the attribute keys; use category_enabled when building
+   * trip paths.
    */
   bool category_attribute_enabled(const std::string& category) const;
 
-  std::unordered_map<std::string, bool> attributes;
+  /**
+   * Returns true if the attribute is enabled in the compiled attributes.
+   */
+  bool enabled(const TripPathAttribute attribute) const {
+    return enabled_[static_cast<size_t>(attribute)];
+  }
+
+  /**
+   * Returns true if any attribute of the category is enabled in the
+   * compiled attributes.
+   */
+  bool category_enabled(const TripPathCategory category) const {
+    return (category == TripPathCategory::kNode) ? node_enabled_ : admin_enabled_;
+  }
+
+ private:
+  /**
+   * Compile the attributes into a bitset indexed by TripPathAttribute and
+   * compute the category masks, so that checks while building a trip path
+   * do not look up string keys. Each change to the attributes compiles
+   * them, so the bitset always matches the attributes.
+   */
+  void compile();
+
+  std::unordered_map<std::string, bool> attributes_;
+
+  // Compiled attributes
+  std::bitset<kTripPathAttributeCount> enabled_;
+  bool node_enabled_;
+  bool admin_enabled_;
 };
 
 }
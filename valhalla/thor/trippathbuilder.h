@@ -9,7 +9,9 @@
 #include <valhalla/sif/costfactory.h>
 #include <valhalla/proto/trippath.pb.h>
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/thor/admin_cache.h>
 #include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/shape_cache.h>
 #include <valhalla/thor/trip_path_controller.h>
 
 namespace valhalla {
@@ -32,15 +34,25 @@ class TripPathBuilder {
 
   /**
    * Format the trip path output given the edges on the path.
-   * For now just return length. TODO - modify to return trip path.
+   * Edge shapes are taken from the shape cache and admins from the admin
+   * cache if given.
+   * @param  trip_path  Trip path to fill in. Created by the caller, so it
+   *                    can be on an arena along with all of its sub-messages.
+   * @param  admins     Returns the admin records of the trip path in admin
+   *                    index order (may be nullptr). The records are owned
+   *                    by the admin cache, which must then be given, and are
+   *                    valid until it is cleared.
    */
-  static odin::TripPath Build(
+  static void Build(
       const TripPathController& controller, baldr::GraphReader& graphreader,
       const std::shared_ptr<sif::DynamicCost>* mode_costing,
       const std::vector<PathInfo>& path, baldr::PathLocation& origin,
       baldr::PathLocation& dest,
       const std::vector<baldr::PathLocation>& through_loc,
-      const std::function<void ()>* interrupt_callback = nullptr);
+      odin::TripPath& trip_path,
+      const std::function<void ()>* interrupt_callback = nullptr,
+      ShapeCache* shape_cache = nullptr, AdminCache* admin_cache = nullptr,
+      std::vector<const AdminRecord*>* admins = nullptr);
 
   /**
    * Add trip edge. (TODO more comments)
@@ -52,6 +64,8 @@ class TripPathBuilder {
    * @param  directededge  Directed edge information.
    * @param  trip_node     Trip node to add the edge information to.
    * @param  graphtile     Graph tile for accessing data.
+   * @param  shape         Decoded shape of the edge (in the direction of its
+   *                       edge info) for the begin and end headings.
    * @param  length_pct    Scale for the edge length for the partial distance
    *                       at begin and end edges
    */
@@ -64,6 +78,7 @@ class TripPathBuilder {
                                           const baldr::DirectedEdge* directededge,
                                           odin::TripPath_Node* trip_node,
                                           const baldr::GraphTile* graphtile,
+                                          const std::vector<midgard::PointLL>& shape,
                                           const float length_percentage = 1.f);
 
   /**